@@ -0,0 +1,409 @@
+// Frame time benchmark for the whole renderer.
+// Builds a named scene, flies the camera along a spline at a fixed simulated step and renders a fixed number of
+// frames, so two runs of the same build draw exactly the same images. Reports CPU, GPU and whole frame times
+// (average, p50, p95, p99), GL draw counts and peak memory as JSON. GPU culled objects are drawn indirectly, so they
+// are in the draw count but their triangles are not, and the report says when that left triangles partial.
+// It also counts how often the shadow cache redrew its static and its dynamic casters over the timed frames. Given a baseline report it prints the change
+// in every number and fails if any went up by more than the threshold.
+//
+//   make bench && ./build/bench [--scene default|cubes] [--count N] [--frames N] [--warmup N] [--size WxH]
+//                               [--path orbit|keys.txt] [--deferred] [--cpu-culling]
+//                               [--output report.json] [--baseline base.json] [--threshold percent]
+//
+// A path file has one key per line, "x y z tx ty tz" for the position and the point looked at (see CameraPath).
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "stb_image.h"
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "CameraPath.h"
+#include "GlStats.h"
+#include "GpuProfiler.h"
+#include "HeadlessContext.h"
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "Simulation.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define DEFAULT_FRAMES 600
+#define DEFAULT_WARMUP 60
+// every validated frame stalls on a readback, about a second each on llvmpipe
+#define DEFAULT_VALIDATE_FRAMES 30
+#define DEFAULT_THRESHOLD 10.0
+
+struct Timings {
+    double average;
+    double p50;
+    double p95;
+    double p99;
+};
+
+// One number in the report, named by the object it sits in and its key
+struct Metric {
+    const char *object;
+    const char *key;
+    double value;
+};
+
+Timings timings(std::vector<double> times)
+{
+    Timings result = {0.0, 0.0, 0.0, 0.0};
+    if (times.empty()) return result;
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (double time : times) sum += time;
+    auto percentile = [&](double p) { return times[std::min((size_t)(p * times.size()), times.size() - 1)]; };
+    result.average = sum / times.size();
+    result.p50 = percentile(0.50);
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    return result;
+}
+
+/* In kilobytes, the high water mark of the whole process */
+long peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+/* Just enough JSON to read a report back: the number under key, inside object when there is one */
+bool json_number(const std::string &json, const char *object, const char *key, double &value)
+{
+    size_t start = 0;
+    if (object != nullptr)
+    {
+        start = json.find(std::string("\"") + object + "\"");
+        if (start == std::string::npos) return false;
+    }
+    size_t at = json.find(std::string("\"") + key + "\"", start);
+    if (at == std::string::npos) return false;
+    at = json.find(':', at);
+    if (at == std::string::npos) return false;
+    value = atof(json.c_str() + at + 1);
+    return true;
+}
+
+bool read_file(const char *path, std::string &contents)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        printf("Failed to open baseline %s\n", path);
+        return false;
+    }
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) contents.append(buffer, read);
+    fclose(file);
+    return true;
+}
+
+void write_timings(FILE *file, const char *name, const Timings &t)
+{
+    fprintf(file, "  \"%s\": {\"average\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f},\n", name, t.average, t.p50, t.p95, t.p99);
+}
+
+/* Prints every metric against the baseline, false when one got worse by more than threshold percent */
+bool compare(const std::vector<Metric> &metrics, const std::string &baseline, double threshold)
+{
+    bool ok = true;
+    printf("%-24s %12s %12s %9s\n", "metric", "baseline", "current", "change");
+    for (const Metric &metric : metrics)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%s%s%s", metric.object != nullptr ? metric.object : "", metric.object != nullptr ? "." : "", metric.key);
+        double before;
+        if (!json_number(baseline, metric.object, metric.key, before))
+        {
+            printf("%-24s %12s %12.3f\n", name, "-", metric.value);
+            continue;
+        }
+        double change = before != 0.0 ? 100.0 * (metric.value - before) / before : 0.0;
+        // every number in the report is better lower
+        bool regressed = change > threshold;
+        if (regressed) ok = false;
+        printf("%-24s %12.3f %12.3f %+8.1f%%%s\n", name, before, metric.value, change, regressed ? "  REGRESSION" : "");
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    std::string scene = "default";
+    unsigned int count = 0;
+    int frames = DEFAULT_FRAMES;
+    bool framesGiven = false;
+    int warmup = DEFAULT_WARMUP;
+    int width = 800;
+    int height = 600;
+    const char *pathName = "orbit";
+    bool deferred = false;
+    bool gpuCulling = true;
+    const char *output = "bench.json";
+    const char *baselinePath = nullptr;
+    double threshold = DEFAULT_THRESHOLD;
+    bool validateCulling = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) scene = argv[++i];
+        else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) count = (unsigned int)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) { frames = atoi(argv[++i]); framesGiven = true; }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &width, &height);
+        else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) pathName = argv[++i];
+        else if (strcmp(argv[i], "--deferred") == 0) deferred = true;
+        else if (strcmp(argv[i], "--cpu-culling") == 0) gpuCulling = false;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--validate-culling") == 0) validateCulling = true;
+        else
+        {
+            printf("usage: %s [--scene default|cubes] [--count N] [--frames N] [--warmup N] [--size WxH] [--path orbit|keys.txt]\n"
+                   "          [--deferred] [--cpu-culling] [--output report.json] [--baseline base.json] [--threshold percent]\n"
+                   "          [--validate-culling]\n"
+                   "--validate-culling checks %d frames by default, each one stalls on a readback\n", argv[0], DEFAULT_VALIDATE_FRAMES);
+            return 1;
+        }
+    }
+    if (validateCulling)
+    {
+        // nothing is timed, so there is nothing to warm up
+        warmup = 0;
+        if (!framesGiven) frames = DEFAULT_VALIDATE_FRAMES;
+    }
+    if (frames <= 0 || warmup < 0 || width <= 0 || height <= 0) return 1;
+
+    CameraPath path;
+    if (!path.load(pathName)) return 1;
+
+    std::string baseline;
+    if (baselinePath != nullptr && !read_file(baselinePath, baseline)) return 1;
+
+#ifdef HEADLESS_EGL
+    HeadlessContext context;
+    if (!context.create(width, height)) return 1;
+    GLADloadproc loadProc = (GLADloadproc)HeadlessContext::get_proc_address;
+#else
+    // a window nobody sees, drawn into but never swapped
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(width, height, "bench", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwGetFramebufferSize(window, &width, &height);
+    GLADloadproc loadProc = (GLADloadproc)glfwGetProcAddress;
+#endif
+    Camera::set_window_ratio((float)width, (float)height);
+    Camera::init_orientation();
+    stbi_set_flip_vertically_on_load(true);
+
+    JobSystem::init();
+    glm::vec3 lightPos = glm::vec3(1.2f, 1.0f, 2.0f);
+    Simulation sim;
+    if (!sim.setup(scene, count, lightPos))
+    {
+        printf("Unknown scene %s\n", scene.c_str());
+        return 1;
+    }
+    if (!Renderer::setup(lightPos, loadProc)) return 1;
+    GlStats::install();
+    printf("bench: %s, %u objects, %d frames after %d warmup at %dx%d on %s\n", scene.c_str(), sim.object_count(),
+           frames, warmup, width, height, (const char *)glGetString(GL_RENDERER));
+
+    Renderer::FrameSnapshot snapshot;
+    snapshot.stepSeconds = SIM_DT;
+    snapshot.lightPos = lightPos;
+    snapshot.mixPercent = 0.2f;
+    snapshot.framebufferWidth = width;
+    snapshot.framebufferHeight = height;
+    snapshot.gpuCulling = gpuCulling;
+    snapshot.deferredShading = deferred;
+
+    // made after the warmup so only timed frames land in it, with room for all of them
+    GpuProfiler *gpu = nullptr;
+    std::vector<double> cpuTimes;
+    std::vector<double> frameTimes;
+    unsigned long long drawCalls = 0;
+    unsigned long long indirectDraws = 0;
+    unsigned long long triangles = 0;
+    unsigned long long calls = 0;
+    unsigned long long stateChanges = 0;
+    unsigned long long staticShadowRenders = 0;
+    unsigned long long dynamicShadowRenders = 0;
+    // --validate-culling checks the GPU cull of every frame against the CPU instead of timing anything
+    int mismatches = 0;
+
+    for (int frame = 0; frame < warmup + frames; frame++)
+    {
+        bool timed = frame >= warmup;
+        if (timed && gpu == nullptr && !validateCulling)
+        {
+            gpu = new GpuProfiler((unsigned int)frames);
+            // counted from here, the cache's first fill belongs to the warmup
+            staticShadowRenders = Renderer::shadow_static_renders();
+            dynamicShadowRenders = Renderer::shadow_dynamic_renders();
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        sim.begin_step();
+        path.apply((sim.step() + 1) * SIM_DT);
+        sim.end_step(SIM_DT);
+        sim.fill_snapshot(snapshot);
+        snapshot.stateTime = sim.step() * SIM_DT;
+
+#ifdef HEADLESS_EGL
+        context.bind();
+#endif
+        if (gpu != nullptr) gpu->begin_frame();
+        Renderer::draw_frame(snapshot, 1.0f);
+        if (gpu != nullptr) gpu->end_frame();
+        std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+
+        // every frame runs on its own, nothing queued behind it carries into the next one's times
+        glFinish();
+        std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+        GlStats::end_frame();
+
+        if (validateCulling)
+        {
+            if (!Renderer::validate_gpu_culling(snapshot)) mismatches++;
+            continue;
+        }
+        if (!timed) continue;
+        cpuTimes.push_back(std::chrono::duration<double, std::milli>(submitted - start).count());
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(finished - start).count());
+        const GlStats::FrameStats &stats = GlStats::last_frame();
+        drawCalls += stats.drawCalls;
+        indirectDraws += stats.indirectDraws;
+        triangles += stats.triangles;
+        calls += stats.calls;
+        stateChanges += stats.stateChanges;
+    }
+
+    if (validateCulling)
+    {
+        printf("culling: %d frames checked against the CPU frustum test, %d failed\n", frames, mismatches);
+        Renderer::shutdown();
+        JobSystem::shutdown();
+#ifdef HEADLESS_EGL
+        context.destroy();
+#else
+        glfwTerminate();
+#endif
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    staticShadowRenders = Renderer::shadow_static_renders() - staticShadowRenders;
+    dynamicShadowRenders = Renderer::shadow_dynamic_renders() - dynamicShadowRenders;
+
+    Timings gpuTimes = {0.0, 0.0, 0.0, 0.0};
+    gpu->collect();
+    std::vector<GpuProfiler::PassStats> passes;
+    gpu->stats(passes);
+    if (!passes.empty() && passes[0].samples > 0)
+    {
+        gpuTimes = Timings{passes[0].averageMs, passes[0].p50Ms, passes[0].p95Ms, passes[0].p99Ms};
+    }
+    else
+    {
+        printf("No GPU timings, the context has no timer queries\n");
+    }
+    delete gpu;
+
+    Timings cpu = timings(cpuTimes);
+    Timings whole = timings(frameTimes);
+    std::vector<Metric> metrics = {
+        {"cpu_ms", "p50", cpu.p50}, {"cpu_ms", "p95", cpu.p95}, {"cpu_ms", "p99", cpu.p99},
+        {"gpu_ms", "p50", gpuTimes.p50}, {"gpu_ms", "p95", gpuTimes.p95}, {"gpu_ms", "p99", gpuTimes.p99},
+        {"frame_ms", "p50", whole.p50}, {"frame_ms", "p95", whole.p95}, {"frame_ms", "p99", whole.p99},
+        {nullptr, "draw_calls", (double)drawCalls / frames},
+        {nullptr, "indirect_draws", (double)indirectDraws / frames},
+        {nullptr, "triangles", (double)triangles / frames},
+        {nullptr, "gl_calls", (double)calls / frames},
+        {nullptr, "state_changes", (double)stateChanges / frames},
+        {nullptr, "shadow_static_renders", (double)staticShadowRenders},
+        {nullptr, "shadow_dynamic_renders", (double)dynamicShadowRenders},
+        {nullptr, "peak_rss_kb", (double)peak_rss_kb()},
+    };
+
+    bool ok = true;
+    FILE *file = fopen(output, "w");
+    if (file == nullptr)
+    {
+        printf("Failed to open %s for the report\n", output);
+        ok = false;
+    }
+    else
+    {
+        fprintf(file, "{\n");
+        fprintf(file, "  \"scene\": \"%s\",\n  \"objects\": %u,\n  \"frames\": %d,\n  \"warmup\": %d,\n", scene.c_str(), sim.object_count(), frames, warmup);
+        fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n  \"path\": \"%s\",\n", width, height, pathName);
+        fprintf(file, "  \"deferred\": %s,\n  \"gpu_culling\": %s,\n", deferred ? "true" : "false", gpuCulling ? "true" : "false");
+        fprintf(file, "  \"renderer\": \"%s\",\n", (const char *)glGetString(GL_RENDERER));
+        write_timings(file, "cpu_ms", cpu);
+        write_timings(file, "gpu_ms", gpuTimes);
+        write_timings(file, "frame_ms", whole);
+        fprintf(file, "  \"draw_calls\": %.1f,\n  \"indirect_draws\": %.1f,\n  \"triangles\": %.1f,\n  \"triangles_partial\": %s,\n",
+                (double)drawCalls / frames, (double)indirectDraws / frames, (double)triangles / frames, indirectDraws > 0 ? "true" : "false");
+        fprintf(file, "  \"gl_calls\": %.1f,\n  \"state_changes\": %.1f,\n", (double)calls / frames, (double)stateChanges / frames);
+        fprintf(file, "  \"shadow_static_renders\": %llu,\n  \"shadow_dynamic_renders\": %llu,\n", staticShadowRenders, dynamicShadowRenders);
+        fprintf(file, "  \"peak_rss_kb\": %ld\n}\n", peak_rss_kb());
+        fclose(file);
+    }
+
+    printf("%-10s %8s %8s %8s %8s\n", "ms", "avg", "p50", "p95", "p99");
+    printf("%-10s %8.3f %8.3f %8.3f %8.3f\n", "cpu", cpu.average, cpu.p50, cpu.p95, cpu.p99);
+    printf("%-10s %8.3f %8.3f %8.3f %8.3f\n", "gpu", gpuTimes.average, gpuTimes.p50, gpuTimes.p95, gpuTimes.p99);
+    printf("%-10s %8.3f %8.3f %8.3f %8.3f\n", "frame", whole.average, whole.p50, whole.p95, whole.p99);
+    printf("%.0f draws, %.0f triangles, %.0f GL calls per frame, peak RSS %ld KB\n",
+           (double)drawCalls / frames, (double)triangles / frames, (double)calls / frames, peak_rss_kb());
+    if (indirectDraws > 0)
+    {
+        printf("%.0f of the draws were indirect, their triangles are counted on the GPU and left out\n", (double)indirectDraws / frames);
+    }
+    printf("shadow cache: static casters redrawn %llu times, dynamic %llu times in %d frames\n", staticShadowRenders, dynamicShadowRenders, frames);
+
+    if (!baseline.empty() && !compare(metrics, baseline, threshold))
+    {
+        printf("Regressed by more than %.1f%% against %s\n", threshold, baselinePath);
+        ok = false;
+    }
+
+    Renderer::shutdown();
+    JobSystem::shutdown();
+#ifdef HEADLESS_EGL
+    context.destroy();
+#else
+    glfwTerminate();
+#endif
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+// Scaling benchmark for JobSystem::parallel_for.
+// Culls N transformed boxes against a frustum at every thread count up to the hardware limit
+// and prints the speedup over one thread.
+//
+//   make bench_jobs && ./build/bench_jobs [object count]
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bounds.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+const int WARMUP_RUNS = 3;
+const int TIMED_RUNS = 15;
+const unsigned int GRAIN = 4096;
+
+double run_once(const std::vector<glm::mat4> &models, const Frustum &frustum, std::vector<unsigned char> &visible)
+{
+    const AABB unitCube(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+    auto start = std::chrono::steady_clock::now();
+    JobSystem::parallel_for((unsigned int)models.size(), GRAIN, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+        {
+            AABB world = AABB::transformed(unitCube, models[i]);
+            visible[i] = frustum.test(world) != Frustum::OUTSIDE;
+        }
+    });
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int count = argc > 1 ? (unsigned int)atoi(argv[1]) : 1000000;
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<glm::mat4> models(count);
+    srand(1);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        glm::vec3 p = glm::vec3(rand() % 200 - 100, rand() % 200 - 100, rand() % 200 - 100);
+        models[i] = glm::rotate(glm::translate(glm::mat4(1.0f), p), (float)(rand() % 360), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    std::vector<unsigned char> visible(count);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::from_matrix(projection * view);
+
+    printf("parallel_for over %u objects, grain %u\n", count, GRAIN);
+    printf("%8s %12s %10s %12s\n", "threads", "median ms", "speedup", "efficiency");
+
+    double baseline = 0.0;
+    for (unsigned int threads = 1; threads <= maxThreads; threads = threads < maxThreads ? std::min(threads * 2, maxThreads) : threads + 1)
+    {
+        JobSystem::init(threads - 1);
+
+        for (int i = 0; i < WARMUP_RUNS; i++)
+        {
+            run_once(models, frustum, visible);
+        }
+
+        std::vector<double> times;
+        for (int i = 0; i < TIMED_RUNS; i++)
+        {
+            times.push_back(run_once(models, frustum, visible));
+        }
+        std::sort(times.begin(), times.end());
+        double median = times[times.size() / 2];
+
+        if (threads == 1) baseline = median;
+        double speedup = baseline / median;
+        printf("%8u %12.3f %9.2fx %11.0f%%\n", threads, median, speedup, 100.0 * speedup / threads);
+
+        JobSystem::shutdown();
+    }
+
+    return 0;
+}
@@ -0,0 +1,267 @@
+// Microbenchmarks for the small functions every frame calls many times: the camera matrices and mouse update,
+// the world matrix blend and composition in the render loop, the HUD rotation and ShaderHelper's uniform setters.
+// Each one is timed in batches long enough for the clock, after warmup batches, and batches outside the
+// interquartile fences are thrown away before the statistics. Times are per call.
+//
+//   make bench_micro && ./build/bench_micro [--filter name] [--repetitions N] [--no-gl]
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Camera.h"
+#include "HeadlessContext.h"
+#include "ShaderHelper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+const int WARMUP_SAMPLES = 5;
+const int DEFAULT_REPETITIONS = 31;
+// a batch has to run at least this long before the clock's resolution stops mattering
+const double MIN_SAMPLE_MS = 2.0;
+const unsigned int INPUT_COUNT = 1024;
+
+struct Result {
+    double median;
+    double mean;
+    double stddev;
+    double min;
+    unsigned int rejected;
+    unsigned long long batch;
+};
+
+const char *g_filter = nullptr;
+int g_repetitions = DEFAULT_REPETITIONS;
+
+/* Makes the compiler believe value is read, so the work producing it can't be dropped */
+template <typename T>
+inline void keep(const T &value)
+{
+    asm volatile("" : : "m"(value) : "memory");
+}
+
+template <typename Body>
+double time_batch(Body &body, unsigned long long batch)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < batch; i++)
+    {
+        body((unsigned int)i);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* body(i) is one call, i picks its inputs so nothing is loop invariant */
+template <typename Body>
+void run(const char *name, Body body)
+{
+    if (g_filter != nullptr && strstr(name, g_filter) == nullptr) return;
+
+    // double the batch until it is long enough to time
+    unsigned long long batch = 1;
+    while (time_batch(body, batch) < MIN_SAMPLE_MS * 1e6 && batch < (1ull << 40)) batch *= 2;
+
+    for (int i = 0; i < WARMUP_SAMPLES; i++)
+    {
+        time_batch(body, batch);
+    }
+    std::vector<double> samples;
+    for (int i = 0; i < g_repetitions; i++)
+    {
+        samples.push_back(time_batch(body, batch) / batch);
+    }
+
+    // Tukey's fences, preemption and frequency changes only ever push samples up
+    std::sort(samples.begin(), samples.end());
+    double q1 = samples[samples.size() / 4];
+    double q3 = samples[samples.size() * 3 / 4];
+    double low = q1 - 1.5 * (q3 - q1);
+    double high = q3 + 1.5 * (q3 - q1);
+    std::vector<double> kept;
+    for (double sample : samples)
+    {
+        if (sample >= low && sample <= high) kept.push_back(sample);
+    }
+
+    Result result;
+    result.batch = batch;
+    result.rejected = (unsigned int)(samples.size() - kept.size());
+    result.median = kept[kept.size() / 2];
+    result.min = kept.front();
+    double sum = 0.0;
+    for (double sample : kept) sum += sample;
+    result.mean = sum / kept.size();
+    double variance = 0.0;
+    for (double sample : kept) variance += (sample - result.mean) * (sample - result.mean);
+    result.stddev = kept.size() > 1 ? sqrt(variance / (kept.size() - 1)) : 0.0;
+
+    printf("%-36s %10.2f %10.2f %9.2f %10.2f %6u/%-3d %12llu\n", name, result.median, result.mean, result.stddev,
+           result.min, result.rejected, g_repetitions, result.batch);
+}
+
+const char *uniformVertexSource = "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "uniform mat4 model;\n"
+    "void main()\n"
+    "{\n"
+    "  gl_Position = model * vec4(aPos, 1.0);\n"
+    "}";
+
+const char *uniformFragmentSource = "#version 330 core\n"
+    "uniform vec3 objectColour;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "  FragColor = vec4(objectColour, 1.0);\n"
+    "}";
+
+/* Name lookups against caching the location, the cost set_uniform pays on every call */
+void uniform_benchmarks(const std::vector<glm::mat4> &matrices, const std::vector<glm::vec3> &vectors)
+{
+    ShaderHelper shader;
+    shader.add_shader(GL_VERTEX_SHADER, &uniformVertexSource);
+    shader.add_shader(GL_FRAGMENT_SHADER, &uniformFragmentSource);
+    if (!shader.link_shaders()) return;
+    shader.use();
+    int modelLocation = shader.get_uniform_location("model");
+    int colourLocation = shader.get_uniform_location("objectColour");
+
+    run("ShaderHelper::set_uniform vec3", [&](unsigned int i) {
+        shader.set_uniform("objectColour", vectors[i % INPUT_COUNT]);
+    });
+    run("glUniform3f cached location", [&](unsigned int i) {
+        const glm::vec3 &v = vectors[i % INPUT_COUNT];
+        glUniform3f(colourLocation, v.x, v.y, v.z);
+    });
+    run("ShaderHelper::set_uniform_matrix4", [&](unsigned int i) {
+        shader.set_uniform_matrix4("model", 1, GL_FALSE, glm::value_ptr(matrices[i % INPUT_COUNT]));
+    });
+    run("glUniformMatrix4fv cached location", [&](unsigned int i) {
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(matrices[i % INPUT_COUNT]));
+    });
+    run("ShaderHelper::get_uniform_location", [&](unsigned int i) {
+        int location = shader.get_uniform_location((i & 1) ? "model" : "objectColour");
+        keep(location);
+    });
+    glFinish();
+}
+
+/* A context of its own just for the uniform benchmarks, nothing is drawn */
+#ifdef HEADLESS_EGL
+bool gl_benchmarks(const std::vector<glm::mat4> &matrices, const std::vector<glm::vec3> &vectors)
+{
+    HeadlessContext context;
+    if (!context.create(64, 64)) return false;
+    if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::get_proc_address)) return false;
+    uniform_benchmarks(matrices, vectors);
+    context.destroy();
+    return true;
+}
+#else
+bool gl_benchmarks(const std::vector<glm::mat4> &matrices, const std::vector<glm::vec3> &vectors)
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "bench_micro", NULL, NULL);
+    if (window == NULL)
+    {
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return false;
+    uniform_benchmarks(matrices, vectors);
+    glfwTerminate();
+    return true;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    bool gl = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) g_filter = argv[++i];
+        else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) g_repetitions = std::max(4, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--no-gl") == 0) gl = false;
+        else
+        {
+            printf("usage: %s [--filter name] [--repetitions N] [--no-gl]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // the same inputs every run
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<glm::mat4> matrices(INPUT_COUNT);
+    std::vector<glm::vec3> vectors(INPUT_COUNT);
+    std::vector<Camera::State> states(INPUT_COUNT);
+    std::vector<glm::dvec2> cursor(INPUT_COUNT);
+    for (unsigned int i = 0; i < INPUT_COUNT; i++)
+    {
+        glm::vec3 p = glm::vec3(unit(rng), unit(rng), unit(rng)) * 10.0f;
+        matrices[i] = glm::rotate(glm::translate(glm::mat4(1.0f), p), 3.1416f * unit(rng), glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 2.0f, 0.0f)));
+        vectors[i] = p;
+        glm::vec3 front = glm::normalize(glm::vec3(unit(rng), 0.5f * unit(rng), unit(rng)));
+        states[i] = Camera::State{p, front, glm::vec3(0.0f, 1.0f, 0.0f), 180.0f * unit(rng), 80.0f * unit(rng), 30.0f + 15.0f * unit(rng), 4.0f / 3.0f};
+        // a mouse wandering around the middle of the window
+        cursor[i] = glm::dvec2(400.0 + 50.0 * sin(i * 0.05), 300.0 + 30.0 * cos(i * 0.07));
+    }
+
+    Camera::set_window_ratio(800.0f, 600.0f);
+    Camera::init_orientation();
+
+    printf("%-36s %10s %10s %9s %10s %10s %12s\n", "ns per call", "median", "mean", "stddev", "min", "outliers", "batch");
+
+    run("Camera::get_view_matrix", [&](unsigned int i) {
+        Camera::pos = vectors[i % INPUT_COUNT];
+        glm::mat4 view = Camera::get_view_matrix();
+        keep(view);
+    });
+    run("Camera::mouse_callback", [&](unsigned int i) {
+        const glm::dvec2 &c = cursor[i % INPUT_COUNT];
+        Camera::mouse_callback(nullptr, c.x, c.y);
+    });
+    run("Camera::projection_matrix", [&](unsigned int i) {
+        glm::mat4 projection = Camera::projection_matrix(states[i % INPUT_COUNT]);
+        keep(projection);
+    });
+    run("Camera::interpolate", [&](unsigned int i) {
+        Camera::State state = Camera::interpolate(states[i % INPUT_COUNT], states[(i + 1) % INPUT_COUNT], 0.5f);
+        keep(state);
+    });
+    run("Camera::hud_rotation", [&](unsigned int i) {
+        glm::mat4 rotation = Camera::hud_rotation(states[i % INPUT_COUNT]);
+        keep(rotation);
+    });
+    // what the render loop does per object: blend the two steps' world matrices, then on to clip space
+    run("world matrix blend", [&](unsigned int i) {
+        float alpha = (i & 255) / 255.0f;
+        glm::mat4 model = matrices[i % INPUT_COUNT] * (1.0f - alpha) + matrices[(i + 1) % INPUT_COUNT] * alpha;
+        keep(model);
+    });
+    run("projection * view * model", [&](unsigned int i) {
+        const Camera::State &state = states[i % INPUT_COUNT];
+        glm::mat4 mvp = Camera::projection_matrix(state) * Camera::view_matrix(state) * matrices[i % INPUT_COUNT];
+        keep(mvp);
+    });
+
+    if (gl && !gl_benchmarks(matrices, vectors)) printf("No GL context, skipped the uniform benchmarks\n");
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cmath>
+
+// Axis aligned bounding box. A default constructed box is empty (min > max)
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    AABB() {}
+    AABB(glm::vec3 lo, glm::vec3 hi) : min(lo), max(hi) {}
+
+    bool valid() const
+    {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    void grow(const glm::vec3 &p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void grow(const AABB &b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    glm::vec3 centre() const { return (min + max) * 0.5f; }
+    glm::vec3 extent() const { return max - min; }
+
+    float surface_area() const
+    {
+        if (!valid()) return 0.0f;
+        glm::vec3 e = extent();
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    bool overlaps(const AABB &b) const
+    {
+        return min.x <= b.max.x && max.x >= b.min.x &&
+               min.y <= b.max.y && max.y >= b.min.y &&
+               min.z <= b.max.z && max.z >= b.min.z;
+    }
+
+    bool contains(const AABB &b) const
+    {
+        return min.x <= b.min.x && max.x >= b.max.x &&
+               min.y <= b.min.y && max.y >= b.max.y &&
+               min.z <= b.min.z && max.z >= b.max.z;
+    }
+
+    bool operator==(const AABB &b) const { return min == b.min && max == b.max; }
+    bool operator!=(const AABB &b) const { return !(*this == b); }
+
+    /* Bounds of a local space box after being moved by a model matrix (Arvo's method) */
+    static AABB transformed(const AABB &local, const glm::mat4 &m)
+    {
+        glm::vec3 t = glm::vec3(m[3]);
+        AABB out(t, t);
+        for (int col = 0; col < 3; col++)
+        {
+            for (int row = 0; row < 3; row++)
+            {
+                float a = m[col][row] * local.min[col];
+                float b = m[col][row] * local.max[col];
+                out.min[row] += fminf(a, b);
+                out.max[row] += fmaxf(a, b);
+            }
+        }
+        return out;
+    }
+};
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 dir;
+    glm::vec3 invDir;
+    float tMax;
+
+    Ray(glm::vec3 o, glm::vec3 d, float maxDistance = FLT_MAX)
+        : origin(o), dir(d), invDir(1.0f / d), tMax(maxDistance) {}
+};
+
+/* Slab test. tNear is the entry distance, clamped to 0 when the origin is inside the box */
+inline bool intersect_ray_aabb(const Ray &r, const AABB &b, float &tNear)
+{
+    glm::vec3 t0 = (b.min - r.origin) * r.invDir;
+    glm::vec3 t1 = (b.max - r.origin) * r.invDir;
+    glm::vec3 lo = glm::min(t0, t1);
+    glm::vec3 hi = glm::max(t0, t1);
+    float enter = fmaxf(fmaxf(lo.x, lo.y), fmaxf(lo.z, 0.0f));
+    float exit = fminf(fminf(hi.x, hi.y), fminf(hi.z, r.tMax));
+    tNear = enter;
+    return enter <= exit;
+}
+
+struct Frustum {
+    enum Result { OUTSIDE, INTERSECTING, INSIDE };
+
+    // left, right, bottom, top, near, far. xyz is the inward facing normal, w the distance
+    glm::vec4 planes[6];
+
+    /* Gribb/Hartmann plane extraction from projection * view */
+    static Frustum from_matrix(const glm::mat4 &viewProj)
+    {
+        Frustum f;
+        glm::vec4 row0 = glm::vec4(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+        glm::vec4 row1 = glm::vec4(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+        glm::vec4 row2 = glm::vec4(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+        glm::vec4 row3 = glm::vec4(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+        f.planes[0] = row3 + row0;
+        f.planes[1] = row3 - row0;
+        f.planes[2] = row3 + row1;
+        f.planes[3] = row3 - row1;
+        f.planes[4] = row3 + row2;
+        f.planes[5] = row3 - row2;
+
+        for (int i = 0; i < 6; i++)
+        {
+            f.planes[i] /= glm::length(glm::vec3(f.planes[i]));
+        }
+        return f;
+    }
+
+    Result test(const AABB &b) const
+    {
+        glm::vec3 c = b.centre();
+        glm::vec3 e = b.extent() * 0.5f;
+        Result result = INSIDE;
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec3 n = glm::vec3(planes[i]);
+            float d = glm::dot(n, c) + planes[i].w;
+            float r = glm::dot(glm::abs(n), e);
+            if (d < -r) return OUTSIDE;
+            if (d < r) result = INTERSECTING;
+        }
+        return result;
+    }
+};
+
+#endif // BOUNDS_H
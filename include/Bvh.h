@@ -0,0 +1,65 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "Bounds.h"
+
+#include <atomic>
+#include <vector>
+
+// Bounding volume hierarchy over per-object world bounds.
+// Built top down with binned SAH, then kept up to date with refit() as objects move.
+class Bvh {
+    public:
+        struct Node {
+            AABB bounds;
+            int first;      // interior: index of left child (right is first + 1). leaf: first slot in object list
+            int count;      // 0 for interior nodes
+            int parent;     // -1 for the root
+        };
+
+    private:
+        std::vector<Node> m_nodes;
+        std::vector<unsigned int> m_objects;     // leaves reference ranges of this list
+        std::vector<AABB> m_objectBounds;
+        std::vector<int> m_objectLeaf;           // object -> leaf node, for incremental refits
+        std::vector<int> m_dirtyLeaves;
+        std::vector<bool> m_leafDirty;
+        std::atomic<int> m_nodeCount;
+
+        int alloc_nodes(int count);
+        void build_recursive(int nodeIndex, unsigned int begin, unsigned int end, std::vector<glm::vec3> &centroids, int depth);
+        bool find_split(unsigned int begin, unsigned int end, const AABB &bounds, const std::vector<glm::vec3> &centroids, int &axis, float &position);
+        void refit_node(int nodeIndex);
+
+    public:
+        static const int BIN_COUNT = 16;
+        static const int MAX_LEAF_SIZE = 4;
+
+        Bvh();
+
+        /* Builds the tree from scratch. Subtrees near the root are built on the job system when it is running */
+        void build(const std::vector<AABB> &objectBounds);
+
+        /* Records new bounds for one object. Takes effect on the next refit() */
+        void update(unsigned int object, const AABB &bounds);
+
+        /* Refits only the paths from dirty leaves to the root, or the whole tree if most leaves moved */
+        void refit();
+        void refit_all();
+
+        /* Appends every object that is not fully outside the frustum. Whole subtrees inside the frustum are accepted without per-object tests */
+        void query_frustum(const Frustum &frustum, std::vector<unsigned int> &out) const;
+
+        /* Appends every object whose bounds overlap range */
+        void query_range(const AABB &range, std::vector<unsigned int> &out) const;
+
+        /* Closest object whose bounds the ray hits, or -1. Children are visited front to back */
+        int pick(const Ray &ray, float &tHit) const;
+
+        const std::vector<Node> &nodes() const { return m_nodes; }
+        const AABB &object_bounds(unsigned int object) const { return m_objectBounds[object]; }
+        unsigned int object_count() const { return (unsigned int)m_objectBounds.size(); }
+        bool empty() const { return m_nodes.empty(); }
+};
+
+#endif // BVH_H
@@ -9,15 +9,39 @@
 #include "ShaderHelper.h"
 
 namespace Camera {
+    const float NEAR_PLANE = 0.1f;
+    const float FAR_PLANE = 100.0f;
+
+    // Copy of everything needed to draw from the camera, so another thread can render while input keeps moving it
+    struct State {
+        glm::vec3 pos;
+        glm::vec3 front;
+        glm::vec3 up;
+        float yaw;
+        float pitch;
+        float zoom;
+        float windowRatio;
+    };
+
     extern glm::vec3 pos;
     extern glm::mat4 projectionMatrix;
 
     extern void set_window_ratio(float width, float height);
+    extern void init_orientation();
     extern void setup_hud(glm::vec3 lightPos, glm::vec3 lightColour);
     extern void draw_hud();
+    extern void draw_hud(const State &state);
+    /* Where the HUD arrows sit in clip space, turned against the camera's yaw and pitch */
+    extern glm::mat4 hud_rotation(const State &state);
+    extern State get_state();
+    extern glm::mat4 view_matrix(const State &state);
+    extern glm::mat4 projection_matrix(const State &state);
+    extern State interpolate(const State &from, const State &to, float t);
     extern void mouse_callback(GLFWwindow* window, double xpos, double ypos);
     extern void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
     extern glm::mat4 get_view_matrix();
+    /* Puts the camera somewhere without input, for scripted paths */
+    extern void look_at(glm::vec3 position, glm::vec3 target);
     extern void toggle_fps_movement(bool enabled);
     extern void W(float deltaTime);
     extern void A(float deltaTime);
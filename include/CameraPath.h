@@ -0,0 +1,34 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// A scripted camera flight for runs that have to be repeatable: a looping Catmull-Rom spline through keys
+// KEY_SECONDS apart, each a position and the point looked at. Either the built in orbit of the container or a
+// file with one key per line, "x y z tx ty tz". Lines starting with # are skipped.
+class CameraPath {
+    public:
+        struct Key {
+            glm::vec3 position;
+            glm::vec3 target;
+        };
+
+    private:
+        std::vector<Key> m_keys;
+
+    public:
+        /* "orbit" or the path of a key file. False if the file can't be read or has fewer than two keys */
+        bool load(const char *name);
+
+        /* Where the camera is time seconds in, the path loops */
+        Key sample(double time) const;
+        /* Puts Camera there */
+        void apply(double time) const;
+
+        /* Seconds to go round once */
+        double duration() const;
+};
+
+#endif // CAMERA_PATH_H
@@ -0,0 +1,70 @@
+#ifndef CLUSTERED_LIGHTS_H
+#define CLUSTERED_LIGHTS_H
+
+#include <glm/glm.hpp>
+
+#include "ShaderHelper.h"
+
+#include <vector>
+
+struct PointLight {
+    glm::vec3 position;
+    float radius;          // no light at all past this distance
+    glm::vec3 colour;
+};
+
+// Clustered forward lighting.
+// The view frustum is split into CLUSTERS_X x CLUSTERS_Y screen tiles and CLUSTERS_Z slices that grow exponentially
+// with depth. Every frame the CPU finds which clusters each light's sphere touches, across the job system, and
+// uploads three texture buffers: the lights, an (offset, count) pair per cluster and the packed light indices.
+// A fragment shader finds its own cluster from gl_FragCoord and only loops over the lights in it.
+class ClusteredLights {
+    public:
+        static const int CLUSTERS_X = 16;
+        static const int CLUSTERS_Y = 9;
+        static const int CLUSTERS_Z = 24;
+        static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+        static const unsigned int MAX_LIGHTS = 65535;     // indices are 16 bit
+
+        // GLSL for the fragment shader: uniforms, the texture buffers and
+        // vec3 cluster_lighting(vec3 fragPos, vec3 normal, vec3 viewPos), the summed diffuse and specular
+        static const char *shaderSource;
+
+    private:
+        // inclusive cluster ranges a light touches, x0 > x1 when it touches none
+        struct LightRange {
+            int x0, x1, y0, y1, z0, z1;
+        };
+
+        std::vector<LightRange> m_ranges;
+        std::vector<glm::vec4> m_lightData;           // two texels per light: position + radius, colour
+        std::vector<glm::uvec2> m_clusters;            // offset into m_indices, light count
+        std::vector<std::vector<unsigned short> > m_sliceIndices;
+        std::vector<unsigned short> m_indices;
+        float m_near;
+        float m_far;
+
+        unsigned int m_buffers[3];
+        unsigned int m_textures[3];
+
+    public:
+        ClusteredLights();
+        ~ClusteredLights();
+
+        /* Creates the texture buffers, needs a current context */
+        void setup();
+
+        /* Builds the cluster lists for one view. Only touches memory, so it can run before the GL work */
+        void assign(const PointLight *lights, unsigned int count, const glm::mat4 &view, const glm::mat4 &projection, float nearPlane, float farPlane);
+
+        /* Sends the last assign() to the texture buffers */
+        void upload();
+
+        /* Binds the texture buffers from firstUnit on and sets the shader's cluster uniforms */
+        void bind(ShaderHelper *shader, int firstUnit, int viewportWidth, int viewportHeight);
+
+        const std::vector<glm::uvec2> &clusters() const { return m_clusters; }
+        const std::vector<unsigned short> &indices() const { return m_indices; }
+};
+
+#endif // CLUSTERED_LIGHTS_H
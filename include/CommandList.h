@@ -0,0 +1,70 @@
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ShaderHelper.h"
+
+#include <cstring>
+#include <vector>
+
+// Packed stream of draw state and draw calls. Recording never touches GL, so any thread can fill a list.
+// Replaying issues the GL calls and must happen on the context thread.
+class CommandList {
+    public:
+        enum Op : unsigned char {
+            BIND_SHADER,
+            BIND_VAO,
+            BIND_TEXTURE,
+            UNIFORM_INT,
+            UNIFORM_FLOAT,
+            UNIFORM_VEC3,
+            UNIFORM_MAT4,
+            DRAW_ARRAYS,
+            DRAW_ELEMENTS,
+            DRAW_ARRAYS_INSTANCED,
+        };
+
+    private:
+        std::vector<unsigned char> m_data;
+        unsigned int m_drawCount;
+
+        template <typename T>
+        void push(Op op, const T &payload)
+        {
+            size_t at = m_data.size();
+            m_data.resize(at + 1 + sizeof(T));
+            m_data[at] = op;
+            memcpy(&m_data[at + 1], &payload, sizeof(T));
+        }
+
+    public:
+        CommandList();
+
+        /* Empties the list but keeps its memory for the next frame */
+        void reset();
+
+        void bind_shader(ShaderHelper *shader);
+        void bind_vao(unsigned int vao);
+        void bind_texture(unsigned int unit, unsigned int texture);
+
+        // uniform locations are looked up on the GL thread ahead of time, recording threads cannot query them
+        void set_uniform(int location, GLint i);
+        void set_uniform(int location, GLfloat f);
+        void set_uniform(int location, const glm::vec3 &v);
+        void set_uniform_matrix4(int location, const glm::mat4 &m);
+
+        void draw_arrays(GLenum mode, GLint first, GLsizei count);
+        void draw_elements(GLenum mode, GLsizei count, GLenum type, size_t offset);
+        void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+
+        unsigned int draw_count() const { return m_drawCount; }
+        size_t byte_size() const { return m_data.size(); }
+        bool empty() const { return m_data.empty(); }
+
+        /* Issues every list in order on the calling (GL) thread. Binds that repeat the current state are dropped */
+        static void replay(const CommandList *lists, unsigned int count);
+};
+
+#endif // COMMAND_LIST_H
@@ -0,0 +1,51 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+// CPU timeline of named scopes, written as Chrome trace_event JSON (open in chrome://tracing or Perfetto).
+// Only built with -DCPU_PROFILE (make PROFILE=1), otherwise every macro below is empty.
+// Each thread records into its own ring that only it writes and only the flusher thread reads, so a scope costs
+// two steady_clock reads and a store, no locks. A full ring drops events rather than blocking.
+// Names must be string literals, only the pointer is kept.
+
+#ifdef CPU_PROFILE
+
+#include <cstdint>
+
+namespace CpuProfiler {
+    /* Starts the flusher writing to path. Scopes recorded before this are dropped */
+    extern bool start(const char *path);
+    /* Writes out what is left and closes the file */
+    extern void stop();
+
+    /* Label for the calling thread in the trace */
+    extern void set_thread_name(const char *name);
+
+    extern uint64_t now_ns();
+    extern void record(const char *name, uint64_t begin, uint64_t end);
+
+    struct Scope {
+        const char *name;
+        uint64_t begin;
+
+        explicit Scope(const char *n) : name(n), begin(now_ns()) {}
+        ~Scope() { record(name, begin, now_ns()); }
+    };
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) CpuProfiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_THREAD(name) CpuProfiler::set_thread_name(name)
+#define PROFILE_START(path) CpuProfiler::start(path)
+#define PROFILE_STOP() CpuProfiler::stop()
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_START(path) ((void)0)
+#define PROFILE_STOP() ((void)0)
+
+#endif // CPU_PROFILE
+
+#endif // CPU_PROFILER_H
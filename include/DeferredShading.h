@@ -0,0 +1,68 @@
+#ifndef DEFERRED_SHADING_H
+#define DEFERRED_SHADING_H
+
+#include <glm/glm.hpp>
+
+#include "ShaderHelper.h"
+#include "ClusteredLights.h"
+#include "ShadowCache.h"
+#include "LightProbes.h"
+
+#include <vector>
+
+// Deferred lighting, the second path next to the clustered forward shader.
+// The geometry pass writes a 12 byte per pixel G-buffer through MRT:
+//   0: RGBA8  albedo, alpha is specular strength (1 marks unlit surfaces such as the light cube)
+//   1: RG16   octahedral encoded normal
+//   depth: DEPTH24_STENCIL8, world position is rebuilt from it
+// The lighting pass draws one full screen triangle for ambient and the main light, which also copies the depth
+// into the target, then every point light as an instanced box around its sphere, added on top.
+class DeferredShading {
+    public:
+        /* Fragment shader for the geometry pass. Pairs with the forward vertex shader, which
+           already outputs Normal and FragPos. Set albedo and specular per material */
+        static const char *geometryFragmentShaderSource;
+
+    private:
+        // matches the light volume instance attributes
+        struct VolumeInstance {
+            glm::vec4 positionRadius;
+            glm::vec3 colour;
+        };
+
+        unsigned int m_framebuffer;
+        unsigned int m_albedo;
+        unsigned int m_normal;
+        unsigned int m_depth;
+        int m_width;
+        int m_height;
+        unsigned int m_target;    // framebuffer to light into, whatever was bound when the geometry pass began
+
+        ShaderHelper *m_directShader;
+        ShaderHelper *m_volumeShader;
+        unsigned int m_emptyVao;
+        unsigned int m_volumeVao;
+        unsigned int m_volumeVbo;
+        unsigned int m_volumeInstances;
+        std::vector<VolumeInstance> m_volumes;
+
+        void resize(int width, int height);
+        void bind_gbuffer(ShaderHelper *shader, const glm::mat4 &inverseViewProj, const glm::vec3 &viewPos);
+
+    public:
+        DeferredShading();
+        ~DeferredShading();
+
+        /* Needs a current context */
+        void setup();
+
+        /* Binds and clears the G-buffer, resizing it first if needed */
+        void begin_geometry(int width, int height);
+
+        /* Lights the G-buffer into the framebuffer bound before begin_geometry() and leaves the
+           scene depth there for forward drawing. Only the main light is shadowed, ambient comes from the probes */
+        void light(const PointLight &mainLight, const ShadowCache &shadows, const LightProbes &probes,
+                   const PointLight *pointLights, unsigned int pointLightCount, const glm::mat4 &viewProj, const glm::vec3 &viewPos);
+};
+
+#endif // DEFERRED_SHADING_H
@@ -0,0 +1,97 @@
+#ifndef FRAME_ENCODER_H
+#define FRAME_ENCODER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes captured frames to disk on a pool of worker threads. PNG and PPM are one file per frame, named
+// frame_000123.png in a directory. Y4M (4:2:0) and raw RGB24 are single streams: workers convert frames in
+// parallel and they are written to the file in frame order from firstFrame. A frame submitted without pixels, or
+// one that fails to encode, is counted as failed and left out of the stream so the frames after it aren't held up.
+// A stream keeps the size of its first frame, frames of any other size (a resized window) are failed the same way.
+// PNGs are stored rather than deflated: bigger files, but encoding is a copy and two checksums, so it keeps up
+// with capturing every frame. submit() copies the pixels into a recycled buffer and returns; it only blocks
+// once every buffer is waiting to be encoded or written.
+class FrameEncoder {
+    public:
+        enum Format {
+            FORMAT_PNG,
+            FORMAT_PPM,
+            FORMAT_Y4M,
+            FORMAT_RAW,
+        };
+
+        // buffers per worker, how far capture may run ahead of encoding before it waits
+        static const unsigned int FRAMES_PER_WORKER = 4;
+
+        /* False for a name it doesn't know */
+        static bool parse_format(const char *name, Format &format);
+        /* Y4M and raw go to one file, the others to a directory */
+        static bool is_stream(Format format) { return format == FORMAT_Y4M || format == FORMAT_RAW; }
+
+    private:
+        struct Frame {
+            unsigned long long index;
+            int width;
+            int height;
+            std::vector<unsigned char> rgba;        // bottom row first, as GL reads it
+            std::vector<unsigned char> encoded;     // stream formats: the bytes this frame adds to the file
+        };
+
+        std::string m_path;
+        Format m_format;
+        int m_framesPerSecond;
+        std::vector<std::thread> m_workers;
+        std::mutex m_lock;
+        std::condition_variable m_queued;
+        std::condition_variable m_freed;
+        std::deque<Frame *> m_queue;
+        std::vector<Frame *> m_free;
+        std::vector<Frame *> m_frames;      // every buffer, for the destructor
+        bool m_quit;
+        std::atomic<unsigned long long> m_written;
+        std::atomic<unsigned long long> m_failed;
+
+        // stream formats, the size every frame must be, set by the first submit()
+        int m_streamWidth;
+        int m_streamHeight;
+        bool m_sizeReported;
+
+        // stream formats, guarded by m_writeLock
+        std::mutex m_writeLock;
+        FILE *m_stream;
+        bool m_headerWritten;
+        unsigned long long m_nextWrite;
+        std::map<unsigned long long, Frame *> m_ready;     // encoded, waiting for the frames before them
+        std::set<unsigned long long> m_skipped;             // will never arrive, stepped over in order
+
+        void worker_loop();
+        bool encode(Frame &frame, std::vector<unsigned char> &scratch);
+        void write_ready(bool flush);
+        void release(Frame *frame);
+        void skip(unsigned long long index);
+
+    public:
+        /* path is the directory for PNG and PPM, created if missing, or the file for Y4M and raw.
+           framesPerSecond only goes into the Y4M header */
+        FrameEncoder(const std::string &path, Format format, unsigned int workers = 1, unsigned long long firstFrame = 0, int framesPerSecond = 60);
+        ~FrameEncoder();
+
+        /* rgba is width * height RGBA pixels, bottom row first. Null for a frame that was lost, which counts as failed */
+        void submit(unsigned long long index, int width, int height, const unsigned char *rgba);
+        /* Encodes everything queued, writes it out and stops the workers */
+        void finish();
+
+        unsigned long long written() const { return m_written.load(); }
+        unsigned long long failed() const { return m_failed.load(); }
+};
+
+#endif // FRAME_ENCODER_H
@@ -0,0 +1,62 @@
+#ifndef FRAME_READBACK_H
+#define FRAME_READBACK_H
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <vector>
+
+// Reads frames back without stalling the pipeline. capture() queues a glReadPixels into the next pixel pack
+// buffer of a ring and fences it, so the copy happens on the GPU's timeline. poll() hands over every frame whose
+// fence has signalled, oldest first, usually frame N-2 or N-3 with the default ring. Only when the ring is full
+// of unfinished reads does capture() wait on the oldest one.
+// Pixels go to the sink straight out of the mapped buffer as RGBA rows, bottom row first, and must be copied
+// before it returns. A read that timed out or couldn't be mapped is still handed over, with null pixels, so the sink
+// knows not to wait for that frame. Like the rest of GL, only the thread holding the context may call these.
+class FrameReadback {
+    public:
+        static const unsigned int DEFAULT_RING_SIZE = 3;
+
+        typedef std::function<void(unsigned long long frame, int width, int height, const unsigned char *rgba)> Sink;
+
+    private:
+        struct Slot {
+            unsigned int buffer;
+            GLsync fence;
+            size_t size;            // bytes the buffer was allocated with
+            unsigned long long frame;
+            int width;
+            int height;
+        };
+
+        Sink m_sink;
+        std::vector<Slot> m_slots;
+        unsigned int m_next;        // slot the next capture goes into
+        unsigned int m_pending;     // captured but not handed over, the oldest is m_next - m_pending
+        unsigned long long m_captured;
+        unsigned long long m_stalls;
+        unsigned long long m_dropped;
+        double m_milliseconds;      // time spent in capture() and poll() on the GL thread
+
+        bool deliver(bool wait);
+
+    public:
+        FrameReadback(Sink sink, unsigned int ringSize = DEFAULT_RING_SIZE);
+        ~FrameReadback();
+
+        /* Queues a read of the bound read framebuffer, from the bottom left corner */
+        void capture(unsigned long long frame, int width, int height);
+        /* Hands over whatever has finished without waiting */
+        void poll();
+        /* Waits for every outstanding read and hands it over */
+        void flush();
+
+        unsigned long long captured() const { return m_captured; }
+        /* Captures that had to wait for the GPU because the ring was full */
+        unsigned long long stalls() const { return m_stalls; }
+        /* Reads handed over without pixels */
+        unsigned long long dropped() const { return m_dropped; }
+        double milliseconds() const { return m_milliseconds; }
+};
+
+#endif // FRAME_READBACK_H
@@ -0,0 +1,53 @@
+#ifndef GL_STATS_H
+#define GL_STATS_H
+
+#include <glad/glad.h>
+
+// Per-frame counts of every GL call made through glad.
+// install() swaps each loaded glad_gl* pointer for a wrapper that bumps that entry point's counter before calling
+// the driver, so nothing is paid until it is installed. A few entry points also look at their arguments for draw,
+// triangle, upload and redundant bind totals. Entry points glad doesn't load are hooked the same way once whoever
+// loads them passes them to add_entry_point().
+// Like the rest of GL, only the thread holding the context may call these.
+namespace GlStats {
+    enum Function {
+#define X(name) FUNCTION_##name,
+#include "GlFunctions.def"
+#undef X
+        FUNCTION_COUNT
+    };
+
+    struct FrameStats {
+        unsigned long long frame;
+        unsigned long long calls;
+        unsigned long long drawCalls;         // indirect ones included
+        unsigned long long indirectDraws;     // commands issued from a GPU buffer, their triangles are not counted
+        unsigned long long triangles;         // triangle modes only, instances included
+        unsigned long long stateChanges;      // binds, enables, blend/depth/viewport state and programs
+        unsigned long long redundantBinds;    // program, VAO or framebuffer binds of what was already bound
+        unsigned long long uniformCalls;
+        unsigned long long textureBinds;
+        unsigned long long bufferBytes;       // glBufferData/glBufferSubData
+        unsigned long long textureBytes;      // glTexImage*/glTexSubImage* from client memory
+        unsigned int functionCalls[FUNCTION_COUNT];
+    };
+
+    /* Hooks every loaded entry point. Call after glad has loaded, on the GL thread */
+    extern void install();
+    extern bool installed();
+    /* For entry points loaded outside glad, see GlFunctions.def. Hooks the pointer in place, now if install()
+       already ran, else when it does, so it has to stay where it is */
+    extern void add_entry_point(Function function, void **pointer);
+
+    /* Closes the frame: its counts become last_frame(), go out to the CSV if one is open, then start again */
+    extern void end_frame();
+    extern const FrameStats &last_frame();
+
+    extern const char *function_name(Function function);
+
+    /* One row per frame: the totals, then a column for every entry point */
+    extern bool open_csv(const char *path);
+    extern void close_csv();
+};
+
+#endif // GL_STATS_H
@@ -0,0 +1,106 @@
+#ifndef GPU_CULLER_H
+#define GPU_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include "ShaderHelper.h"
+#include "Bounds.h"
+
+#include <vector>
+
+// GPU driven culling for GL 4.3+ contexts.
+// Every instance's bounds and model matrix live in shader storage buffers. A compute pass tests each one against
+// the frustum and the previous frame's depth pyramid and appends the survivors to a per material list, bumping the
+// instance count of that material's indirect draw. The CPU then issues one indirect draw per material however big
+// the scene is. After the main pass, build_depth_pyramid() turns the frame's depth into the pyramid for next frame.
+class GpuCuller {
+    public:
+        static const unsigned int MAX_MATERIALS = 4;
+        static const unsigned int CULL_GROUP_SIZE = 64;
+        static const unsigned int PYRAMID_GROUP_SIZE = 8;
+
+        // storage buffer binding points, shared with the vertex shader that draws the survivors
+        static const unsigned int BINDING_INSTANCES = 0;
+        static const unsigned int BINDING_COMMANDS = 1;
+        static const unsigned int BINDING_VISIBLE = 2;
+        static const unsigned int BINDING_MODELS = 3;
+
+        /* Vertex shader prefix for drawing survivors: declares the model and visible buffers and a
+           model_matrix() that looks up this instance. Set visibleOffset with the value of visible_offset() */
+        static const char *drawShaderHeader;
+
+    private:
+        // matches the std430 layout in the cull shader
+        struct Instance {
+            glm::vec4 centre;    // w holds the material
+            glm::vec4 extent;
+        };
+
+        // matches DrawArraysIndirectCommand
+        struct DrawCommand {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint first;
+            GLuint baseInstance;
+        };
+
+        bool m_supported;
+        ShaderHelper *m_cullShader;
+        ShaderHelper *m_pyramidShader;
+        unsigned int m_instanceBuffer;
+        unsigned int m_modelBuffer;
+        unsigned int m_commandBuffer;
+        unsigned int m_visibleBuffer;
+        unsigned int m_instanceCapacity;
+        unsigned int m_instanceCount;
+        DrawCommand m_commands[MAX_MATERIALS];
+        std::vector<Instance> m_instances;
+
+        // previous frame's depth, then a max reduced R32F mip chain of it
+        unsigned int m_depthTexture;
+        unsigned int m_depthFramebuffer;
+        unsigned int m_pyramid;
+        int m_pyramidWidth;
+        int m_pyramidHeight;
+        int m_pyramidLevels;
+        glm::mat4 m_pyramidViewProj;
+        bool m_pyramidValid;
+
+        bool load_entry_points(GLADloadproc load);
+        void resize_pyramid(int width, int height);
+
+    public:
+        GpuCuller();
+        ~GpuCuller();
+
+        /* Needs a current context. Returns false (and does nothing from then on) below GL 4.3 */
+        bool init(GLADloadproc load);
+        bool supported() const { return m_supported; }
+
+        /* Sets what each material draws. Unset materials draw nothing */
+        void set_draw(unsigned int material, GLsizei vertexCount);
+
+        /* Replaces the instance list for this frame */
+        void upload(const glm::mat4 *models, const AABB *bounds, const unsigned char *materials, unsigned int count);
+
+        /* Runs the compute pass. The depth test is skipped until a pyramid exists or when useDepthPyramid is false */
+        void cull(const glm::mat4 &viewProj, bool useDepthPyramid);
+
+        /* Issues the indirect draw for one material with the shader and VAO already bound */
+        void draw(unsigned int material);
+        unsigned int visible_offset(unsigned int material) const { return material * m_instanceCapacity; }
+
+        /* Copies the current depth buffer of the bound draw framebuffer and reduces it. viewProj is the matrix
+           the frame was drawn with, next frame's cull projects through it */
+        void build_depth_pyramid(int width, int height, const glm::mat4 &viewProj);
+        void invalidate_depth_pyramid() { m_pyramidValid = false; }
+
+        /* Reads back the survivors of the last cull, sorted. Stalls, meant for validation */
+        void read_visible(std::vector<unsigned int> &visible);
+
+        /* Culls the uploaded instances against the frustum alone and checks the result against Frustum::test.
+           Prints the first mismatch. Runs anywhere compute does, including llvmpipe */
+        bool validate(const glm::mat4 &viewProj, const AABB *bounds);
+};
+
+#endif // GPU_CULLER_H
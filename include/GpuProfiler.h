@@ -0,0 +1,93 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// Nested GPU timings from GL_TIMESTAMP queries, which unlike GL_TIME_ELAPSED may overlap.
+// Every pass gets a timestamp at both ends. Results are read back FRAME_LATENCY frames later, and only once they
+// are available, so the CPU never waits on the GPU. A frame whose queries are still outstanding is simply not profiled.
+// Passes form a tree by name under their parent, each keeping a window of recent times for averages and percentiles.
+class GpuProfiler {
+    public:
+        static const int FRAME_LATENCY = 3;
+        static const unsigned int DEFAULT_HISTORY = 240;
+
+        struct PassStats {
+            std::string name;
+            int depth;                  // 0 for the whole frame
+            unsigned int samples;       // up to the history size
+            double averageMs;
+            double p50Ms;
+            double p95Ms;
+            double p99Ms;
+        };
+
+        // times a pass from construction to the end of the enclosing block
+        class Scope {
+            private:
+                GpuProfiler &m_profiler;
+
+            public:
+                Scope(GpuProfiler &profiler, const char *name) : m_profiler(profiler) { m_profiler.push(name); }
+                ~Scope() { m_profiler.pop(); }
+        };
+
+    private:
+        struct Node {
+            std::string name;
+            int parent;
+            std::vector<int> children;
+            std::vector<float> history;     // ring of the last m_historySize times in ms
+            unsigned int next;
+            unsigned int count;
+        };
+
+        struct Event {
+            int node;
+            unsigned int begin;
+            unsigned int end;
+        };
+
+        struct Frame {
+            std::vector<Event> events;      // events[0] is the whole frame, its end query is issued last
+            bool pending;
+        };
+
+        std::vector<Node> m_nodes;
+        std::vector<unsigned int> m_queries;        // every query ever made, for the destructor
+        std::vector<unsigned int> m_freeQueries;
+        Frame m_frames[FRAME_LATENCY];
+        unsigned int m_frameIndex;
+        bool m_recording;
+        std::vector<unsigned int> m_stack;          // open events of the current frame
+        unsigned int m_historySize;
+
+        unsigned int acquire_query();
+        int child(int parent, const char *name);
+        void resolve(Frame &frame);
+        void node_stats(int node, int depth, std::vector<PassStats> &out) const;
+
+    public:
+        explicit GpuProfiler(unsigned int historySize = DEFAULT_HISTORY);
+        ~GpuProfiler();
+
+        /* Reads back whatever has finished, then opens the frame's root pass */
+        void begin_frame();
+        void end_frame();
+
+        /* Passes nest, every push needs a pop in the same frame */
+        void push(const char *name);
+        void pop();
+
+        /* Folds in finished frames without waiting, begin_frame() already does this */
+        void collect();
+
+        /* Every pass seen so far, depth first with children in the order they first ran */
+        void stats(std::vector<PassStats> &out) const;
+        void print() const;
+};
+
+#endif // GPU_PROFILER_H
@@ -0,0 +1,53 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#ifdef HEADLESS_EGL
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+
+// GL context with no window, for machines without a display or a GPU (Mesa llvmpipe works).
+// Prefers Mesa's surfaceless platform and falls back to the default display, either way without a surface,
+// so the scene is drawn into a framebuffer object of a fixed size instead.
+class HeadlessContext {
+    private:
+        EGLDisplay m_display;
+        EGLContext m_context;
+        unsigned int m_framebuffer;
+        unsigned int m_colour;
+        unsigned int m_depth;
+        int m_width;
+        int m_height;
+
+        bool create_framebuffer();
+
+    public:
+        HeadlessContext();
+        ~HeadlessContext();
+
+        /* Creates the context, makes it current on this thread, loads GL and builds the framebuffer */
+        bool create(int width, int height);
+        void destroy();
+
+        /* Moves the context between threads, release on the old one before making it current on the new one */
+        bool make_current();
+        void release();
+
+        /* Binds the framebuffer the frame is drawn into, the stand in for a window's back buffer */
+        void bind() const;
+
+        /* Blocking read of the last frame as tightly packed RGB rows, bottom row first */
+        void read_pixels(unsigned char *rgb) const;
+        /* Binary PPM of the last frame */
+        bool save_ppm(const char *path) const;
+
+        int width() const { return m_width; }
+        int height() const { return m_height; }
+
+        /* Loader for glad and GpuCuller::init */
+        static void *get_proc_address(const char *name);
+};
+
+#endif // HEADLESS_EGL
+
+#endif // HEADLESS_CONTEXT_H
@@ -0,0 +1,118 @@
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <glad/glad.h>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// How long input takes to reach the screen, split by where the time goes. The thread handling events stamps each
+// input as it arrives, again when a simulation step takes it in and when the state goes out in a snapshot. The GL
+// thread stamps the frame that picks the snapshot up, when its draw calls are issued and when the swap returns,
+// and drops a GL_TIMESTAMP query after the draw calls for when the GPU finished them. Queries are read back a few
+// frames late. Only when QUERY_RING frames are still outstanding does it wait, and then just for the oldest.
+// A frame is measured from the oldest input it is the first to show, frames with no new input are not measured.
+// The stages add up to the total:
+//   poll    arrived, until a simulation step took it in
+//   queue   published and waiting for the render thread to pick the snapshot up
+//   submit  the render thread drawing
+//   swap    inside the swap, blocked on vsync or a GPU that is behind
+//   gpu     the GPU still working on the frame after the swap returned
+// Times are seconds on the steady clock, both threads share it.
+class InputLatency {
+    public:
+        enum Stage {
+            STAGE_POLL,
+            STAGE_QUEUE,
+            STAGE_SUBMIT,
+            STAGE_SWAP,
+            STAGE_GPU,
+            STAGE_TOTAL,
+            STAGE_COUNT
+        };
+
+        static const unsigned int QUERY_RING = 8;
+        // histogram buckets in ms, the last one takes everything longer
+        static const unsigned int BUCKET_MS = 4;
+        static const unsigned int BUCKETS = 26;
+
+        struct Sample {
+            unsigned long long frame;       // render frame, counted from the first
+            unsigned int inputs;            // inputs this frame was the first to show
+            double ms[STAGE_COUNT];
+        };
+
+    private:
+        // everything that arrived between two publishes, timed from the first of them
+        struct Batch {
+            unsigned long long sequence;    // publish it went out in
+            unsigned int inputs;
+            double input;
+            double applied;
+            double published;
+        };
+
+        struct Frame {
+            Sample sample;
+            double input;
+            double applied;
+            double picked;
+            double submitted;
+            double swapped;
+            unsigned int query;
+        };
+
+        // event thread only
+        unsigned int m_inputs;          // arrived since the last publish
+        double m_firstInput;
+        double m_firstApplied;          // 0 until a step takes the first of them in
+        unsigned long long m_sequence;
+
+        // handed from the event thread to the GL thread
+        std::mutex m_lock;
+        std::deque<Batch> m_batches;
+
+        // GL thread only
+        unsigned long long m_frame;
+        bool m_measuring;               // the current frame has new input
+        Frame m_current;
+        std::deque<Frame> m_inFlight;   // swapped, waiting on their queries
+        std::vector<unsigned int> m_freeQueries;
+        std::vector<unsigned int> m_queries;
+        unsigned long long m_waits;
+
+        std::vector<Sample> m_samples;
+
+        bool resolve_oldest(bool wait);
+        void resolve(Frame &frame, double gpu);
+
+    public:
+        InputLatency();
+
+        static double now();
+
+        /* Event thread. An input arrived */
+        void input();
+        /* A simulation step took in everything that arrived so far */
+        void applied();
+        /* A snapshot with everything applied so far goes out. Returns the sequence to carry in it */
+        unsigned long long published();
+
+        /* GL thread. The snapshot about to be drawn went out with sequence, 0 for one that wasn't measured */
+        void frame_begin(unsigned long long sequence);
+        /* The frame's draw calls are issued, stamps the GPU's timeline after them */
+        void frame_submitted();
+        void frame_swapped();
+        /* Reads back finished queries, waits for the rest when wait is set */
+        void collect(bool wait);
+        /* Waits for every query and deletes them, before the context goes */
+        void finish();
+
+        /* After finish(). One row per measured frame */
+        bool write_csv(const char *path) const;
+        /* Percentiles of every stage and a histogram of the total */
+        void print() const;
+};
+
+#endif // INPUT_LATENCY_H
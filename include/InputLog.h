@@ -0,0 +1,62 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <cstdio>
+#include <vector>
+
+// Every input the simulation saw, written to a small binary file so a session can be played back exactly.
+// Events are stamped with the simulation step they arrived after as well as the clock. Replay hands each
+// one back just before the following step, so the replayed simulation matches the recording bit for bit
+// however fast it is played. Key state is logged only when it changes.
+// The file is the host's byte order, a log is replayed on the kind of machine it was recorded on.
+class InputLog {
+    public:
+        enum EventType : unsigned char {
+            EVENT_CURSOR,       // x, y: cursor position
+            EVENT_SCROLL,       // x, y: scroll offsets
+            EVENT_KEYS,         // keys: bitmask of the keys held down for the following steps
+            EVENT_RESIZE,       // x, y: framebuffer size
+            EVENT_END,          // the session stopped after this step
+        };
+
+        struct Event {
+            EventType type;
+            unsigned long long step;
+            double time;        // seconds since recording started
+            double x;
+            double y;
+            unsigned int keys;
+        };
+
+    private:
+        FILE *m_file;
+        unsigned long long m_lastStep;
+        unsigned int m_lastKeys;
+        std::vector<Event> m_events;
+        size_t m_next;
+
+        void write_event(const Event &event);
+
+    public:
+        InputLog();
+        ~InputLog();
+
+        /* Recording */
+        bool open(const char *path);
+        bool recording() const { return m_file != nullptr; }
+        void record(EventType type, unsigned long long step, double time, double x, double y);
+        /* Only written when the mask differs from the last one */
+        void record_keys(unsigned long long step, double time, unsigned int keys);
+        void close(unsigned long long step, double time);
+
+        /* Replay */
+        bool load(const char *path);
+        bool replaying() const { return !m_events.empty(); }
+        /* The next event that arrived at or before step, false once there are none left for it */
+        bool next(unsigned long long step, Event &event);
+        /* Step the recording stopped at */
+        unsigned long long end_step() const;
+        bool finished(unsigned long long step) const { return step >= end_step(); }
+};
+
+#endif // INPUT_LOG_H
@@ -0,0 +1,49 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Work-stealing job scheduler. Every worker owns a deque: it pushes and pops its own jobs at the back
+// while idle workers steal from the front. The thread that calls init() is worker 0 and only runs jobs
+// while it is blocked in wait() or parallel_for(), so the GL thread never gets stuck in a long job.
+namespace JobSystem {
+    typedef std::function<void()> Job;
+
+    // Counts unfinished jobs. Jobs queued with a dependency start once that counter reaches zero
+    struct Counter {
+        std::atomic<int> value;
+        std::mutex lock;
+        std::vector<Job> continuations;
+        std::vector<Counter *> continuationCounters;
+
+        Counter() : value(0) {}
+        bool done() const { return value.load(std::memory_order_acquire) == 0; }
+    };
+
+    /* Starts the workers. workers == 0 starts one per hardware thread, minus the calling thread */
+    extern void init(unsigned int workers = 0);
+    extern void shutdown();
+    extern bool running();
+
+    /* Number of threads that run jobs, including the thread that called init() */
+    extern unsigned int thread_count();
+
+    /* 0 on the thread that called init(), 1..n on workers */
+    extern unsigned int thread_index();
+
+    /* Queues a job. counter (optional) is incremented now and decremented when the job finishes.
+       If dependency is given the job is held back until that counter reaches zero */
+    extern void run(Job job, Counter *counter = nullptr, Counter *dependency = nullptr);
+
+    /* Runs other jobs until counter reaches zero */
+    extern void wait(Counter *counter);
+
+    /* Calls fn(begin, end) over [0, count) in chunks of at most grain, across every thread. Blocks until done.
+       Runs inline when the job system is not running or the range fits in one chunk */
+    extern void parallel_for(unsigned int count, unsigned int grain, const std::function<void(unsigned int begin, unsigned int end)> &fn);
+};
+
+#endif // JOB_SYSTEM_H
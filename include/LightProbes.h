@@ -0,0 +1,88 @@
+#ifndef LIGHT_PROBES_H
+#define LIGHT_PROBES_H
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "MeshBvh.h"
+#include "ShaderHelper.h"
+
+#include <vector>
+
+// Grid of irradiance probes for the ambient term.
+// Every probe traces the static geometry in a fixed set of directions and projects what it sees onto L2 spherical
+// harmonics, four directions per SIMD step. The 27 coefficients, already convolved with the cosine lobe, are
+// packed into seven RGBA 3D textures so the shader gets trilinear blending between probes for free.
+// Probes are only re-baked when the light moves or geometry near them changes, a few per frame.
+class LightProbes {
+    public:
+        static const int GRID_X = 8;
+        static const int GRID_Y = 4;
+        static const int GRID_Z = 8;
+        static const int PROBE_COUNT = GRID_X * GRID_Y * GRID_Z;
+        static const int SAMPLES = 256;              // directions per probe, a multiple of 4
+        static const int PROBES_PER_FRAME = 32;
+        static const int TEXTURE_COUNT = 7;          // 9 RGB coefficients in RGBA texels
+        static const int COEFFICIENTS = 9;
+        // first of the TEXTURE_COUNT units every lighting shader samples the probes from: after the shadow map and
+        // the container's lightmap, so both paths can share it
+        static const int TEXTURE_UNIT = 7;
+
+        // GLSL: the probe uniforms and vec3 probe_irradiance(vec3 position, vec3 normal)
+        static const char *shaderSource;
+
+    private:
+        AABB m_bounds;
+        glm::vec3 m_spacing;
+        unsigned int m_textures[TEXTURE_COUNT];
+
+        // the direction set and its SH basis, structure of arrays so four directions load at once
+        std::vector<glm::vec3> m_directions;
+        std::vector<float> m_basis;                  // COEFFICIENTS rows of SAMPLES values
+
+        MeshBvh m_bvh;
+        std::vector<glm::vec3> m_triangleNormals;
+        std::vector<glm::vec3> m_triangleAlbedos;
+        glm::vec3 m_lightPos;
+        glm::vec3 m_lightColour;
+        bool m_hasLight;
+
+        std::vector<unsigned char> m_dirty;
+        std::vector<unsigned int> m_batch;
+        unsigned int m_dirtyCount;
+        unsigned int m_cursor;                       // round robin start, so no probe waits forever
+        std::vector<glm::vec4> m_texels;             // TEXTURE_COUNT blocks of PROBE_COUNT texels
+        bool m_uploadPending;
+
+        glm::vec3 probe_position(unsigned int probe) const;
+        glm::vec3 radiance(const glm::vec3 &origin, const glm::vec3 &dir) const;
+        void bake(unsigned int probe);
+
+    public:
+        explicit LightProbes(const AABB &bounds);
+        ~LightProbes();
+
+        /* Needs a current context */
+        void setup();
+
+        /* Replaces the traced geometry, three positions per triangle and one albedo per triangle.
+           Doesn't dirty anything by itself, say where it changed with invalidate() */
+        void set_geometry(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &albedos);
+
+        /* Dirties every probe when the light moved */
+        void set_light(const glm::vec3 &position, const glm::vec3 &colour);
+
+        /* Dirties the probes close enough to region to see a change in it */
+        void invalidate(const AABB &region);
+        void invalidate_all();
+
+        /* Re-bakes up to PROBES_PER_FRAME dirty probes across the job system and uploads them */
+        void update();
+
+        /* Binds the probe textures to TEXTURE_COUNT units from firstUnit and sets the grid uniforms */
+        void bind(ShaderHelper *shader, int firstUnit) const;
+
+        unsigned int dirty_count() const { return m_dirtyCount; }
+};
+
+#endif // LIGHT_PROBES_H
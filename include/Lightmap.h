@@ -0,0 +1,24 @@
+#ifndef LIGHTMAP_H
+#define LIGHTMAP_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Baked lighting for one static mesh, written by tools/bake_lightmap.cpp and read by the renderer.
+// File layout, little endian: magic, version, width, height, uv count, then the uvs as float pairs
+// and the texels as float RGB triples, bottom row first like a GL upload.
+struct Lightmap {
+    static const unsigned int MAGIC = 0x50414D4C;     // "LMAP"
+    static const unsigned int VERSION = 1;
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<glm::vec2> uvs;       // one per mesh vertex, in draw order
+    std::vector<glm::vec3> texels;    // light reaching the surface, multiplied by the albedo when drawn
+
+    bool save(const char *path) const;
+    bool load(const char *path);
+};
+
+#endif // LIGHTMAP_H
@@ -0,0 +1,71 @@
+#ifndef MESH_BVH_H
+#define MESH_BVH_H
+
+#include "Bounds.h"
+
+#include <vector>
+
+// Triangle BVH for ray tracing static meshes on the CPU, used by the lightmap baker.
+// Built as a binary SAH tree, then collapsed into a 4-wide tree so one SIMD test covers all four child boxes.
+// Leaves hold up to four triangles packed the same way and tested together.
+class MeshBvh {
+    public:
+        struct Hit {
+            float t;
+            unsigned int triangle;
+            float u;        // barycentrics of vertices 1 and 2
+            float v;
+        };
+
+    private:
+        // children < 0 are leaves, ~child is the packet index. Unused lanes have an empty box
+        struct Node4 {
+            float minX[4], minY[4], minZ[4];
+            float maxX[4], maxY[4], maxZ[4];
+            int child[4];
+        };
+
+        // four triangles as a vertex and two edges each, unused lanes are degenerate
+        struct Triangle4 {
+            float v0x[4], v0y[4], v0z[4];
+            float e1x[4], e1y[4], e1z[4];
+            float e2x[4], e2y[4], e2z[4];
+            unsigned int id[4];
+        };
+
+        struct BuildNode {
+            AABB bounds;
+            int left;       // -1 for leaves
+            int right;
+            unsigned int first;
+            unsigned int count;
+        };
+
+        std::vector<Node4> m_nodes;
+        std::vector<Triangle4> m_packets;
+        unsigned int m_triangleCount;
+
+        int build_binary(std::vector<BuildNode> &nodes, std::vector<unsigned int> &order, const std::vector<AABB> &bounds,
+                         const std::vector<glm::vec3> &centroids, unsigned int begin, unsigned int end, int depth);
+        int collapse(const std::vector<BuildNode> &nodes, int node, const std::vector<unsigned int> &order, const std::vector<glm::vec3> &positions);
+        bool traverse(const Ray &ray, Hit &hit, bool anyHit) const;
+
+    public:
+        static const int MAX_LEAF_SIZE = 4;
+        static const int BIN_COUNT = 16;
+
+        MeshBvh();
+
+        /* Three positions per triangle */
+        void build(const std::vector<glm::vec3> &positions);
+
+        /* Closest hit along the ray, up to ray.tMax */
+        bool intersect(const Ray &ray, Hit &hit) const;
+
+        /* True if anything is hit before ray.tMax, stops at the first one */
+        bool occluded(const Ray &ray) const;
+
+        unsigned int triangle_count() const { return m_triangleCount; }
+};
+
+#endif // MESH_BVH_H
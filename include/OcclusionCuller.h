@@ -0,0 +1,69 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Bvh.h"
+
+#include <vector>
+
+// Software occlusion culling against a small CPU depth buffer.
+// The biggest occluders are rasterised (4 pixels at a time) into a WIDTH x HEIGHT buffer, one job per row of tiles.
+// Each TILE_SIZE square tile also keeps its farthest depth, so most hidden objects are rejected from the tiles alone.
+class OcclusionCuller {
+    public:
+        static const int WIDTH = 256;
+        static const int HEIGHT = 128;
+        static const int TILE_SIZE = 8;
+        static const int TILES_X = WIDTH / TILE_SIZE;
+        static const int TILES_Y = HEIGHT / TILE_SIZE;
+        static const unsigned int MAX_OCCLUDERS = 32;
+
+    private:
+        struct Occluder {
+            const glm::vec3 *vertices;
+            const unsigned int *indices;
+            unsigned int indexCount;
+            glm::mat4 model;
+            float screenArea;
+        };
+
+        // screen space triangle, x/y in pixels, z is depth in [0, 1]
+        struct ScreenTriangle {
+            glm::vec3 v[3];
+            bool valid;
+        };
+
+        glm::mat4 m_viewProj;
+        std::vector<Occluder> m_occluders;
+        std::vector<ScreenTriangle> m_triangles;
+        std::vector<float> m_depth;       // WIDTH * HEIGHT, cleared to 1 (far)
+        std::vector<float> m_tileMax;     // TILES_X * TILES_Y, farthest depth in each tile
+
+        bool project(const AABB &bounds, int &x0, int &y0, int &x1, int &y1, float &nearest) const;
+        void rasterize_band(int tileRow);
+
+    public:
+        OcclusionCuller();
+
+        /* Clears the buffer and the occluder list for a new view */
+        void begin(const glm::mat4 &viewProj);
+
+        /* Adds a candidate occluder. The mesh must stay alive until rasterize() returns.
+           Only the MAX_OCCLUDERS with the largest projected bounds are drawn */
+        void add_occluder(const glm::vec3 *vertices, const unsigned int *indices, unsigned int indexCount, const glm::mat4 &model, const AABB &worldBounds);
+
+        /* Draws the chosen occluders into the depth buffer across the job system */
+        void rasterize();
+
+        /* False only if the box is certainly hidden behind the rasterised occluders */
+        bool is_visible(const AABB &bounds) const;
+
+        /* Removes hidden objects from a list of BVH object indices, testing in parallel */
+        void cull(std::vector<unsigned int> &objects, const Bvh &bvh) const;
+
+        const float *depth_buffer() const { return m_depth.data(); }
+};
+
+#endif // OCCLUSION_CULLER_H
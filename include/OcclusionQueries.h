@@ -0,0 +1,64 @@
+#ifndef OCCLUSION_QUERIES_H
+#define OCCLUSION_QUERIES_H
+
+#include <glm/glm.hpp>
+
+#include "ShaderHelper.h"
+#include "Bounds.h"
+
+#include <functional>
+#include <vector>
+
+// Hardware occlusion culling for expensive objects, GL 3.3 only.
+// An object that was visible recently is drawn normally with a query wrapped around the real draw.
+// Any other object gets its bounding box drawn under a query with colour and depth writes off, and the real
+// draw is predicated on that query with conditional rendering, so it still appears the frame it comes into view.
+// Results are only read once the GPU says they are available, at least a frame later, and never waited on.
+class OcclusionQueries {
+    public:
+        static const unsigned int LATENCY = 3;          // queries per object, one per frame in flight
+        static const unsigned int VISIBLE_HOLD = 8;     // frames an object stays trusted as visible after a hit
+
+    private:
+        struct Slot {
+            unsigned int queries[LATENCY];
+            unsigned long long issuedFrame[LATENCY];
+            bool pending[LATENCY];
+            unsigned long long lastResultFrame;   // frame the newest result read back was issued in
+            unsigned int hold;                    // frames left before a miss can mark the object hidden
+        };
+
+        std::vector<Slot> m_slots;
+        ShaderHelper *m_proxyShader;
+        int m_mvpLocation;
+        unsigned int m_proxyVao;
+        unsigned int m_proxyVbo;
+        unsigned long long m_frame;
+        glm::mat4 m_viewProj;
+        glm::vec3 m_eye;
+        float m_nearDistance;
+        unsigned int m_proxiesDrawn;
+
+        Slot &slot(unsigned int object);
+        void poll(Slot &s);
+        void draw_proxy(const AABB &bounds);
+
+    public:
+        OcclusionQueries();
+        ~OcclusionQueries();
+
+        /* Needs a current context */
+        void setup();
+
+        /* Starts a frame and picks up any results that have come back */
+        void begin_frame(const glm::mat4 &viewProj, const glm::vec3 &eye, float nearDistance);
+
+        /* Draws object through drawObject, either directly or predicated on a proxy query of its world bounds.
+           Call after the cheap occluders are drawn so there is depth to test the proxies against */
+        void draw(unsigned int object, const AABB &bounds, const std::function<void()> &drawObject);
+
+        /* Objects drawn behind a proxy this frame, the ones the last results could not vouch for */
+        unsigned int proxies_drawn() const { return m_proxiesDrawn; }
+};
+
+#endif // OCCLUSION_QUERIES_H
@@ -0,0 +1,62 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "ClusteredLights.h"
+
+#include <vector>
+
+// Owns every GL object used to draw the scene. All functions must be called on the thread that holds the context.
+namespace Renderer {
+    enum Material : unsigned char {
+        MATERIAL_CONTAINER,
+        MATERIAL_LIGHT,
+        // the container lit from its lightmap, only right where it was baked: at the origin, unrotated and unscaled
+        MATERIAL_BAKED_CONTAINER,
+        MATERIAL_COUNT
+    };
+
+    // Everything one frame needs, produced by the simulation thread and handed over through a TripleBuffer.
+    // Holds the last two simulation steps so the renderer can blend between them at any frame rate
+    struct FrameSnapshot {
+        unsigned long long frame = 0;     // simulation step of the newer state
+        double stateTime = 0.0;           // clock time the newer state belongs to
+        double stepSeconds = 1.0;
+        unsigned long long latencySequence = 0;    // InputLatency::published() for this state, 0 when not measured
+        Camera::State camera;
+        Camera::State previousCamera;
+        glm::vec3 lightPos;
+        float mixPercent;
+        int framebufferWidth = 0;
+        int framebufferHeight = 0;
+        bool gpuCulling = true;           // cull on the GPU when the context supports it
+        bool deferredShading = false;     // G-buffer and light volumes instead of clustered forward
+
+        std::vector<glm::mat4> worldMatrices;    // one per scene object
+        std::vector<glm::mat4> previousWorldMatrices;
+        std::vector<Material> materials;         // one per scene object
+        std::vector<unsigned char> dynamicObjects;    // one per scene object, expected to move every frame
+        unsigned long long staticVersion = 0;    // changes whenever an object not marked dynamic moves
+        std::vector<unsigned int> visibleObjects;
+
+        std::vector<PointLight> pointLights;    // lit through the clusters, and drawn as small instanced cubes
+        std::vector<PointLight> previousPointLights;
+    };
+
+    /* loadProc finds GL entry points for the parts that load their own, GLFW's or EGL's */
+    extern bool setup(glm::vec3 lightPos, GLADloadproc loadProc);
+    /* alpha blends from the previous state (0) to the newer one (1) */
+    extern void draw_frame(const FrameSnapshot &snapshot, float alpha);
+    /* Frustum culls the snapshot's newer state on the GPU and checks it against the CPU test, see GpuCuller::validate.
+       Stalls on the readback. False on a mismatch or when the context can't cull on the GPU */
+    extern bool validate_gpu_culling(const FrameSnapshot &snapshot);
+    /* How many times since setup the shadow cache redrew its static and its dynamic casters, see ShadowCache */
+    extern unsigned long long shadow_static_renders();
+    extern unsigned long long shadow_dynamic_renders();
+    extern void shutdown();
+};
+
+#endif // RENDERER_H
@@ -0,0 +1,59 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Transform hierarchy stored as parallel arrays sorted by depth, so every parent sits before its children
+// and local-to-world propagation is one forward pass per level.
+// Nodes are referred to by stable ids. Storage indices change when new nodes force a re-sort.
+class SceneGraph {
+    public:
+        typedef unsigned int NodeId;
+        static const NodeId NO_PARENT = 0xFFFFFFFF;
+
+    private:
+        // indexed by storage slot
+        std::vector<unsigned int> m_parent;      // storage slot of the parent, or NO_PARENT
+        std::vector<unsigned int> m_depth;
+        std::vector<glm::mat4> m_local;
+        std::vector<glm::mat4> m_world;
+        std::vector<unsigned char> m_dirty;      // local matrix changed since the last update
+        std::vector<unsigned char> m_changed;    // world matrix was recomputed by the last update
+        std::vector<NodeId> m_slotToId;
+
+        std::vector<unsigned int> m_idToSlot;
+        std::vector<unsigned int> m_levelStart;  // first slot of each depth, plus one past the end
+        unsigned int m_dirtyCount;
+        bool m_anyChanged;
+        bool m_needsSort;
+
+        void sort_by_depth();
+        void update_range(unsigned int begin, unsigned int end);
+
+    public:
+        SceneGraph();
+
+        NodeId create_node(NodeId parent = NO_PARENT, const glm::mat4 &local = glm::mat4(1.0f));
+        void set_local(NodeId node, const glm::mat4 &local);
+
+        /* Recomputes world matrices of dirty nodes and everything under them, one level at a time.
+           Large levels are split across the job system */
+        void update();
+
+        const glm::mat4 &local(NodeId node) const { return m_local[m_idToSlot[node]]; }
+        const glm::mat4 &world(NodeId node) const { return m_world[m_idToSlot[node]]; }
+
+        /* True if the last update() moved this node, directly or through an ancestor */
+        bool changed(NodeId node) const { return m_changed[m_idToSlot[node]] != 0; }
+
+        /* World matrices of every node in one contiguous array, in storage order.
+           Valid until the next create_node() or update() */
+        const glm::mat4 *world_matrices() const { return m_world.data(); }
+        unsigned int slot(NodeId node) const { return m_idToSlot[node]; }
+        unsigned int size() const { return (unsigned int)m_world.size(); }
+        unsigned int level_count() const { return m_levelStart.empty() ? 0 : (unsigned int)m_levelStart.size() - 1; }
+};
+
+#endif // SCENE_GRAPH_H
@@ -10,6 +10,11 @@
 #include <vector>
 #include <cassert>
 
+// glad only loads GL 3.3, compute shaders are used when the context turns out to be 4.3+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+
 class ShaderHelper {
     private:
         unsigned int m_shaderProgram;
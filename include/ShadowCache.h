@@ -0,0 +1,69 @@
+#ifndef SHADOW_CACHE_H
+#define SHADOW_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include "ShaderHelper.h"
+
+#include <functional>
+
+// Shadow map for the main light with static and dynamic casters kept apart.
+// Static casters are drawn into a cached depth map only when the light or the static geometry changes.
+// When there are dynamic casters, the cache is blitted into a second map each frame they move and they are drawn
+// on top. When nothing moved since the last frame both maps are left alone and shadows cost nothing.
+// The light is a perspective spot aimed at the scene rather than a cube map: every caster sits on one side of it.
+class ShadowCache {
+    public:
+        static const int SIZE = 2048;
+        // the unit every lighting shader samples the map from: after the material textures and ClusteredLights'
+        // buffers in the forward path, after the G-buffer in the deferred one
+        static const int TEXTURE_UNIT = 5;
+
+        // GLSL: the shadow map uniforms and float shadow_factor(vec3 fragPos, vec3 normal), 1 when fully lit
+        static const char *shaderSource;
+
+    private:
+        unsigned int m_cacheTexture;
+        unsigned int m_cacheFramebuffer;
+        unsigned int m_dynamicTexture;
+        unsigned int m_dynamicFramebuffer;
+        unsigned int m_current;          // the map lighting samples this frame
+        ShaderHelper *m_depthShader;
+        int m_modelLocation;
+
+        bool m_cacheValid;
+        bool m_dynamicValid;
+        glm::vec3 m_lightPos;
+        glm::vec3 m_target;
+        unsigned long long m_staticVersion;
+        glm::mat4 m_lightViewProj;
+
+        unsigned long long m_staticRenders;
+        unsigned long long m_dynamicRenders;
+
+        void render(unsigned int framebuffer, bool clear, bool dynamic, const std::function<void(bool dynamic)> &drawCasters);
+
+    public:
+        ShadowCache();
+        ~ShadowCache();
+
+        /* Needs a current context */
+        void setup();
+
+        /* Brings the shadow map up to date. drawCasters(dynamic) is called with the depth shader bound and should
+           draw_caster() every static or every dynamic caster. staticVersion must change whenever a static caster
+           moves, dynamicMoved is whether any dynamic caster is somewhere other than last frame */
+        void update(const glm::vec3 &lightPos, const glm::vec3 &target, unsigned long long staticVersion,
+                    bool hasDynamic, bool dynamicMoved, const std::function<void(bool dynamic)> &drawCasters);
+
+        /* For use inside drawCasters */
+        void draw_caster(const glm::mat4 &model, unsigned int vao, GLsizei vertexCount);
+
+        /* Binds the current map to a texture unit and sets the shader's shadow uniforms */
+        void bind(ShaderHelper *shader, int unit) const;
+
+        unsigned long long static_renders() const { return m_staticRenders; }
+        unsigned long long dynamic_renders() const { return m_dynamicRenders; }
+};
+
+#endif // SHADOW_CACHE_H
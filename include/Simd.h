@@ -0,0 +1,101 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Minimal 4-wide float vector used by the CPU culling and baking code.
+// SSE on x86, NEON on ARM (the Apple silicon build), plain arrays anywhere else.
+// Comparisons return lane masks that only make sense to v_and, v_or, v_select and v_any.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+typedef __m128 vfloat;
+
+inline vfloat v_set(float f) { return _mm_set1_ps(f); }
+inline vfloat v_set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+inline vfloat v_load(const float *p) { return _mm_loadu_ps(p); }
+inline void v_store(float *p, vfloat v) { _mm_storeu_ps(p, v); }
+inline vfloat v_add(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+inline vfloat v_sub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+inline vfloat v_mul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+inline vfloat v_div(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+inline vfloat v_min(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+inline vfloat v_max(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+inline vfloat v_ge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+inline vfloat v_le(vfloat a, vfloat b) { return _mm_cmple_ps(a, b); }
+inline vfloat v_and(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+inline vfloat v_or(vfloat a, vfloat b) { return _mm_or_ps(a, b); }
+inline vfloat v_select(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline int v_mask(vfloat mask) { return _mm_movemask_ps(mask); }
+
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+
+typedef float32x4_t vfloat;
+
+inline vfloat v_set(float f) { return vdupq_n_f32(f); }
+inline vfloat v_set(float a, float b, float c, float d) { float f[4] = {a, b, c, d}; return vld1q_f32(f); }
+inline vfloat v_load(const float *p) { return vld1q_f32(p); }
+inline void v_store(float *p, vfloat v) { vst1q_f32(p, v); }
+inline vfloat v_add(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+inline vfloat v_sub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+inline vfloat v_mul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+inline vfloat v_div(vfloat a, vfloat b) { return vdivq_f32(a, b); }
+inline vfloat v_min(vfloat a, vfloat b) { return vminq_f32(a, b); }
+inline vfloat v_max(vfloat a, vfloat b) { return vmaxq_f32(a, b); }
+inline vfloat v_ge(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+inline vfloat v_le(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcleq_f32(a, b)); }
+inline vfloat v_and(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline vfloat v_or(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline vfloat v_select(vfloat mask, vfloat a, vfloat b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+inline int v_mask(vfloat mask)
+{
+    uint32x4_t m = vshrq_n_u32(vreinterpretq_u32_f32(mask), 31);
+    return vgetq_lane_u32(m, 0) | (vgetq_lane_u32(m, 1) << 1) | (vgetq_lane_u32(m, 2) << 2) | (vgetq_lane_u32(m, 3) << 3);
+}
+
+#else
+#include <cstring>
+
+struct vfloat { float f[4]; };
+
+inline vfloat v_set(float f) { return vfloat{{f, f, f, f}}; }
+inline vfloat v_set(float a, float b, float c, float d) { return vfloat{{a, b, c, d}}; }
+inline vfloat v_load(const float *p) { vfloat v; memcpy(v.f, p, sizeof(v.f)); return v; }
+inline void v_store(float *p, vfloat v) { memcpy(p, v.f, sizeof(v.f)); }
+
+#define SIMD_LANEWISE(name, expr) \
+    inline vfloat name(vfloat a, vfloat b) { vfloat r; for (int i = 0; i < 4; i++) { float x = a.f[i], y = b.f[i]; r.f[i] = (expr); } return r; }
+
+inline float lane_mask(bool b) { unsigned int u = b ? 0xFFFFFFFFu : 0u; float f; memcpy(&f, &u, sizeof(f)); return f; }
+inline bool lane_set(float f) { unsigned int u; memcpy(&u, &f, sizeof(u)); return (u >> 31) != 0; }
+
+SIMD_LANEWISE(v_add, x + y)
+SIMD_LANEWISE(v_sub, x - y)
+SIMD_LANEWISE(v_mul, x * y)
+SIMD_LANEWISE(v_div, x / y)
+SIMD_LANEWISE(v_min, x < y ? x : y)
+SIMD_LANEWISE(v_max, x > y ? x : y)
+SIMD_LANEWISE(v_ge, lane_mask(x >= y))
+SIMD_LANEWISE(v_le, lane_mask(x <= y))
+SIMD_LANEWISE(v_and, lane_mask(lane_set(x) && lane_set(y)))
+SIMD_LANEWISE(v_or, lane_mask(lane_set(x) || lane_set(y)))
+
+#undef SIMD_LANEWISE
+
+inline vfloat v_select(vfloat mask, vfloat a, vfloat b)
+{
+    vfloat r;
+    for (int i = 0; i < 4; i++) r.f[i] = lane_set(mask.f[i]) ? a.f[i] : b.f[i];
+    return r;
+}
+
+inline int v_mask(vfloat mask)
+{
+    int m = 0;
+    for (int i = 0; i < 4; i++) m |= lane_set(mask.f[i]) << i;
+    return m;
+}
+
+#endif
+
+#endif // SIMD_H
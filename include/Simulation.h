@@ -0,0 +1,81 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <glm/glm.hpp>
+
+#include "Bvh.h"
+#include "OcclusionCuller.h"
+#include "Renderer.h"
+#include "SceneGraph.h"
+
+#include <string>
+#include <vector>
+
+// the fixed step, shared by the app, the benchmark and the offline renderer so a run of N steps means the same in all
+#define SIM_HZ 120
+#define SIM_DT (1.0 / SIM_HZ)
+
+// The world the main thread steps at a fixed rate: the scene's objects, their BVH and the orbiting point lights.
+// Every step keeps the state before it so the renderer can blend between the two, and fill_snapshot() culls the
+// newest state into what the renderer draws. Input is applied by the caller between begin_step() and end_step().
+class Simulation {
+    public:
+        static const unsigned int POINT_LIGHT_COUNT = 4096;
+
+    private:
+        struct LightOrbit {
+            float radius;
+            float height;
+            float speed;
+            float phase;
+        };
+
+        std::string m_sceneName;
+        SceneGraph m_scene;
+        std::vector<SceneGraph::NodeId> m_objectNodes;
+        std::vector<Renderer::Material> m_materials;
+        std::vector<unsigned char> m_dynamic;
+        std::vector<unsigned char> m_occludes;
+        int m_orbiter;                  // the object circling the container, -1 when the scene has none
+        Bvh m_bvh;
+        unsigned long long m_staticVersion;
+
+        std::vector<LightOrbit> m_lightOrbits;
+        std::vector<PointLight> m_pointLights;
+        std::vector<PointLight> m_previousPointLights;
+
+        unsigned long long m_step;
+        Camera::State m_previousCamera;
+        std::vector<glm::mat4> m_previousWorld;
+
+        OcclusionCuller m_occlusion;
+        std::vector<unsigned char> m_occlusionVisible;
+        std::vector<unsigned int> m_frustumVisible;
+        std::vector<unsigned char> m_nowVisible;
+
+        void add_object(const glm::mat4 &world, Renderer::Material material, bool dynamic, bool occludes);
+        void update_point_lights(double time);
+        static glm::mat4 orbit_matrix(double time);
+
+    public:
+        Simulation();
+
+        /* "default" is the container and the light cube. "cubes" adds count more containers on a grid around them
+           and one circling the container above it. False for a scene it doesn't know */
+        bool setup(const std::string &scene, unsigned int count, glm::vec3 lightPos);
+
+        /* Remembers the current state as the previous one, input goes in after this */
+        void begin_step();
+        /* Moves the world dt on and updates the BVH for whatever moved */
+        void end_step(double dt);
+
+        /* The scene half of a snapshot: objects, lights and what is visible from the camera.
+           The caller fills in the rest (time, viewport and render settings) */
+        void fill_snapshot(Renderer::FrameSnapshot &snapshot);
+
+        unsigned long long step() const { return m_step; }
+        unsigned int object_count() const { return (unsigned int)m_objectNodes.size(); }
+        const std::string &scene_name() const { return m_sceneName; }
+};
+
+#endif // SIMULATION_H
@@ -0,0 +1,45 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Lock-free single producer, single consumer triple buffer.
+// The writer fills write_buffer() and publish()es it. The reader calls consume() to swap in the newest
+// published buffer and then reads read_buffer(). Neither side ever waits, the reader just skips
+// buffers that were replaced before it got to them.
+template <typename T>
+class TripleBuffer {
+    private:
+        static const unsigned int INDEX_MASK = 3;
+        static const unsigned int NEW_DATA = 4;
+
+        T m_buffers[3];
+        std::atomic<unsigned int> m_middle;  // index of the shared buffer, plus NEW_DATA if the reader has not taken it
+        unsigned int m_write;
+        unsigned int m_read;
+
+    public:
+        TripleBuffer() : m_middle(1), m_write(0), m_read(2) {}
+
+        /* Writer side */
+        T &write_buffer() { return m_buffers[m_write]; }
+
+        void publish()
+        {
+            unsigned int previous = m_middle.exchange(m_write | NEW_DATA, std::memory_order_acq_rel);
+            m_write = previous & INDEX_MASK;
+        }
+
+        /* Reader side. Returns false (and keeps the current buffer) if nothing new was published */
+        bool consume()
+        {
+            if ((m_middle.load(std::memory_order_acquire) & NEW_DATA) == 0) return false;
+            unsigned int previous = m_middle.exchange(m_read, std::memory_order_acq_rel);
+            m_read = previous & INDEX_MASK;
+            return true;
+        }
+
+        const T &read_buffer() const { return m_buffers[m_read]; }
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -1,3 +1,4 @@
-extern float arrow_v4_buffer_data[676];
+extern float arrow_v4_buffer_data[507];
 extern unsigned int arrow_v4_buffer_data_stride;
-extern unsigned int arrow_v4_elements_data[1002];
\ No newline at end of file
+extern unsigned int arrow_v4_elements_data[1002];
+extern unsigned char arrow_v4_ao_data[169];
\ No newline at end of file
@@ -0,0 +1,4 @@
+// Kept by hand, not generated by make 3dobjs: 36 unindexed vertices of position and normal. The lightmap's UVs
+// are stored per vertex in this order, so changing it means re-baking assets/container.lightmap
+extern float container_buffer_data[216];
+extern unsigned int container_buffer_data_stride;
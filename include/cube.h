@@ -1,3 +1,4 @@
 extern float cube_buffer_data[24];
 extern unsigned int cube_buffer_data_stride;
-extern unsigned int cube_elements_data[36];
\ No newline at end of file
+extern unsigned int cube_elements_data[36];
+extern unsigned char cube_ao_data[8];
\ No newline at end of file
@@ -0,0 +1,407 @@
+#include "Bvh.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    // subtrees smaller than this are not worth handing to another worker
+    const unsigned int PARALLEL_BUILD_MIN_OBJECTS = 1024;
+    const int TRAVERSAL_STACK_SIZE = 64;
+    // a traversal holds at most one pending sibling per level above the node it is on, so the stack is never
+    // overrun as long as no leaf is deeper than this
+    const int MAX_LEAF_DEPTH = TRAVERSAL_STACK_SIZE - 1;
+    // cost of visiting an interior node relative to testing one object's bounds
+    const float SAH_TRAVERSAL_COST = 1.0f;
+
+    /* Levels of halving it takes to get count objects into leaves of leafSize */
+    int median_levels(unsigned int count, unsigned int leafSize)
+    {
+        int levels = 0;
+        while ((unsigned long long)leafSize << levels < count) levels++;
+        return levels;
+    }
+}
+
+Bvh::Bvh() : m_nodeCount(0)
+{
+}
+
+int Bvh::alloc_nodes(int count)
+{
+    return m_nodeCount.fetch_add(count);
+}
+
+void Bvh::build(const std::vector<AABB> &objectBounds)
+{
+    m_objectBounds = objectBounds;
+    m_objects.resize(objectBounds.size());
+    m_objectLeaf.assign(objectBounds.size(), -1);
+    m_dirtyLeaves.clear();
+    m_nodes.clear();
+    m_nodeCount = 0;
+
+    if (objectBounds.empty()) return;
+
+    std::vector<glm::vec3> centroids(objectBounds.size());
+    for (unsigned int i = 0; i < objectBounds.size(); i++)
+    {
+        m_objects[i] = i;
+        centroids[i] = objectBounds[i].centre();
+    }
+
+    // a binary tree with at least one object per leaf never needs more than 2n - 1 nodes
+    m_nodes.resize(2 * objectBounds.size() - 1);
+    int root = alloc_nodes(1);
+    m_nodes[root].parent = -1;
+    build_recursive(root, 0, (unsigned int)m_objects.size(), centroids, 0);
+    m_nodes.resize(m_nodeCount);
+
+    m_leafDirty.assign(m_nodes.size(), false);
+    for (int n = 0; n < (int)m_nodes.size(); n++)
+    {
+        if (m_nodes[n].count == 0) continue;
+        for (int i = 0; i < m_nodes[n].count; i++)
+        {
+            m_objectLeaf[m_objects[m_nodes[n].first + i]] = n;
+        }
+    }
+}
+
+bool Bvh::find_split(unsigned int begin, unsigned int end, const AABB &bounds, const std::vector<glm::vec3> &centroids, int &axis, float &position)
+{
+    AABB centroidBounds;
+    for (unsigned int i = begin; i < end; i++)
+    {
+        centroidBounds.grow(centroids[m_objects[i]]);
+    }
+
+    unsigned int count = end - begin;
+    // splitting has to beat testing everything in one leaf, including the cost of the extra node
+    float bestCost = (count - SAH_TRAVERSAL_COST) * bounds.surface_area();
+    bool found = false;
+
+    for (int a = 0; a < 3; a++)
+    {
+        float lo = centroidBounds.min[a];
+        float hi = centroidBounds.max[a];
+        if (hi <= lo) continue;
+
+        AABB binBounds[BIN_COUNT];
+        unsigned int binCount[BIN_COUNT] = {0};
+        float scale = BIN_COUNT / (hi - lo);
+
+        for (unsigned int i = begin; i < end; i++)
+        {
+            unsigned int obj = m_objects[i];
+            int b = std::min(BIN_COUNT - 1, (int)((centroids[obj][a] - lo) * scale));
+            binCount[b]++;
+            binBounds[b].grow(m_objectBounds[obj]);
+        }
+
+        // sweep from the right to get the cost of everything above each plane
+        float rightArea[BIN_COUNT - 1];
+        unsigned int rightCount[BIN_COUNT - 1];
+        AABB acc;
+        unsigned int accCount = 0;
+        for (int b = BIN_COUNT - 1; b > 0; b--)
+        {
+            acc.grow(binBounds[b]);
+            accCount += binCount[b];
+            rightArea[b - 1] = acc.surface_area();
+            rightCount[b - 1] = accCount;
+        }
+
+        acc = AABB();
+        accCount = 0;
+        for (int b = 0; b < BIN_COUNT - 1; b++)
+        {
+            acc.grow(binBounds[b]);
+            accCount += binCount[b];
+            if (accCount == 0 || rightCount[b] == 0) continue;
+
+            float cost = accCount * acc.surface_area() + rightCount[b] * rightArea[b];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                axis = a;
+                position = lo + (b + 1) / scale;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+void Bvh::build_recursive(int nodeIndex, unsigned int begin, unsigned int end, std::vector<glm::vec3> &centroids, int depth)
+{
+    Node &node = m_nodes[nodeIndex];
+    node.bounds = AABB();
+    for (unsigned int i = begin; i < end; i++)
+    {
+        node.bounds.grow(m_objectBounds[m_objects[i]]);
+    }
+
+    unsigned int count = end - begin;
+    int axis = 0;
+    float position = 0.0f;
+    // once lopsided SAH splits have used up all but the depth halving still needs, only halve from here on
+    bool balance = depth + median_levels(count, MAX_LEAF_SIZE) >= MAX_LEAF_DEPTH;
+    bool split = !balance && find_split(begin, end, node.bounds, centroids, axis, position);
+
+    if (!split && count <= MAX_LEAF_SIZE)
+    {
+        node.first = begin;
+        node.count = count;
+        return;
+    }
+
+    unsigned int mid = begin;
+    if (split)
+    {
+        unsigned int *first = m_objects.data() + begin;
+        unsigned int *last = m_objects.data() + end;
+        mid = (unsigned int)(std::partition(first, last, [&](unsigned int obj) { return centroids[obj][axis] < position; }) - m_objects.data());
+    }
+
+    if (mid == begin || mid == end)
+    {
+        // every centroid in the same spot (or the SAH said no but the leaf is too big, or the tree is getting too
+        // deep), split down the middle
+        glm::vec3 e = node.bounds.extent();
+        axis = (e.x > e.y && e.x > e.z) ? 0 : (e.y > e.z ? 1 : 2);
+        mid = begin + count / 2;
+        std::nth_element(m_objects.begin() + begin, m_objects.begin() + mid, m_objects.begin() + end,
+                         [&](unsigned int a, unsigned int b) { return centroids[a][axis] < centroids[b][axis]; });
+    }
+
+    int left = alloc_nodes(2);
+    node.first = left;
+    node.count = 0;
+    m_nodes[left].parent = nodeIndex;
+    m_nodes[left + 1].parent = nodeIndex;
+
+    // hand the left subtree to another worker, a few levels more than there are threads so stealing can balance uneven splits
+    bool parallel = depth < 31 && (1u << depth) < 4 * JobSystem::thread_count() && count >= PARALLEL_BUILD_MIN_OBJECTS;
+    if (parallel)
+    {
+        JobSystem::Counter counter;
+        JobSystem::run([&]() { build_recursive(left, begin, mid, centroids, depth + 1); }, &counter);
+        build_recursive(left + 1, mid, end, centroids, depth + 1);
+        JobSystem::wait(&counter);
+    }
+    else
+    {
+        build_recursive(left, begin, mid, centroids, depth + 1);
+        build_recursive(left + 1, mid, end, centroids, depth + 1);
+    }
+}
+
+void Bvh::update(unsigned int object, const AABB &bounds)
+{
+    assert(object < m_objectBounds.size());
+    m_objectBounds[object] = bounds;
+
+    int leaf = m_objectLeaf[object];
+    if (!m_leafDirty[leaf])
+    {
+        m_leafDirty[leaf] = true;
+        m_dirtyLeaves.push_back(leaf);
+    }
+}
+
+void Bvh::refit_node(int nodeIndex)
+{
+    Node &node = m_nodes[nodeIndex];
+    node.bounds = AABB();
+    if (node.count > 0)
+    {
+        for (int i = 0; i < node.count; i++)
+        {
+            node.bounds.grow(m_objectBounds[m_objects[node.first + i]]);
+        }
+    }
+    else
+    {
+        node.bounds.grow(m_nodes[node.first].bounds);
+        node.bounds.grow(m_nodes[node.first + 1].bounds);
+    }
+}
+
+void Bvh::refit()
+{
+    if (m_dirtyLeaves.empty()) return;
+
+    // past this point walking every path is more work than touching every node once
+    if (m_dirtyLeaves.size() * 4 > m_nodes.size())
+    {
+        refit_all();
+        return;
+    }
+
+    for (int leaf : m_dirtyLeaves)
+    {
+        m_leafDirty[leaf] = false;
+        int n = leaf;
+        while (n != -1)
+        {
+            AABB before = m_nodes[n].bounds;
+            refit_node(n);
+            // ancestors only change if this node did
+            if (n != leaf && m_nodes[n].bounds == before) break;
+            n = m_nodes[n].parent;
+        }
+    }
+    m_dirtyLeaves.clear();
+}
+
+void Bvh::refit_all()
+{
+    // children are always allocated after their parent, so walking backwards is bottom up
+    for (int n = (int)m_nodes.size() - 1; n >= 0; n--)
+    {
+        refit_node(n);
+    }
+    for (int leaf : m_dirtyLeaves)
+    {
+        m_leafDirty[leaf] = false;
+    }
+    m_dirtyLeaves.clear();
+}
+
+void Bvh::query_frustum(const Frustum &frustum, std::vector<unsigned int> &out) const
+{
+    if (m_nodes.empty()) return;
+
+    int stack[TRAVERSAL_STACK_SIZE];
+    bool inside[TRAVERSAL_STACK_SIZE];
+    int top = 0;
+    stack[top] = 0;
+    inside[top++] = false;
+
+    while (top > 0)
+    {
+        top--;
+        const Node &node = m_nodes[stack[top]];
+        bool fullyInside = inside[top];
+
+        if (!fullyInside)
+        {
+            Frustum::Result r = frustum.test(node.bounds);
+            if (r == Frustum::OUTSIDE) continue;
+            fullyInside = r == Frustum::INSIDE;
+        }
+
+        if (node.count > 0)
+        {
+            for (int i = 0; i < node.count; i++)
+            {
+                unsigned int obj = m_objects[node.first + i];
+                if (fullyInside || frustum.test(m_objectBounds[obj]) != Frustum::OUTSIDE)
+                {
+                    out.push_back(obj);
+                }
+            }
+            continue;
+        }
+
+        assert(top + 2 <= TRAVERSAL_STACK_SIZE);
+        stack[top] = node.first;
+        inside[top++] = fullyInside;
+        stack[top] = node.first + 1;
+        inside[top++] = fullyInside;
+    }
+}
+
+void Bvh::query_range(const AABB &range, std::vector<unsigned int> &out) const
+{
+    if (m_nodes.empty()) return;
+
+    int stack[TRAVERSAL_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = m_nodes[stack[--top]];
+        if (!node.bounds.overlaps(range)) continue;
+
+        if (node.count > 0)
+        {
+            for (int i = 0; i < node.count; i++)
+            {
+                unsigned int obj = m_objects[node.first + i];
+                if (m_objectBounds[obj].overlaps(range)) out.push_back(obj);
+            }
+            continue;
+        }
+
+        assert(top + 2 <= TRAVERSAL_STACK_SIZE);
+        stack[top++] = node.first;
+        stack[top++] = node.first + 1;
+    }
+}
+
+int Bvh::pick(const Ray &ray, float &tHit) const
+{
+    int hitObject = -1;
+    tHit = ray.tMax;
+    if (m_nodes.empty()) return hitObject;
+
+    float t;
+    if (!intersect_ray_aabb(ray, m_nodes[0].bounds, t)) return hitObject;
+
+    int stack[TRAVERSAL_STACK_SIZE];
+    float stackT[TRAVERSAL_STACK_SIZE];
+    int top = 0;
+    stack[top] = 0;
+    stackT[top++] = t;
+
+    while (top > 0)
+    {
+        top--;
+        if (stackT[top] > tHit) continue;
+        const Node &node = m_nodes[stack[top]];
+
+        if (node.count > 0)
+        {
+            for (int i = 0; i < node.count; i++)
+            {
+                unsigned int obj = m_objects[node.first + i];
+                if (intersect_ray_aabb(ray, m_objectBounds[obj], t) && t < tHit)
+                {
+                    tHit = t;
+                    hitObject = obj;
+                }
+            }
+            continue;
+        }
+
+        float tLeft, tRight;
+        bool hitLeft = intersect_ray_aabb(ray, m_nodes[node.first].bounds, tLeft);
+        bool hitRight = intersect_ray_aabb(ray, m_nodes[node.first + 1].bounds, tRight);
+
+        assert(top + 2 <= TRAVERSAL_STACK_SIZE);
+        // push the far child first so the near one is popped next
+        if (hitLeft && hitRight && tLeft < tRight)
+        {
+            stack[top] = node.first + 1;
+            stackT[top++] = tRight;
+            hitRight = false;
+        }
+        if (hitLeft)
+        {
+            stack[top] = node.first;
+            stackT[top++] = tLeft;
+        }
+        if (hitRight)
+        {
+            stack[top] = node.first + 1;
+            stackT[top++] = tRight;
+        }
+    }
+
+    return hitObject;
+}
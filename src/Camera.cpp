@@ -1,4 +1,5 @@
 #include "Camera.h"
+#include "CpuProfiler.h"
 
 #include "arrow_v4.h"
 
@@ -21,6 +22,7 @@ namespace Camera
     unsigned int hudVAO;
     unsigned int hudVBO;
     unsigned int hudVEO;
+    unsigned int hudAoVBO;
 
     // 0 degree yaw is 1x, 0z
     // 90 degree is 0x, 1z
@@ -31,7 +33,7 @@ namespace Camera
 
     const char *hudVertexSource = "#version 330 core\n"
         "layout (location = 0) in vec3 pos;\n"
-        "layout (location = 1) in float colIntensity;\n"
+        "layout (location = 1) in float ambientOcclusion;\n"
         "uniform mat4 model;\n"
         "uniform mat4 rotation;\n"
         "out float ColIntensity;\n"
@@ -40,10 +42,10 @@ namespace Camera
         "{\n"
         "  gl_Position = rotation * model * vec4(pos, 1.0);\n"
         "  FragPos = vec3(model * vec4(pos, 1.0));\n"
-        "  ColIntensity = colIntensity;\n"
+        "  ColIntensity = ambientOcclusion;\n"
         "}";
     
-    // Colour intensity is pre-calculated so the inside of the arrow tip is dark
+    // Colour intensity is the ambient occlusion baked by convert_to_vertices.py, so the inside of the arrow tip is dark
     const char *hudFragmentSource = "#version 330 core\n"
         "in vec3 FragPos;\n"
         "in float ColIntensity;\n"
@@ -60,7 +62,31 @@ namespace Camera
     void set_window_ratio(float width, float height)
     {
         windowRatio = width / height;
-        projectionMatrix = glm::perspective(glm::radians(zoomLevel), windowRatio, 0.1f, 100.0f);
+        projectionMatrix = glm::perspective(glm::radians(zoomLevel), windowRatio, NEAR_PLANE, FAR_PLANE);
+    }
+
+    /* Works out the starting yaw from frontVec. Called from setup_hud, or earlier when the HUD is set up on another thread */
+    void init_orientation()
+    {
+        if (!isStartYawCalced)
+        {
+            // needs to be unit vector in x or z direction
+            bool x_conforms = fabs(frontVec.x) == 1.0f;
+            bool z_conforms = fabs(frontVec.z) == 1.0f;
+            assert(x_conforms ^ z_conforms);
+            isStartYawCalced = true;
+
+            if (x_conforms)
+            {
+                if (frontVec.x > 0.0f) yaw = 0.0f;
+                else yaw = offsetYaw = 180.0f;
+            }
+            else
+            {
+                if (frontVec.z > 0.0f) yaw = offsetYaw = 90.0f;
+                else yaw = offsetYaw = 270.0f;
+            }
+        }
     }
 
     void setup_hud(glm::vec3 lightPos, glm::vec3 lightColour)
@@ -78,6 +104,7 @@ namespace Camera
             glGenVertexArrays(1, &hudVAO);
             glGenBuffers(1, &hudVBO);
             glGenBuffers(1, &hudVEO);
+            glGenBuffers(1, &hudAoVBO);
 
             glBindVertexArray(hudVAO);
             glBindBuffer(GL_ARRAY_BUFFER, hudVBO);
@@ -89,44 +116,25 @@ namespace Camera
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, arrow_v4_buffer_data_stride * sizeof(float), (void*)0);
             glEnableVertexAttribArray(0);
 
-            glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, arrow_v4_buffer_data_stride * sizeof(float), (void*)(3 * sizeof(float)));
+            // one byte per vertex, 255 is unoccluded
+            glBindBuffer(GL_ARRAY_BUFFER, hudAoVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(arrow_v4_ao_data), arrow_v4_ao_data, GL_STATIC_DRAW);
+            glVertexAttribPointer(1, 1, GL_UNSIGNED_BYTE, GL_TRUE, 0, (void*)0);
             glEnableVertexAttribArray(1);
 
             glBindVertexArray(0);
 
-            if (!isStartYawCalced)
-            {
-                // needs to be unit vector in x or z direction
-                bool x_conforms = fabs(frontVec.x) == 1.0f;
-                bool z_conforms = fabs(frontVec.z) == 1.0f;
-                assert(x_conforms ^ z_conforms);
-                isStartYawCalced = true;
-
-                if (x_conforms)
-                {
-                    if (frontVec.x > 0.0f) yaw = 0.0f;
-                    else yaw = offsetYaw = 180.0f;
-                }
-                else
-                {
-                    if (frontVec.z > 0.0f) yaw = offsetYaw = 90.0f;
-                    else yaw = offsetYaw = 270.0f;
-                }
-            }
+            init_orientation();
         }
     }
 
     void draw_hud()
     {
-        // Arrow model faces vec3(0, 1, 0) positive y-axis by default
-        // Hud arrows DO NOT follow OpenGL axis directions. This X-axis is flipped compared to OpenGL
-        // Hud arrows X-axis faces where the camera starts looking
-
-        static glm::vec3 rotateToFaceX = glm::vec3(1.0f, 0.0f, 0.0f);
-        static glm::vec3 rotateToFaceZ = glm::vec3(0.0f, 0.0f, 1.0f);
-
-        static int arrow_v4_elements_count = sizeof(arrow_v4_elements_data)/sizeof(arrow_v4_elements_data[0]);
+        draw_hud(get_state());
+    }
 
+    glm::mat4 hud_rotation(const State &state)
+    {
         static glm::mat4 *baseTransform = nullptr;
         if (baseTransform == nullptr)
         {
@@ -136,8 +144,23 @@ namespace Camera
         }
 
         glm::mat4 rotation = glm::mat4(*baseTransform);
-        rotation = glm::rotate(rotation, glm::radians(offsetYaw - yaw), glm::vec3(0.0f, 1.0f, 0.0f));
-        rotation = glm::rotate(rotation, glm::radians(-pitch), glm::vec3(1.0f, 0.0f, 0.0f));
+        rotation = glm::rotate(rotation, glm::radians(offsetYaw - state.yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+        rotation = glm::rotate(rotation, glm::radians(-state.pitch), glm::vec3(1.0f, 0.0f, 0.0f));
+        return rotation;
+    }
+
+    void draw_hud(const State &state)
+    {
+        // Arrow model faces vec3(0, 1, 0) positive y-axis by default
+        // Hud arrows DO NOT follow OpenGL axis directions. This X-axis is flipped compared to OpenGL
+        // Hud arrows X-axis faces where the camera starts looking
+
+        static glm::vec3 rotateToFaceX = glm::vec3(1.0f, 0.0f, 0.0f);
+        static glm::vec3 rotateToFaceZ = glm::vec3(0.0f, 0.0f, 1.0f);
+
+        static int arrow_v4_elements_count = sizeof(arrow_v4_elements_data)/sizeof(arrow_v4_elements_data[0]);
+
+        glm::mat4 rotation = hud_rotation(state);
 
         hudShader->set_uniform_matrix4("rotation", 1, GL_FALSE, glm::value_ptr(rotation));
         
@@ -171,6 +194,7 @@ namespace Camera
 
     void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     {
+        PROFILE_SCOPE("Camera::mouse_callback");
         static double lastX = xpos;
         static double lastY = ypos;
         static float sensitivityY = 0.1f;
@@ -197,6 +221,7 @@ namespace Camera
 
     void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     {
+        PROFILE_SCOPE("Camera::scroll_callback");
         zoomLevel -= (float)yoffset;
         if (zoomLevel < 1.0f)
         {
@@ -206,7 +231,7 @@ namespace Camera
         {
             zoomLevel = 45.0f;
         }
-        projectionMatrix = glm::perspective(glm::radians(zoomLevel), windowRatio, 0.1f, 100.0f);
+        projectionMatrix = glm::perspective(glm::radians(zoomLevel), windowRatio, NEAR_PLANE, FAR_PLANE);
     }
 
     glm::mat4 get_view_matrix()
@@ -214,6 +239,42 @@ namespace Camera
         return glm::lookAt(pos, pos + frontVec, upVec);
     }
 
+    State get_state()
+    {
+        return State{pos, frontVec, upVec, yaw, pitch, zoomLevel, windowRatio};
+    }
+
+    glm::mat4 view_matrix(const State &state)
+    {
+        return glm::lookAt(state.pos, state.pos + state.front, state.up);
+    }
+
+    glm::mat4 projection_matrix(const State &state)
+    {
+        return glm::perspective(glm::radians(state.zoom), state.windowRatio, NEAR_PLANE, FAR_PLANE);
+    }
+
+    /* Blend between two simulation steps for rendering. Window ratio is not blended, a resize applies straight away */
+    State interpolate(const State &from, const State &to, float t)
+    {
+        State out = to;
+        out.pos = glm::mix(from.pos, to.pos, t);
+        out.front = glm::normalize(glm::mix(from.front, to.front, t));
+        out.yaw = glm::mix(from.yaw, to.yaw, t);
+        out.pitch = glm::mix(from.pitch, to.pitch, t);
+        out.zoom = glm::mix(from.zoom, to.zoom, t);
+        return out;
+    }
+
+    void look_at(glm::vec3 position, glm::vec3 target)
+    {
+        pos = position;
+        frontVec = glm::normalize(target - position);
+        // the angles mouse_callback would have arrived at, so the mouse carries on from here
+        pitch = glm::degrees(asinf(glm::clamp(frontVec.y, -1.0f, 1.0f)));
+        yaw = glm::degrees(atan2f(frontVec.z, frontVec.x));
+    }
+
     void toggle_fps_movement(bool enabled)
     {
         fpsMovement = enabled;
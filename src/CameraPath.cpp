@@ -0,0 +1,81 @@
+#include "CameraPath.h"
+#include "Camera.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define KEY_SECONDS 1.0
+#define ORBIT_KEYS 8
+#define ORBIT_RADIUS 5.0f
+
+static glm::vec3 catmull_rom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+bool CameraPath::load(const char *name)
+{
+    m_keys.clear();
+    if (strcmp(name, "orbit") == 0)
+    {
+        // circles the container, bobbing up and down, always looking at it
+        for (int i = 0; i < ORBIT_KEYS; i++)
+        {
+            float angle = 6.2832f * i / ORBIT_KEYS;
+            glm::vec3 position = glm::vec3(sinf(angle) * ORBIT_RADIUS, 1.0f + ((i & 1) ? 1.5f : -0.5f), cosf(angle) * ORBIT_RADIUS);
+            m_keys.push_back(Key{position, glm::vec3(0.0f)});
+        }
+        return true;
+    }
+
+    FILE *file = fopen(name, "r");
+    if (file == nullptr)
+    {
+        printf("Failed to open camera path %s\n", name);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr)
+    {
+        Key key;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%f %f %f %f %f %f", &key.position.x, &key.position.y, &key.position.z,
+                   &key.target.x, &key.target.y, &key.target.z) == 6) m_keys.push_back(key);
+    }
+    fclose(file);
+    if (m_keys.size() < 2)
+    {
+        printf("Camera path %s needs at least two keys\n", name);
+        m_keys.clear();
+        return false;
+    }
+    return true;
+}
+
+CameraPath::Key CameraPath::sample(double time) const
+{
+    size_t count = m_keys.size();
+    double position = fmod(time / KEY_SECONDS, (double)count);
+    size_t i = (size_t)position;
+    float t = (float)(position - i);
+    const Key &k0 = m_keys[(i + count - 1) % count];
+    const Key &k1 = m_keys[i];
+    const Key &k2 = m_keys[(i + 1) % count];
+    const Key &k3 = m_keys[(i + 2) % count];
+    return Key{catmull_rom(k0.position, k1.position, k2.position, k3.position, t),
+               catmull_rom(k0.target, k1.target, k2.target, k3.target, t)};
+}
+
+void CameraPath::apply(double time) const
+{
+    Key key = sample(time);
+    Camera::look_at(key.position, key.target);
+}
+
+double CameraPath::duration() const
+{
+    return m_keys.size() * KEY_SECONDS;
+}
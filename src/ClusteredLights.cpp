@@ -0,0 +1,243 @@
+#include "ClusteredLights.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    const unsigned int RANGE_GRAIN = 256;
+
+    int tile(float ndc, int count)
+    {
+        return std::min(count - 1, std::max(0, (int)floorf((ndc * 0.5f + 0.5f) * count)));
+    }
+}
+
+const char *ClusteredLights::shaderSource =
+    "uniform samplerBuffer lightData;\n"
+    "uniform usamplerBuffer clusterData;\n"
+    "uniform usamplerBuffer lightIndices;\n"
+    "uniform ivec3 clusterCount;\n"
+    "uniform vec2 clusterScale;\n"     // clusters per pixel
+    "uniform float sliceScale;\n"
+    "uniform float sliceBias;\n"
+    "uniform vec2 depthRange;\n"
+    "vec3 cluster_lighting(vec3 fragPos, vec3 normal, vec3 viewPos)\n"
+    "{\n"
+    "  float ndcZ = gl_FragCoord.z * 2.0 - 1.0;\n"
+    "  float viewZ = 2.0 * depthRange.x * depthRange.y / (depthRange.y + depthRange.x - ndcZ * (depthRange.y - depthRange.x));\n"
+    "  int slice = clamp(int(log(viewZ) * sliceScale + sliceBias), 0, clusterCount.z - 1);\n"
+    "  ivec2 tile = clamp(ivec2(gl_FragCoord.xy * clusterScale), ivec2(0), clusterCount.xy - 1);\n"
+    "  uvec2 range = texelFetch(clusterData, (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x).xy;\n"
+    "  vec3 viewDir = normalize(viewPos - fragPos);\n"
+    "  vec3 result = vec3(0.0);\n"
+    "  for (uint i = 0u; i < range.y; i++)\n"
+    "  {\n"
+    "    int light = int(texelFetch(lightIndices, int(range.x + i)).r);\n"
+    "    vec4 positionRadius = texelFetch(lightData, light * 2);\n"
+    "    vec3 colour = texelFetch(lightData, light * 2 + 1).rgb;\n"
+    "    vec3 toLight = positionRadius.xyz - fragPos;\n"
+    "    float dist = length(toLight);\n"
+    "    if (dist >= positionRadius.w) continue;\n"
+    // fades to exactly zero at the radius, so cutting the light off there leaves no seam
+    "    float x = dist / positionRadius.w;\n"
+    "    float window = 1.0 - x * x * x * x;\n"
+    "    float attenuation = window * window;\n"
+    "    vec3 lightDir = toLight / max(dist, 1e-4);\n"
+    "    float diff = max(dot(normal, lightDir), 0.0);\n"
+    "    float spec = pow(max(dot(viewDir, reflect(-lightDir, normal)), 0.0), 32);\n"
+    "    result += (diff + 0.5 * spec) * colour * attenuation;\n"
+    "  }\n"
+    "  return result;\n"
+    "}\n";
+
+ClusteredLights::ClusteredLights()
+    : m_clusters(CLUSTER_COUNT, glm::uvec2(0)), m_sliceIndices(CLUSTERS_Z), m_near(0.1f), m_far(100.0f)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        m_buffers[i] = 0;
+        m_textures[i] = 0;
+    }
+}
+
+ClusteredLights::~ClusteredLights()
+{
+    if (m_buffers[0] == 0) return;
+    glDeleteTextures(3, m_textures);
+    glDeleteBuffers(3, m_buffers);
+}
+
+void ClusteredLights::setup()
+{
+    glGenBuffers(3, m_buffers);
+    glGenTextures(3, m_textures);
+
+    const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+    for (int i = 0; i < 3; i++)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], m_buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::assign(const PointLight *lights, unsigned int count, const glm::mat4 &view, const glm::mat4 &projection, float nearPlane, float farPlane)
+{
+    count = std::min(count, (unsigned int)MAX_LIGHTS);
+    m_near = nearPlane;
+    m_far = farPlane;
+    m_ranges.resize(count);
+    m_lightData.resize(count * 2);
+
+    const float sliceScale = CLUSTERS_Z / logf(farPlane / nearPlane);
+
+    // which clusters each light's sphere can reach, from the view space box around it
+    JobSystem::parallel_for(count, RANGE_GRAIN, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+        {
+            const PointLight &light = lights[i];
+            m_lightData[i * 2] = glm::vec4(light.position, light.radius);
+            m_lightData[i * 2 + 1] = glm::vec4(light.colour, 0.0f);
+
+            LightRange &range = m_ranges[i];
+            range.x0 = 1;
+            range.x1 = 0;
+
+            glm::vec3 centre = glm::vec3(view * glm::vec4(light.position, 1.0f));
+            float zNear = -centre.z - light.radius;
+            float zFar = -centre.z + light.radius;
+            if (zFar < nearPlane || zNear > farPlane) continue;
+
+            range.z0 = std::max(0, (int)(logf(std::max(zNear, nearPlane) / nearPlane) * sliceScale));
+            range.z1 = std::min(CLUSTERS_Z - 1, (int)(logf(std::min(zFar, farPlane) / nearPlane) * sliceScale));
+
+            if (zNear <= nearPlane)
+            {
+                // reaches the eye plane, the projection of the box is unbounded
+                range.x0 = range.y0 = 0;
+                range.x1 = CLUSTERS_X - 1;
+                range.y1 = CLUSTERS_Y - 1;
+                continue;
+            }
+
+            glm::vec2 lo = glm::vec2(FLT_MAX);
+            glm::vec2 hi = glm::vec2(-FLT_MAX);
+            for (int k = 0; k < 8; k++)
+            {
+                glm::vec3 corner = centre + light.radius * glm::vec3(k & 1 ? 1.0f : -1.0f, k & 2 ? 1.0f : -1.0f, k & 4 ? 1.0f : -1.0f);
+                glm::vec4 clip = projection * glm::vec4(corner, 1.0f);
+                glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                lo = glm::min(lo, ndc);
+                hi = glm::max(hi, ndc);
+            }
+            if (lo.x > 1.0f || lo.y > 1.0f || hi.x < -1.0f || hi.y < -1.0f) continue;
+
+            range.x0 = tile(lo.x, CLUSTERS_X);
+            range.x1 = tile(hi.x, CLUSTERS_X);
+            range.y0 = tile(lo.y, CLUSTERS_Y);
+            range.y1 = tile(hi.y, CLUSTERS_Y);
+        }
+    });
+
+    // one job per depth slice, each builds its own index list so nothing is shared
+    const int slicePlane = CLUSTERS_X * CLUSTERS_Y;
+    JobSystem::parallel_for(CLUSTERS_Z, 1, [&](unsigned int begin, unsigned int end) {
+        std::vector<unsigned int> counts(slicePlane);
+        for (unsigned int z = begin; z < end; z++)
+        {
+            std::fill(counts.begin(), counts.end(), 0);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                const LightRange &r = m_ranges[i];
+                if (r.x0 > r.x1 || (int)z < r.z0 || (int)z > r.z1) continue;
+                for (int y = r.y0; y <= r.y1; y++)
+                {
+                    for (int x = r.x0; x <= r.x1; x++)
+                    {
+                        counts[y * CLUSTERS_X + x]++;
+                    }
+                }
+            }
+
+            // offsets are relative to the slice until the slices are stitched together
+            glm::uvec2 *clusters = &m_clusters[z * slicePlane];
+            unsigned int offset = 0;
+            for (int c = 0; c < slicePlane; c++)
+            {
+                clusters[c] = glm::uvec2(offset, 0);
+                offset += counts[c];
+            }
+
+            std::vector<unsigned short> &indices = m_sliceIndices[z];
+            indices.resize(offset);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                const LightRange &r = m_ranges[i];
+                if (r.x0 > r.x1 || (int)z < r.z0 || (int)z > r.z1) continue;
+                for (int y = r.y0; y <= r.y1; y++)
+                {
+                    for (int x = r.x0; x <= r.x1; x++)
+                    {
+                        glm::uvec2 &cluster = clusters[y * CLUSTERS_X + x];
+                        indices[cluster.x + cluster.y++] = (unsigned short)i;
+                    }
+                }
+            }
+        }
+    });
+
+    size_t total = 0;
+    for (int z = 0; z < CLUSTERS_Z; z++)
+    {
+        for (int c = 0; c < slicePlane; c++)
+        {
+            m_clusters[z * slicePlane + c].x += (unsigned int)total;
+        }
+        total += m_sliceIndices[z].size();
+    }
+    m_indices.resize(total);
+    size_t at = 0;
+    for (int z = 0; z < CLUSTERS_Z; z++)
+    {
+        std::copy(m_sliceIndices[z].begin(), m_sliceIndices[z].end(), m_indices.begin() + at);
+        at += m_sliceIndices[z].size();
+    }
+}
+
+void ClusteredLights::upload()
+{
+    // orphaned each frame, an empty buffer still needs a data store for the texture
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[0]);
+    glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(m_lightData.size() * sizeof(glm::vec4), 16), m_lightData.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[1]);
+    glBufferData(GL_TEXTURE_BUFFER, m_clusters.size() * sizeof(glm::uvec2), m_clusters.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[2]);
+    glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(m_indices.size() * sizeof(unsigned short), 16), m_indices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::bind(ShaderHelper *shader, int firstUnit, int viewportWidth, int viewportHeight)
+{
+    const char *samplers[3] = { "lightData", "clusterData", "lightIndices" };
+    for (int i = 0; i < 3; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+        shader->set_uniform(samplers[i], firstUnit + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    float logRatio = logf(m_far / m_near);
+    shader->use();
+    glUniform3i(shader->get_uniform_location("clusterCount"), CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z);
+    glUniform2f(shader->get_uniform_location("clusterScale"), (float)CLUSTERS_X / std::max(viewportWidth, 1), (float)CLUSTERS_Y / std::max(viewportHeight, 1));
+    glUniform1f(shader->get_uniform_location("sliceScale"), CLUSTERS_Z / logRatio);
+    glUniform1f(shader->get_uniform_location("sliceBias"), -CLUSTERS_Z * logf(m_near) / logRatio);
+    glUniform2f(shader->get_uniform_location("depthRange"), m_near, m_far);
+}
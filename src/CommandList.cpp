@@ -0,0 +1,226 @@
+#include "CommandList.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace
+{
+    const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    struct TextureBind {
+        unsigned int unit;
+        unsigned int texture;
+    };
+
+    struct IntUniform {
+        int location;
+        GLint value;
+    };
+
+    struct FloatUniform {
+        int location;
+        GLfloat value;
+    };
+
+    struct Vec3Uniform {
+        int location;
+        glm::vec3 value;
+    };
+
+    struct Mat4Uniform {
+        int location;
+        glm::mat4 value;
+    };
+
+    struct DrawArrays {
+        GLenum mode;
+        GLint first;
+        GLsizei count;
+        GLsizei instances;
+    };
+
+    struct DrawElements {
+        GLenum mode;
+        GLsizei count;
+        GLenum type;
+        size_t offset;
+    };
+
+    template <typename T>
+    T read(const unsigned char *&at)
+    {
+        T value;
+        memcpy(&value, at, sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+}
+
+CommandList::CommandList() : m_drawCount(0)
+{
+}
+
+void CommandList::reset()
+{
+    m_data.clear();
+    m_drawCount = 0;
+}
+
+void CommandList::bind_shader(ShaderHelper *shader)
+{
+    push(BIND_SHADER, shader);
+}
+
+void CommandList::bind_vao(unsigned int vao)
+{
+    push(BIND_VAO, vao);
+}
+
+void CommandList::bind_texture(unsigned int unit, unsigned int texture)
+{
+    assert(unit < MAX_TEXTURE_UNITS);
+    push(BIND_TEXTURE, TextureBind{unit, texture});
+}
+
+void CommandList::set_uniform(int location, GLint i)
+{
+    push(UNIFORM_INT, IntUniform{location, i});
+}
+
+void CommandList::set_uniform(int location, GLfloat f)
+{
+    push(UNIFORM_FLOAT, FloatUniform{location, f});
+}
+
+void CommandList::set_uniform(int location, const glm::vec3 &v)
+{
+    push(UNIFORM_VEC3, Vec3Uniform{location, v});
+}
+
+void CommandList::set_uniform_matrix4(int location, const glm::mat4 &m)
+{
+    push(UNIFORM_MAT4, Mat4Uniform{location, m});
+}
+
+void CommandList::draw_arrays(GLenum mode, GLint first, GLsizei count)
+{
+    push(DRAW_ARRAYS, DrawArrays{mode, first, count, 1});
+    m_drawCount++;
+}
+
+void CommandList::draw_elements(GLenum mode, GLsizei count, GLenum type, size_t offset)
+{
+    push(DRAW_ELEMENTS, DrawElements{mode, count, type, offset});
+    m_drawCount++;
+}
+
+void CommandList::draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+{
+    push(DRAW_ARRAYS_INSTANCED, DrawArrays{mode, first, count, instances});
+    m_drawCount++;
+}
+
+void CommandList::replay(const CommandList *lists, unsigned int count)
+{
+    // state is unknown on entry, so the first bind of each kind is always issued
+    ShaderHelper *shader = nullptr;
+    unsigned int vao = 0xFFFFFFFF;
+    unsigned int textures[MAX_TEXTURE_UNITS];
+    unsigned int activeUnit = 0xFFFFFFFF;
+    for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+    {
+        textures[i] = 0xFFFFFFFF;
+    }
+
+    for (unsigned int l = 0; l < count; l++)
+    {
+        const unsigned char *at = lists[l].m_data.data();
+        const unsigned char *end = at + lists[l].m_data.size();
+
+        while (at < end)
+        {
+            Op op = (Op)*at++;
+            switch (op)
+            {
+                case BIND_SHADER:
+                {
+                    ShaderHelper *s = read<ShaderHelper *>(at);
+                    if (s != shader)
+                    {
+                        s->use();
+                        shader = s;
+                    }
+                    break;
+                }
+                case BIND_VAO:
+                {
+                    unsigned int v = read<unsigned int>(at);
+                    if (v != vao)
+                    {
+                        glBindVertexArray(v);
+                        vao = v;
+                    }
+                    break;
+                }
+                case BIND_TEXTURE:
+                {
+                    TextureBind t = read<TextureBind>(at);
+                    if (textures[t.unit] != t.texture)
+                    {
+                        if (activeUnit != t.unit)
+                        {
+                            glActiveTexture(GL_TEXTURE0 + t.unit);
+                            activeUnit = t.unit;
+                        }
+                        glBindTexture(GL_TEXTURE_2D, t.texture);
+                        textures[t.unit] = t.texture;
+                    }
+                    break;
+                }
+                case UNIFORM_INT:
+                {
+                    IntUniform u = read<IntUniform>(at);
+                    glUniform1i(u.location, u.value);
+                    break;
+                }
+                case UNIFORM_FLOAT:
+                {
+                    FloatUniform u = read<FloatUniform>(at);
+                    glUniform1f(u.location, u.value);
+                    break;
+                }
+                case UNIFORM_VEC3:
+                {
+                    Vec3Uniform u = read<Vec3Uniform>(at);
+                    glUniform3fv(u.location, 1, glm::value_ptr(u.value));
+                    break;
+                }
+                case UNIFORM_MAT4:
+                {
+                    Mat4Uniform u = read<Mat4Uniform>(at);
+                    glUniformMatrix4fv(u.location, 1, GL_FALSE, glm::value_ptr(u.value));
+                    break;
+                }
+                case DRAW_ARRAYS:
+                {
+                    DrawArrays d = read<DrawArrays>(at);
+                    glDrawArrays(d.mode, d.first, d.count);
+                    break;
+                }
+                case DRAW_ELEMENTS:
+                {
+                    DrawElements d = read<DrawElements>(at);
+                    glDrawElements(d.mode, d.count, d.type, (void*)d.offset);
+                    break;
+                }
+                case DRAW_ARRAYS_INSTANCED:
+                {
+                    DrawArrays d = read<DrawArrays>(at);
+                    glDrawArraysInstanced(d.mode, d.first, d.count, d.instances);
+                    break;
+                }
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+}
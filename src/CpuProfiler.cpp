@@ -0,0 +1,182 @@
+#ifdef CPU_PROFILE
+
+#include "CpuProfiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// events per thread between flushes, a power of two
+#define RING_SIZE 16384
+#define FLUSH_MILLISECONDS 50
+
+namespace CpuProfiler
+{
+    struct Event {
+        const char *name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // single producer (its thread), single consumer (the flusher)
+    struct ThreadBuffer {
+        Event events[RING_SIZE];
+        std::atomic<uint64_t> head;
+        std::atomic<uint64_t> tail;
+        std::atomic<uint64_t> dropped;
+        unsigned int id;
+        const char *name;
+
+        ThreadBuffer(unsigned int i) : head(0), tail(0), dropped(0), id(i), name(nullptr) {}
+    };
+
+    // buffers outlive their threads, a trace can still hold events from a thread that has exited
+    std::mutex registryLock;
+    std::vector<ThreadBuffer *> buffers;
+    thread_local ThreadBuffer *threadBuffer = nullptr;
+
+    std::atomic<bool> recording(false);
+    std::thread flusher;
+    std::mutex flusherLock;
+    std::condition_variable flusherWake;
+    bool flusherQuit = false;
+    FILE *file = nullptr;
+    bool firstEvent = true;
+    uint64_t epoch = 0;
+
+    ThreadBuffer *thread_buffer()
+    {
+        if (threadBuffer == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(registryLock);
+            threadBuffer = new ThreadBuffer((unsigned int)buffers.size());
+            buffers.push_back(threadBuffer);
+        }
+        return threadBuffer;
+    }
+
+    uint64_t now_ns()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void record(const char *name, uint64_t begin, uint64_t end)
+    {
+        if (!recording.load(std::memory_order_relaxed)) return;
+        ThreadBuffer *buffer = thread_buffer();
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        if (head - buffer->tail.load(std::memory_order_acquire) >= RING_SIZE)
+        {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer->events[head & (RING_SIZE - 1)] = Event{name, begin, end};
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+
+    void set_thread_name(const char *name)
+    {
+        ThreadBuffer *buffer = thread_buffer();
+        std::lock_guard<std::mutex> lock(registryLock);
+        buffer->name = name;
+    }
+
+    /* Writes every finished event out of the rings. Only the flusher, or stop() once it has joined, calls this */
+    void drain()
+    {
+        std::vector<ThreadBuffer *> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(registryLock);
+            snapshot = buffers;
+        }
+        for (ThreadBuffer *buffer : snapshot)
+        {
+            uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            for (uint64_t i = tail; i < head; i++)
+            {
+                const Event &event = buffer->events[i & (RING_SIZE - 1)];
+                // microseconds from start(), a scope that began before it starts slightly negative
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        firstEvent ? "\n" : ",\n", event.name, buffer->id,
+                        ((double)event.begin - (double)epoch) / 1000.0, (event.end - event.begin) / 1000.0);
+                firstEvent = false;
+            }
+            buffer->tail.store(head, std::memory_order_release);
+        }
+    }
+
+    void flusher_loop()
+    {
+        std::unique_lock<std::mutex> lock(flusherLock);
+        while (!flusherQuit)
+        {
+            flusherWake.wait_for(lock, std::chrono::milliseconds(FLUSH_MILLISECONDS));
+            drain();
+        }
+    }
+
+    bool start(const char *path)
+    {
+        if (file != nullptr) return false;
+        file = fopen(path, "w");
+        if (file == nullptr)
+        {
+            printf("Failed to open %s for the CPU trace\n", path);
+            return false;
+        }
+        fprintf(file, "{\"traceEvents\":[");
+        firstEvent = true;
+        epoch = now_ns();
+
+        // whatever was left from an earlier run is not part of this one
+        {
+            std::lock_guard<std::mutex> lock(registryLock);
+            for (ThreadBuffer *buffer : buffers)
+            {
+                buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+                buffer->dropped.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        flusherQuit = false;
+        recording.store(true, std::memory_order_release);
+        flusher = std::thread(flusher_loop);
+        return true;
+    }
+
+    void stop()
+    {
+        if (file == nullptr) return;
+        recording.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(flusherLock);
+            flusherQuit = true;
+        }
+        flusherWake.notify_one();
+        flusher.join();
+        drain();
+
+        uint64_t dropped = 0;
+        std::lock_guard<std::mutex> lock(registryLock);
+        for (ThreadBuffer *buffer : buffers)
+        {
+            char fallback[32];
+            snprintf(fallback, sizeof(fallback), "thread %u", buffer->id);
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    firstEvent ? "\n" : ",\n", buffer->id, buffer->name != nullptr ? buffer->name : fallback);
+            firstEvent = false;
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+        fprintf(file, "\n]}\n");
+        fclose(file);
+        file = nullptr;
+        if (dropped > 0) printf("CPU trace dropped %llu events, the flusher fell behind\n", (unsigned long long)dropped);
+    }
+};
+
+#endif // CPU_PROFILE
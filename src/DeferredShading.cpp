@@ -0,0 +1,325 @@
+#include "DeferredShading.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace
+{
+    // shared by both lighting shaders: G-buffer lookups and the same light model as cluster_lighting()
+    const char *gbufferReadSource =
+        "uniform sampler2D gAlbedo;\n"
+        "uniform sampler2D gNormal;\n"
+        "uniform sampler2D gDepth;\n"
+        "uniform mat4 inverseViewProj;\n"
+        "uniform vec2 viewportSize;\n"
+        "uniform vec3 viewPos;\n"
+        "vec3 decode_normal(vec2 f)\n"
+        "{\n"
+        "  f = f * 2.0 - 1.0;\n"
+        "  vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));\n"
+        "  float t = clamp(-n.z, 0.0, 1.0);\n"
+        "  n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n"
+        "  return normalize(n);\n"
+        "}\n"
+        "vec3 world_position(vec2 uv, float depth)\n"
+        "{\n"
+        "  vec4 p = inverseViewProj * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);\n"
+        "  return p.xyz / p.w;\n"
+        "}\n"
+        "vec3 shade(vec3 pos, vec3 normal, float specularStrength, vec3 lightPos, float radius, vec3 colour)\n"
+        "{\n"
+        "  vec3 toLight = lightPos - pos;\n"
+        "  float dist = length(toLight);\n"
+        "  if (dist >= radius) return vec3(0.0);\n"
+        "  float x = dist / radius;\n"
+        "  float window = 1.0 - x * x * x * x;\n"
+        "  vec3 lightDir = toLight / max(dist, 1e-4);\n"
+        "  float diff = max(dot(normal, lightDir), 0.0);\n"
+        "  float spec = pow(max(dot(normalize(viewPos - pos), reflect(-lightDir, normal)), 0.0), 32);\n"
+        "  return (diff + specularStrength * spec) * colour * window * window;\n"
+        "}\n";
+
+    // a triangle that covers the screen, built from gl_VertexID so no buffer is needed
+    const char *directVertexShaderSource = "#version 330 core\n"
+        "void main()\n"
+        "{\n"
+        "  vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+        "  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+        "}";
+
+    const char *directFragmentShaderBody =
+        "out vec4 FragColor;\n"
+        "uniform vec3 mainLightPos;\n"
+        "uniform float mainLightRadius;\n"
+        "uniform vec3 mainLightColour;\n"
+        "uniform vec3 clearColour;\n"
+        "void main()\n"
+        "{\n"
+        "  vec2 uv = gl_FragCoord.xy / viewportSize;\n"
+        "  float depth = texture(gDepth, uv).r;\n"
+        "  gl_FragDepth = depth;\n"
+        "  if (depth >= 1.0)\n"
+        "  {\n"
+        "    FragColor = vec4(clearColour, 1.0);\n"
+        "    return;\n"
+        "  }\n"
+        "  vec4 albedo = texture(gAlbedo, uv);\n"
+        "  if (albedo.a >= 1.0)\n"
+        "  {\n"
+        "    FragColor = vec4(albedo.rgb, 1.0);\n"
+        "    return;\n"
+        "  }\n"
+        "  vec3 pos = world_position(uv, depth);\n"
+        "  vec3 normal = decode_normal(texture(gNormal, uv).rg);\n"
+        "  vec3 direct = shade(pos, normal, albedo.a, mainLightPos, mainLightRadius, mainLightColour);\n"
+        "  vec3 light = probe_irradiance(pos, normal) + shadow_factor(pos, normal) * direct;\n"
+        "  FragColor = vec4(light * albedo.rgb, 1.0);\n"
+        "}";
+
+    // the unit cube scaled to the light's diameter, so it holds the whole sphere
+    const char *volumeVertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n"
+        "layout (location = 3) in vec4 aPositionRadius;\n"
+        "layout (location = 4) in vec3 aColour;\n"
+        "flat out vec4 LightPositionRadius;\n"
+        "flat out vec3 LightColour;\n"
+        "uniform mat4 viewProj;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_Position = viewProj * vec4(aPos * aPositionRadius.w * 2.0 + aPositionRadius.xyz, 1.0);\n"
+        "  LightPositionRadius = aPositionRadius;\n"
+        "  LightColour = aColour;\n"
+        "}";
+
+    const char *volumeFragmentShaderBody =
+        "flat in vec4 LightPositionRadius;\n"
+        "flat in vec3 LightColour;\n"
+        "out vec4 FragColor;\n"
+        "void main()\n"
+        "{\n"
+        "  vec2 uv = gl_FragCoord.xy / viewportSize;\n"
+        "  float depth = texture(gDepth, uv).r;\n"
+        "  vec4 albedo = texture(gAlbedo, uv);\n"
+        "  if (depth >= 1.0 || albedo.a >= 1.0) discard;\n"
+        "  vec3 pos = world_position(uv, depth);\n"
+        "  vec3 normal = decode_normal(texture(gNormal, uv).rg);\n"
+        "  FragColor = vec4(shade(pos, normal, albedo.a, LightPositionRadius.xyz, LightPositionRadius.w, LightColour) * albedo.rgb, 1.0);\n"
+        "}";
+
+    // unit cube with every face wound counter-clockwise from outside, so face culling can be trusted
+    const float volumeVertices[] = {
+        -0.5f, -0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,  -0.5f,  0.5f, -0.5f,
+        -0.5f,  0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,  -0.5f, -0.5f,  0.5f,
+         0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,   0.5f,  0.5f,  0.5f,
+         0.5f,  0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f, -0.5f, -0.5f,
+         0.5f, -0.5f, -0.5f,   0.5f, -0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,
+        -0.5f, -0.5f,  0.5f,  -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,
+        -0.5f,  0.5f, -0.5f,  -0.5f,  0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+         0.5f,  0.5f,  0.5f,   0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+        -0.5f,  0.5f, -0.5f,   0.5f,  0.5f, -0.5f,   0.5f, -0.5f, -0.5f,
+         0.5f, -0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+        -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+         0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,
+    };
+
+    ShaderHelper *build(const char *vertexSource, const char *fragmentBody)
+    {
+        std::string fragment = std::string("#version 330 core\n") + gbufferReadSource + fragmentBody;
+        const char *fragmentSource = fragment.c_str();
+        ShaderHelper *shader = new ShaderHelper();
+        shader->add_shader(GL_VERTEX_SHADER, &vertexSource);
+        shader->add_shader(GL_FRAGMENT_SHADER, &fragmentSource);
+        shader->link_shaders();
+        return shader;
+    }
+}
+
+const char *DeferredShading::geometryFragmentShaderSource = "#version 330 core\n"
+    "in vec3 Normal;\n"
+    "in vec3 FragPos;\n"
+    "layout (location = 0) out vec4 gAlbedo;\n"
+    "layout (location = 1) out vec2 gNormal;\n"
+    "uniform vec3 albedo;\n"
+    "uniform float specular;\n"
+    "vec2 oct_wrap(vec2 v)\n"
+    "{\n"
+    "  return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "  vec3 n = normalize(Normal);\n"
+    "  n /= abs(n.x) + abs(n.y) + abs(n.z);\n"
+    "  n.xy = n.z >= 0.0 ? n.xy : oct_wrap(n.xy);\n"
+    "  gAlbedo = vec4(albedo, specular);\n"
+    "  gNormal = n.xy * 0.5 + 0.5;\n"
+    "}";
+
+DeferredShading::DeferredShading()
+    : m_framebuffer(0), m_albedo(0), m_normal(0), m_depth(0), m_width(0), m_height(0), m_target(0),
+      m_directShader(nullptr), m_volumeShader(nullptr), m_emptyVao(0), m_volumeVao(0), m_volumeVbo(0), m_volumeInstances(0)
+{
+}
+
+DeferredShading::~DeferredShading()
+{
+    if (m_directShader == nullptr) return;
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_albedo);
+    glDeleteTextures(1, &m_normal);
+    glDeleteTextures(1, &m_depth);
+    glDeleteVertexArrays(1, &m_emptyVao);
+    glDeleteVertexArrays(1, &m_volumeVao);
+    glDeleteBuffers(1, &m_volumeVbo);
+    glDeleteBuffers(1, &m_volumeInstances);
+    delete m_directShader;
+    delete m_volumeShader;
+}
+
+void DeferredShading::setup()
+{
+    std::string directBody = std::string(ShadowCache::shaderSource) + LightProbes::shaderSource + directFragmentShaderBody;
+    m_directShader = build(directVertexShaderSource, directBody.c_str());
+    m_volumeShader = build(volumeVertexShaderSource, volumeFragmentShaderBody);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glGenTextures(1, &m_albedo);
+    glGenTextures(1, &m_normal);
+    glGenTextures(1, &m_depth);
+
+    glGenVertexArrays(1, &m_emptyVao);
+
+    glGenVertexArrays(1, &m_volumeVao);
+    glBindVertexArray(m_volumeVao);
+    glGenBuffers(1, &m_volumeVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_volumeVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(volumeVertices), volumeVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glGenBuffers(1, &m_volumeInstances);
+    glBindBuffer(GL_ARRAY_BUFFER, m_volumeInstances);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(VolumeInstance), (void*)offsetof(VolumeInstance, positionRadius));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(VolumeInstance), (void*)offsetof(VolumeInstance, colour));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DeferredShading::resize(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    const struct { unsigned int texture; GLenum internalFormat; GLenum format; GLenum type; } targets[3] = {
+        { m_albedo, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE },
+        { m_normal, GL_RG16, GL_RG, GL_UNSIGNED_SHORT },
+        { m_depth, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8 },
+    };
+    for (int i = 0; i < 3; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, targets[i].texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, targets[i].internalFormat, width, height, 0, targets[i].format, targets[i].type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normal, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        printf("ERROR! G-buffer is incomplete at %dx%d\n", width, height);
+    }
+}
+
+void DeferredShading::begin_geometry(int width, int height)
+{
+    GLint target;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    m_target = target;
+
+    if (width != m_width || height != m_height) resize(width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    // depth cleared to far marks background for the lighting pass
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DeferredShading::bind_gbuffer(ShaderHelper *shader, const glm::mat4 &inverseViewProj, const glm::vec3 &viewPos)
+{
+    shader->set_uniform("gAlbedo", 0);
+    shader->set_uniform("gNormal", 1);
+    shader->set_uniform("gDepth", 2);
+    shader->set_uniform_matrix4("inverseViewProj", 1, GL_FALSE, glm::value_ptr(inverseViewProj));
+    shader->set_uniform("viewPos", viewPos);
+    glUniform2f(shader->get_uniform_location("viewportSize"), (float)m_width, (float)m_height);
+}
+
+void DeferredShading::light(const PointLight &mainLight, const ShadowCache &shadows, const LightProbes &probes,
+                            const PointLight *pointLights, unsigned int pointLightCount, const glm::mat4 &viewProj, const glm::vec3 &viewPos)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_target);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_albedo);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_normal);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_depth);
+    glActiveTexture(GL_TEXTURE0);
+
+    glm::mat4 inverseViewProj = glm::inverse(viewProj);
+
+    // ambient and the main light everywhere, writing depth back so forward drawing can follow
+    bind_gbuffer(m_directShader, inverseViewProj, viewPos);
+    m_directShader->set_uniform("mainLightPos", mainLight.position);
+    m_directShader->set_uniform("mainLightRadius", mainLight.radius);
+    m_directShader->set_uniform("mainLightColour", mainLight.colour);
+    m_directShader->set_uniform("clearColour", 0.1f, 0.1f, 0.1f);
+    shadows.bind(m_directShader, ShadowCache::TEXTURE_UNIT);
+    probes.bind(m_directShader, LightProbes::TEXTURE_UNIT);
+    glDepthFunc(GL_ALWAYS);
+    glBindVertexArray(m_emptyVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDepthFunc(GL_LESS);
+
+    if (pointLightCount > 0)
+    {
+        m_volumes.resize(pointLightCount);
+        for (unsigned int i = 0; i < pointLightCount; i++)
+        {
+            m_volumes[i] = VolumeInstance{glm::vec4(pointLights[i].position, pointLights[i].radius), pointLights[i].colour};
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, m_volumeInstances);
+        glBufferData(GL_ARRAY_BUFFER, m_volumes.size() * sizeof(VolumeInstance), m_volumes.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // back faces only and no depth test, so a volume still lights when the camera is inside it
+        bind_gbuffer(m_volumeShader, inverseViewProj, viewPos);
+        m_volumeShader->set_uniform_matrix4("viewProj", 1, GL_FALSE, glm::value_ptr(viewProj));
+        glDisable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glBindVertexArray(m_volumeVao);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, pointLightCount);
+        glDisable(GL_BLEND);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_DEPTH_TEST);
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,426 @@
+#include "FrameEncoder.h"
+#include "CpuProfiler.h"
+
+#include <cstring>
+
+#include <sys/stat.h>
+
+// a stored deflate block holds at most this many bytes
+#define STORED_BLOCK_SIZE 65535
+
+static unsigned int crc32(unsigned int crc, const unsigned char *data, size_t size)
+{
+    static unsigned int table[256];
+    static bool tableBuilt = [] {
+        for (unsigned int n = 0; n < 256; n++)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return true;
+    }();
+    (void)tableBuilt;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void put_u32(std::vector<unsigned char> &out, unsigned int value)
+{
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)value);
+}
+
+static bool write_chunk(FILE *file, const char *type, const unsigned char *data, size_t size)
+{
+    unsigned char header[8] = {
+        (unsigned char)(size >> 24), (unsigned char)(size >> 16), (unsigned char)(size >> 8), (unsigned char)size,
+        (unsigned char)type[0], (unsigned char)type[1], (unsigned char)type[2], (unsigned char)type[3],
+    };
+    unsigned int crc = crc32(crc32(0, header + 4, 4), data, size);
+    unsigned char footer[4] = {(unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc};
+    return fwrite(header, 1, 8, file) == 8 && fwrite(data, 1, size, file) == size && fwrite(footer, 1, 4, file) == 4;
+}
+
+/* RGB PNG, scanlines unfiltered inside a zlib stream of stored blocks. scratch is reused between frames */
+static bool write_png(FILE *file, int width, int height, const unsigned char *rgba, std::vector<unsigned char> &scratch)
+{
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    std::vector<unsigned char> header;
+    put_u32(header, (unsigned int)width);
+    put_u32(header, (unsigned int)height);
+    const unsigned char format[5] = {8, 2, 0, 0, 0};   // 8 bit, RGB, deflate, no filter, not interlaced
+    header.insert(header.end(), format, format + 5);
+
+    // the raw image is a filter byte then the pixels for every row, top row first
+    size_t rowBytes = (size_t)width * 3 + 1;
+    size_t rawSize = rowBytes * height;
+    size_t blocks = (rawSize + STORED_BLOCK_SIZE - 1) / STORED_BLOCK_SIZE;
+    scratch.resize(2 + rawSize + blocks * 5 + 4);
+    unsigned char *out = scratch.data();
+    *out++ = 0x78;
+    *out++ = 0x01;
+
+    unsigned long long a = 1, b = 0;
+    size_t blockLeft = 0;
+    size_t remaining = rawSize;
+    auto put = [&](unsigned char byte) {
+        if (blockLeft == 0)
+        {
+            blockLeft = remaining < STORED_BLOCK_SIZE ? remaining : STORED_BLOCK_SIZE;
+            remaining -= blockLeft;
+            *out++ = remaining == 0 ? 1 : 0;
+            *out++ = (unsigned char)blockLeft;
+            *out++ = (unsigned char)(blockLeft >> 8);
+            *out++ = (unsigned char)~blockLeft;
+            *out++ = (unsigned char)(~blockLeft >> 8);
+        }
+        *out++ = byte;
+        blockLeft--;
+        // Adler-32, 64 bit sums only need reducing once a row
+        a += byte;
+        b += a;
+    };
+
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char *row = rgba + (size_t)(height - 1 - y) * width * 4;
+        put(0);
+        for (int x = 0; x < width; x++)
+        {
+            put(row[x * 4]);
+            put(row[x * 4 + 1]);
+            put(row[x * 4 + 2]);
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    unsigned int adler = (unsigned int)((b << 16) | a);
+    *out++ = (unsigned char)(adler >> 24);
+    *out++ = (unsigned char)(adler >> 16);
+    *out++ = (unsigned char)(adler >> 8);
+    *out++ = (unsigned char)adler;
+
+    return fwrite(signature, 1, 8, file) == 8 &&
+           write_chunk(file, "IHDR", header.data(), header.size()) &&
+           write_chunk(file, "IDAT", scratch.data(), out - scratch.data()) &&
+           write_chunk(file, "IEND", nullptr, 0);
+}
+
+static bool write_ppm(FILE *file, int width, int height, const unsigned char *rgba, std::vector<unsigned char> &scratch)
+{
+    scratch.resize((size_t)width * 3);
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        const unsigned char *row = rgba + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++)
+        {
+            memcpy(&scratch[x * 3], &row[x * 4], 3);
+        }
+        if (fwrite(scratch.data(), 1, scratch.size(), file) != scratch.size()) return false;
+    }
+    return true;
+}
+
+/* RGB24 rows, top row first */
+static void encode_raw(int width, int height, const unsigned char *rgba, std::vector<unsigned char> &out)
+{
+    out.resize((size_t)width * height * 3);
+    unsigned char *dst = out.data();
+    for (int y = height - 1; y >= 0; y--)
+    {
+        const unsigned char *row = rgba + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++)
+        {
+            *dst++ = row[x * 4];
+            *dst++ = row[x * 4 + 1];
+            *dst++ = row[x * 4 + 2];
+        }
+    }
+}
+
+/* A Y4M FRAME: BT.601 studio range Y, then U and V averaged over 2x2 blocks */
+static void encode_y4m(int width, int height, const unsigned char *rgba, std::vector<unsigned char> &out)
+{
+    static const char marker[] = "FRAME\n";
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    size_t lumaSize = (size_t)width * height;
+    size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+    out.resize(sizeof(marker) - 1 + lumaSize + chromaSize * 2);
+    memcpy(out.data(), marker, sizeof(marker) - 1);
+    unsigned char *luma = out.data() + sizeof(marker) - 1;
+    unsigned char *u = luma + lumaSize;
+    unsigned char *v = u + chromaSize;
+
+    // GL rows start at the bottom, Y4M rows at the top
+    auto pixel = [&](int x, int y) { return rgba + ((size_t)(height - 1 - y) * width + x) * 4; };
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const unsigned char *p = pixel(x, y);
+            luma[(size_t)y * width + x] = (unsigned char)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+        }
+    }
+    for (int cy = 0; cy < chromaHeight; cy++)
+    {
+        for (int cx = 0; cx < chromaWidth; cx++)
+        {
+            // an odd last column or row repeats its edge
+            int x0 = cx * 2, x1 = x0 + 1 < width ? x0 + 1 : x0;
+            int y0 = cy * 2, y1 = y0 + 1 < height ? y0 + 1 : y0;
+            const unsigned char *p[4] = {pixel(x0, y0), pixel(x1, y0), pixel(x0, y1), pixel(x1, y1)};
+            int r = 0, g = 0, b = 0;
+            for (const unsigned char *q : p)
+            {
+                r += q[0];
+                g += q[1];
+                b += q[2];
+            }
+            u[(size_t)cy * chromaWidth + cx] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+            v[(size_t)cy * chromaWidth + cx] = (unsigned char)(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+        }
+    }
+}
+
+bool FrameEncoder::parse_format(const char *name, Format &format)
+{
+    if (strcmp(name, "png") == 0) format = FORMAT_PNG;
+    else if (strcmp(name, "ppm") == 0) format = FORMAT_PPM;
+    else if (strcmp(name, "y4m") == 0) format = FORMAT_Y4M;
+    else if (strcmp(name, "raw") == 0) format = FORMAT_RAW;
+    else return false;
+    return true;
+}
+
+FrameEncoder::FrameEncoder(const std::string &path, Format format, unsigned int workers, unsigned long long firstFrame, int framesPerSecond)
+    : m_path(path), m_format(format), m_framesPerSecond(framesPerSecond), m_quit(false), m_written(0), m_failed(0),
+      m_streamWidth(0), m_streamHeight(0), m_sizeReported(false), m_stream(nullptr), m_headerWritten(false), m_nextWrite(firstFrame)
+{
+    if (is_stream(format))
+    {
+        m_stream = fopen(path.c_str(), "wb");
+        if (m_stream == nullptr) printf("Failed to open %s for captured frames\n", path.c_str());
+    }
+    else
+    {
+        // already there is fine, anything else shows up when the first frame fails to open
+        mkdir(path.c_str(), 0755);
+    }
+
+    if (workers == 0) workers = 1;
+    for (unsigned int i = 0; i < workers * FRAMES_PER_WORKER; i++)
+    {
+        m_frames.push_back(new Frame());
+        m_free.push_back(m_frames.back());
+    }
+    for (unsigned int i = 0; i < workers; i++)
+    {
+        m_workers.emplace_back(&FrameEncoder::worker_loop, this);
+    }
+}
+
+FrameEncoder::~FrameEncoder()
+{
+    finish();
+    for (Frame *frame : m_frames)
+    {
+        delete frame;
+    }
+}
+
+void FrameEncoder::submit(unsigned long long index, int width, int height, const unsigned char *rgba)
+{
+    PROFILE_SCOPE("FrameEncoder::submit");
+    if (rgba == nullptr)
+    {
+        skip(index);
+        return;
+    }
+    if (is_stream(m_format))
+    {
+        if (m_streamWidth == 0)
+        {
+            m_streamWidth = width;
+            m_streamHeight = height;
+        }
+        // the Y4M header has already said the size and raw has no way to say it changed
+        if (width != m_streamWidth || height != m_streamHeight)
+        {
+            if (!m_sizeReported) printf("Frames of %dx%d left out of %s, the stream is %dx%d\n", width, height, m_path.c_str(), m_streamWidth, m_streamHeight);
+            m_sizeReported = true;
+            skip(index);
+            return;
+        }
+    }
+
+    Frame *frame;
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_freed.wait(lock, [this] { return !m_free.empty(); });
+        frame = m_free.back();
+        m_free.pop_back();
+    }
+
+    frame->index = index;
+    frame->width = width;
+    frame->height = height;
+    frame->rgba.assign(rgba, rgba + (size_t)width * height * 4);
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_queue.push_back(frame);
+    }
+    m_queued.notify_one();
+}
+
+void FrameEncoder::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_quit = true;
+    }
+    m_queued.notify_all();
+    for (std::thread &worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+
+    // frames after a gap, if a read never came back
+    write_ready(true);
+    if (m_stream != nullptr)
+    {
+        if (fclose(m_stream) != 0) printf("Failed to finish writing %s\n", m_path.c_str());
+        m_stream = nullptr;
+    }
+}
+
+void FrameEncoder::release(Frame *frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_free.push_back(frame);
+    }
+    m_freed.notify_one();
+}
+
+/* Counts a frame that won't be written, a stream steps over it instead of waiting */
+void FrameEncoder::skip(unsigned long long index)
+{
+    m_failed++;
+    if (!is_stream(m_format)) return;
+    {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        m_skipped.insert(index);
+    }
+    write_ready(false);
+}
+
+void FrameEncoder::worker_loop()
+{
+    PROFILE_THREAD("encoder");
+    std::vector<unsigned char> scratch;
+    while (true)
+    {
+        Frame *frame;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            // finish() still waits for the queue to empty
+            m_queued.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+            if (m_queue.empty()) return;
+            frame = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        bool ok = encode(*frame, scratch);
+        if (ok && is_stream(m_format))
+        {
+            // the buffer goes back once it has been written in order
+            {
+                std::lock_guard<std::mutex> lock(m_writeLock);
+                m_ready[frame->index] = frame;
+            }
+            write_ready(false);
+            continue;
+        }
+        if (!ok && is_stream(m_format))
+        {
+            unsigned long long index = frame->index;
+            release(frame);
+            skip(index);
+            continue;
+        }
+
+        if (ok) m_written++;
+        else m_failed++;
+        release(frame);
+    }
+}
+
+/* Appends every encoded frame that is next in line to the stream, stepping over skipped ones. flush writes them all,
+   gaps or not */
+void FrameEncoder::write_ready(bool flush)
+{
+    std::lock_guard<std::mutex> lock(m_writeLock);
+    while (true)
+    {
+        while (!m_skipped.empty() && *m_skipped.begin() <= m_nextWrite)
+        {
+            if (*m_skipped.begin() == m_nextWrite) m_nextWrite++;
+            m_skipped.erase(m_skipped.begin());
+        }
+        if (m_ready.empty() || (!flush && m_ready.begin()->first != m_nextWrite)) break;
+
+        Frame *frame = m_ready.begin()->second;
+        m_ready.erase(m_ready.begin());
+
+        if (!m_headerWritten && m_stream != nullptr && m_format == FORMAT_Y4M)
+        {
+            fprintf(m_stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", frame->width, frame->height, m_framesPerSecond);
+        }
+        m_headerWritten = true;
+        bool ok = m_stream != nullptr && fwrite(frame->encoded.data(), 1, frame->encoded.size(), m_stream) == frame->encoded.size();
+        if (ok) m_written++;
+        else m_failed++;
+
+        m_nextWrite = frame->index + 1;
+        release(frame);
+    }
+}
+
+bool FrameEncoder::encode(Frame &frame, std::vector<unsigned char> &scratch)
+{
+    PROFILE_SCOPE("FrameEncoder::encode");
+    if (m_format == FORMAT_Y4M)
+    {
+        encode_y4m(frame.width, frame.height, frame.rgba.data(), frame.encoded);
+        return true;
+    }
+    if (m_format == FORMAT_RAW)
+    {
+        encode_raw(frame.width, frame.height, frame.rgba.data(), frame.encoded);
+        return true;
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/frame_%06llu.%s", m_path.c_str(), frame.index, m_format == FORMAT_PNG ? "png" : "ppm");
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr)
+    {
+        printf("Failed to open %s for a captured frame\n", path);
+        return false;
+    }
+    bool ok = m_format == FORMAT_PNG ? write_png(file, frame.width, frame.height, frame.rgba.data(), scratch)
+                                     : write_ppm(file, frame.width, frame.height, frame.rgba.data(), scratch);
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,105 @@
+#include "FrameReadback.h"
+#include "CpuProfiler.h"
+
+#include <chrono>
+
+// how long to wait on a read the ring needs back, a second is long enough to mean the GPU is gone
+#define WAIT_NANOSECONDS 1000000000ull
+
+FrameReadback::FrameReadback(Sink sink, unsigned int ringSize)
+    : m_sink(sink), m_slots(ringSize < 2 ? 2 : ringSize), m_next(0), m_pending(0), m_captured(0), m_stalls(0), m_dropped(0), m_milliseconds(0.0)
+{
+    for (Slot &slot : m_slots)
+    {
+        glGenBuffers(1, &slot.buffer);
+        slot.fence = nullptr;
+        slot.size = 0;
+    }
+}
+
+FrameReadback::~FrameReadback()
+{
+    for (Slot &slot : m_slots)
+    {
+        if (slot.fence != nullptr) glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+/* Hands over the oldest outstanding read if it is done, or once it is when wait is set */
+bool FrameReadback::deliver(bool wait)
+{
+    if (m_pending == 0) return false;
+    Slot &slot = m_slots[(m_next + m_slots.size() - m_pending) % m_slots.size()];
+
+    GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? WAIT_NANOSECONDS : 0);
+    if (status == GL_TIMEOUT_EXPIRED && !wait) return false;
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    m_pending--;
+    // a read that never finished is dropped rather than waited on forever
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+    {
+        m_dropped++;
+        m_sink(slot.frame, slot.width, slot.height, nullptr);
+        return true;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const unsigned char *pixels = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)slot.width * slot.height * 4, GL_MAP_READ_BIT);
+    if (pixels == nullptr) m_dropped++;
+    m_sink(slot.frame, slot.width, slot.height, pixels);
+    if (pixels != nullptr) glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void FrameReadback::capture(unsigned long long frame, int width, int height)
+{
+    PROFILE_SCOPE("FrameReadback::capture");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (deliver(false)) {}
+    if (m_pending == m_slots.size())
+    {
+        // every buffer is still being read into, the GPU is that far behind
+        m_stalls++;
+        deliver(true);
+    }
+
+    Slot &slot = m_slots[m_next];
+    size_t size = (size_t)width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.size != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.size = size;
+    }
+    // RGBA rows are always 4 byte aligned, the copy stays on the driver's fast path
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void *)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = frame;
+    slot.width = width;
+    slot.height = height;
+
+    m_next = (m_next + 1) % m_slots.size();
+    m_pending++;
+    m_captured++;
+    m_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrameReadback::poll()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (deliver(false)) {}
+    m_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrameReadback::flush()
+{
+    while (m_pending > 0)
+    {
+        deliver(true);
+    }
+}
@@ -0,0 +1,309 @@
+#include "GlStats.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace GlStats
+{
+    const char *functionNames[FUNCTION_COUNT] = {
+#define X(name) #name,
+#include "GlFunctions.def"
+#undef X
+    };
+
+    // what each entry point pointed at before install()
+    void *originals[FUNCTION_COUNT];
+    bool stateFunction[FUNCTION_COUNT];
+    bool uniformFunction[FUNCTION_COUNT];
+
+    // pointers add_entry_point() was given, until they are hooked
+    void **loaded[FUNCTION_COUNT];
+
+    bool isInstalled = false;
+    FrameStats current;
+    FrameStats last;
+    FILE *csv = nullptr;
+
+    GLuint boundProgram = 0;
+    GLuint boundVertexArray = 0;
+    GLuint boundFramebuffer = 0;
+
+    // everything else that only changes state, the binds are matched by prefix
+    const char *stateFunctions[] = {
+        "glEnable", "glDisable", "glBlendFunc", "glBlendFuncSeparate", "glBlendEquation", "glBlendEquationSeparate",
+        "glDepthFunc", "glDepthMask", "glColorMask", "glCullFace", "glFrontFace", "glPolygonMode", "glViewport",
+        "glScissor", "glUseProgram", "glActiveTexture", "glPixelStorei", "glStencilFunc", "glStencilOp", "glStencilMask",
+        "glClearColor", "glDrawBuffer", "glDrawBuffers", "glReadBuffer",
+    };
+
+    unsigned int components(GLenum format)
+    {
+        switch (format)
+        {
+            case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: return 1;
+            case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL: return 2;
+            case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: return 3;
+            default: return 4;
+        }
+    }
+
+    unsigned int type_size(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_UNSIGNED_BYTE: case GL_BYTE: return 1;
+            case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return 2;
+            default: return 4;
+        }
+    }
+
+    void draw(GLenum mode, GLsizei count, GLsizei instances)
+    {
+        current.drawCalls++;
+        if (mode == GL_TRIANGLES) current.triangles += (unsigned long long)(count / 3) * instances;
+        else if (mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) current.triangles += (unsigned long long)(count > 2 ? count - 2 : 0) * instances;
+    }
+
+    void texture_upload(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
+    {
+        // a null pointer is either storage without data or an offset into a bound unpack buffer, neither leaves client memory
+        if (pixels == nullptr) return;
+        // packed depth/stencil is one 32 bit value per texel
+        unsigned int texel = format == GL_DEPTH_STENCIL ? 4 : components(format) * type_size(type);
+        current.textureBytes += (unsigned long long)width * height * depth * texel;
+    }
+
+    void bind(GLuint &bound, GLuint object)
+    {
+        if (bound == object) current.redundantBinds++;
+        bound = object;
+    }
+
+    // Argument checks for the entry points that feed the totals, everything else only counts calls
+    template <unsigned int Id>
+    struct Observe {
+        template <typename... Args>
+        static void call(Args...) {}
+    };
+
+    template <> struct Observe<FUNCTION_glDrawArrays> {
+        static void call(GLenum mode, GLint, GLsizei count) { draw(mode, count, 1); }
+    };
+    template <> struct Observe<FUNCTION_glDrawElements> {
+        static void call(GLenum mode, GLsizei count, GLenum, const void *) { draw(mode, count, 1); }
+    };
+    template <> struct Observe<FUNCTION_glDrawRangeElements> {
+        static void call(GLenum mode, GLuint, GLuint, GLsizei count, GLenum, const void *) { draw(mode, count, 1); }
+    };
+    template <> struct Observe<FUNCTION_glDrawElementsBaseVertex> {
+        static void call(GLenum mode, GLsizei count, GLenum, const void *, GLint) { draw(mode, count, 1); }
+    };
+    template <> struct Observe<FUNCTION_glDrawArraysInstanced> {
+        static void call(GLenum mode, GLint, GLsizei count, GLsizei instances) { draw(mode, count, instances); }
+    };
+    template <> struct Observe<FUNCTION_glDrawElementsInstanced> {
+        static void call(GLenum mode, GLsizei count, GLenum, const void *, GLsizei instances) { draw(mode, count, instances); }
+    };
+    template <> struct Observe<FUNCTION_glDrawElementsInstancedBaseVertex> {
+        static void call(GLenum mode, GLsizei count, GLenum, const void *, GLsizei instances, GLint) { draw(mode, count, instances); }
+    };
+    template <> struct Observe<FUNCTION_glMultiDrawArrays> {
+        static void call(GLenum mode, const GLint *, const GLsizei *counts, GLsizei drawCount)
+        {
+            for (GLsizei i = 0; i < drawCount; i++) draw(mode, counts[i], 1);
+        }
+    };
+    template <> struct Observe<FUNCTION_glMultiDrawElements> {
+        static void call(GLenum mode, const GLsizei *counts, GLenum, const void *const *, GLsizei drawCount)
+        {
+            for (GLsizei i = 0; i < drawCount; i++) draw(mode, counts[i], 1);
+        }
+    };
+    template <> struct Observe<FUNCTION_glDrawArraysIndirect> {
+        static void call(GLenum, const void *)
+        {
+            // one command, its counts were written on the GPU
+            current.drawCalls++;
+            current.indirectDraws++;
+        }
+    };
+    template <> struct Observe<FUNCTION_glUseProgram> {
+        static void call(GLuint program) { bind(boundProgram, program); }
+    };
+    template <> struct Observe<FUNCTION_glBindVertexArray> {
+        static void call(GLuint vertexArray) { bind(boundVertexArray, vertexArray); }
+    };
+    template <> struct Observe<FUNCTION_glBindFramebuffer> {
+        static void call(GLenum target, GLuint framebuffer)
+        {
+            // a read-only bind leaves the draw framebuffer alone
+            if (target != GL_READ_FRAMEBUFFER) bind(boundFramebuffer, framebuffer);
+        }
+    };
+    template <> struct Observe<FUNCTION_glBindTexture> {
+        static void call(GLenum, GLuint) { current.textureBinds++; }
+    };
+    template <> struct Observe<FUNCTION_glBufferData> {
+        static void call(GLenum, GLsizeiptr size, const void *data, GLenum)
+        {
+            if (data != nullptr) current.bufferBytes += size;
+        }
+    };
+    template <> struct Observe<FUNCTION_glBufferSubData> {
+        static void call(GLenum, GLintptr, GLsizeiptr size, const void *) { current.bufferBytes += size; }
+    };
+    template <> struct Observe<FUNCTION_glTexImage2D> {
+        static void call(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum format, GLenum type, const void *pixels)
+        {
+            texture_upload(width, height, 1, format, type, pixels);
+        }
+    };
+    template <> struct Observe<FUNCTION_glTexImage3D> {
+        static void call(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLint, GLenum format, GLenum type, const void *pixels)
+        {
+            texture_upload(width, height, depth, format, type, pixels);
+        }
+    };
+    template <> struct Observe<FUNCTION_glTexSubImage2D> {
+        static void call(GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+        {
+            texture_upload(width, height, 1, format, type, pixels);
+        }
+    };
+    template <> struct Observe<FUNCTION_glTexSubImage3D> {
+        static void call(GLenum, GLint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
+        {
+            texture_upload(width, height, depth, format, type, pixels);
+        }
+    };
+
+    template <unsigned int Id, typename R, typename... Args>
+    R APIENTRY counted(Args... args)
+    {
+        current.functionCalls[Id]++;
+        if (stateFunction[Id]) current.stateChanges++;
+        if (uniformFunction[Id]) current.uniformCalls++;
+        Observe<Id>::call(args...);
+        return reinterpret_cast<R (APIENTRYP)(Args...)>(originals[Id])(args...);
+    }
+
+    template <unsigned int Id, typename R, typename... Args>
+    void hook(R (APIENTRYP &pointer)(Args...))
+    {
+        originals[Id] = reinterpret_cast<void *>(pointer);
+        // entry points the driver doesn't have stay null, so glad's checks still see them missing
+        if (pointer != nullptr) pointer = &counted<Id, R, Args...>;
+    }
+
+    void hook_loaded()
+    {
+#define X(name)
+#define X_LOADED(name, R, ...) \
+        if (loaded[FUNCTION_##name] != nullptr) hook<FUNCTION_##name>(*reinterpret_cast<R (APIENTRYP *)(__VA_ARGS__)>(loaded[FUNCTION_##name])); \
+        loaded[FUNCTION_##name] = nullptr;
+#include "GlFunctions.def"
+#undef X
+    }
+
+    bool is_state_function(const char *name)
+    {
+        if (strncmp(name, "glBind", 6) == 0) return true;
+        for (const char *state : stateFunctions)
+        {
+            if (strcmp(name, state) == 0) return true;
+        }
+        return false;
+    }
+
+    void install()
+    {
+        if (isInstalled) return;
+        for (unsigned int i = 0; i < FUNCTION_COUNT; i++)
+        {
+            stateFunction[i] = is_state_function(functionNames[i]);
+            uniformFunction[i] = strncmp(functionNames[i], "glUniform", 9) == 0 && strncmp(functionNames[i], "glUniformBlockBinding", 21) != 0;
+        }
+        memset(&current, 0, sizeof(current));
+        memset(&last, 0, sizeof(last));
+
+#define X(name) hook<FUNCTION_##name>(glad_##name);
+#define X_LOADED(name, ...)
+#include "GlFunctions.def"
+#undef X
+        hook_loaded();
+
+        isInstalled = true;
+    }
+
+    void add_entry_point(Function function, void **pointer)
+    {
+        loaded[function] = pointer;
+        if (isInstalled) hook_loaded();
+    }
+
+    bool installed()
+    {
+        return isInstalled;
+    }
+
+    void end_frame()
+    {
+        if (!isInstalled) return;
+
+        for (unsigned int i = 0; i < FUNCTION_COUNT; i++)
+        {
+            current.calls += current.functionCalls[i];
+        }
+        last = current;
+
+        if (csv != nullptr)
+        {
+            fprintf(csv, "%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu", last.frame, last.calls, last.drawCalls, last.indirectDraws, last.triangles,
+                    last.stateChanges, last.redundantBinds, last.uniformCalls, last.textureBinds, last.bufferBytes, last.textureBytes);
+            for (unsigned int i = 0; i < FUNCTION_COUNT; i++)
+            {
+                fprintf(csv, ",%u", last.functionCalls[i]);
+            }
+            fprintf(csv, "\n");
+        }
+
+        unsigned long long frame = current.frame + 1;
+        memset(&current, 0, sizeof(current));
+        current.frame = frame;
+    }
+
+    const FrameStats &last_frame()
+    {
+        return last;
+    }
+
+    const char *function_name(Function function)
+    {
+        return functionNames[function];
+    }
+
+    bool open_csv(const char *path)
+    {
+        close_csv();
+        csv = fopen(path, "w");
+        if (csv == nullptr)
+        {
+            printf("Failed to open %s for GL stats\n", path);
+            return false;
+        }
+        fprintf(csv, "frame,calls,draw_calls,indirect_draws,triangles,state_changes,redundant_binds,uniform_calls,texture_binds,buffer_bytes,texture_bytes");
+        for (unsigned int i = 0; i < FUNCTION_COUNT; i++)
+        {
+            fprintf(csv, ",%s", functionNames[i]);
+        }
+        fprintf(csv, "\n");
+        return true;
+    }
+
+    void close_csv()
+    {
+        if (csv == nullptr) return;
+        fclose(csv);
+        csv = nullptr;
+    }
+};
@@ -0,0 +1,428 @@
+#include "GpuCuller.h"
+#include "GlStats.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+// glad is generated for GL 3.3, so the 4.x pieces used here are declared and loaded by hand
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+
+namespace
+{
+    typedef void (APIENTRYP DispatchComputeProc)(GLuint x, GLuint y, GLuint z);
+    typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+    typedef void (APIENTRYP DrawArraysIndirectProc)(GLenum mode, const void *indirect);
+    typedef void (APIENTRYP BindImageTextureProc)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+
+    DispatchComputeProc dispatchCompute = nullptr;
+    MemoryBarrierProc memoryBarrier = nullptr;
+    DrawArraysIndirectProc drawArraysIndirect = nullptr;
+    BindImageTextureProc bindImageTexture = nullptr;
+
+    const char *cullShaderSource = "#version 430 core\n"
+        "layout(local_size_x = 64) in;\n"
+        "struct Instance { vec4 centre; vec4 extent; };\n"
+        "layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };\n"
+        "layout(std430, binding = 1) buffer Commands { uint commands[]; };\n"
+        "layout(std430, binding = 2) writeonly buffer Visible { uint visibleIds[]; };\n"
+        "uniform uint instanceCount;\n"
+        "uniform uint capacity;\n"
+        "uniform vec4 planes[6];\n"
+        "uniform bool useDepthPyramid;\n"
+        "uniform mat4 pyramidViewProj;\n"
+        "uniform sampler2D pyramid;\n"
+        "uniform ivec2 pyramidSize;\n"
+        "uniform int pyramidLevels;\n"
+        "bool occluded(vec3 c, vec3 e)\n"
+        "{\n"
+        "  vec3 lo = vec3(1e30);\n"
+        "  vec3 hi = vec3(-1e30);\n"
+        "  for (int i = 0; i < 8; i++)\n"
+        "  {\n"
+        "    vec3 corner = c + e * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);\n"
+        "    vec4 clip = pyramidViewProj * vec4(corner, 1.0);\n"
+        "    if (clip.w < 1e-4) return false;\n"     // crosses the old eye plane, nothing to compare against
+        "    vec3 ndc = clip.xyz / clip.w;\n"
+        "    lo = min(lo, ndc);\n"
+        "    hi = max(hi, ndc);\n"
+        "  }\n"
+        "  if (any(greaterThan(lo.xy, vec2(1.0))) || any(lessThan(hi.xy, vec2(-1.0)))) return false;\n"   // was off screen
+        "  vec2 uvLo = clamp(lo.xy * 0.5 + 0.5, 0.0, 1.0);\n"
+        "  vec2 uvHi = clamp(hi.xy * 0.5 + 0.5, 0.0, 1.0);\n"
+        "  vec2 size = (uvHi - uvLo) * vec2(pyramidSize);\n"
+        // the level where the rectangle is at most one texel across, so it touches at most 2x2 of them
+        "  int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, pyramidLevels - 1);\n"
+        "  ivec2 levelSize = max(pyramidSize >> level, ivec2(1));\n"
+        "  ivec2 t0 = min(ivec2(uvLo * vec2(levelSize)), levelSize - 1);\n"
+        "  ivec2 t1 = min(ivec2(uvHi * vec2(levelSize)), levelSize - 1);\n"
+        "  float farthest = max(max(texelFetch(pyramid, t0, level).r, texelFetch(pyramid, ivec2(t1.x, t0.y), level).r),\n"
+        "                       max(texelFetch(pyramid, ivec2(t0.x, t1.y), level).r, texelFetch(pyramid, t1, level).r));\n"
+        "  return lo.z * 0.5 + 0.5 > farthest;\n"
+        "}\n"
+        "void main()\n"
+        "{\n"
+        "  uint i = gl_GlobalInvocationID.x;\n"
+        "  if (i >= instanceCount) return;\n"
+        "  vec3 c = instances[i].centre.xyz;\n"
+        "  vec3 e = instances[i].extent.xyz;\n"
+        "  for (int p = 0; p < 6; p++)\n"
+        "  {\n"
+        "    if (dot(planes[p].xyz, c) + planes[p].w < -dot(abs(planes[p].xyz), e)) return;\n"
+        "  }\n"
+        "  if (useDepthPyramid && occluded(c, e)) return;\n"
+        "  uint material = uint(instances[i].centre.w);\n"
+        "  uint slot = atomicAdd(commands[material * 4u + 1u], 1u);\n"
+        "  visibleIds[material * capacity + slot] = i;\n"
+        "}";
+
+    // level 0 copies the depth texture, every other level keeps the farthest of the texels it covers.
+    // Odd sized sources also take the third row/column, otherwise its depth would fall between two texels
+    const char *pyramidShaderSource = "#version 430 core\n"
+        "layout(local_size_x = 8, local_size_y = 8) in;\n"
+        "layout(r32f, binding = 0) writeonly uniform image2D destination;\n"
+        "uniform sampler2D source;\n"
+        "uniform int sourceLevel;\n"
+        "uniform ivec2 sourceSize;\n"
+        "uniform ivec2 destinationSize;\n"
+        "void main()\n"
+        "{\n"
+        "  ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+        "  if (any(greaterThanEqual(p, destinationSize))) return;\n"
+        "  float depth;\n"
+        "  if (sourceLevel < 0)\n"
+        "  {\n"
+        "    depth = texelFetch(source, p, 0).r;\n"
+        "  }\n"
+        "  else\n"
+        "  {\n"
+        "    ivec2 span = ivec2(2) + (sourceSize & 1);\n"
+        "    depth = 0.0;\n"
+        "    for (int y = 0; y < span.y; y++)\n"
+        "      for (int x = 0; x < span.x; x++)\n"
+        "        depth = max(depth, texelFetch(source, min(p * 2 + ivec2(x, y), sourceSize - 1), sourceLevel).r);\n"
+        "  }\n"
+        "  imageStore(destination, p, vec4(depth));\n"
+        "}";
+}
+
+const char *GpuCuller::drawShaderHeader = "#version 430 core\n"
+    "layout(std430, binding = 2) readonly buffer Visible { uint visibleIds[]; };\n"
+    "layout(std430, binding = 3) readonly buffer Models { mat4 models[]; };\n"
+    "uniform uint visibleOffset;\n"
+    "mat4 model_matrix() { return models[visibleIds[visibleOffset + uint(gl_InstanceID)]]; }\n";
+
+GpuCuller::GpuCuller()
+    : m_supported(false), m_cullShader(nullptr), m_pyramidShader(nullptr),
+      m_instanceBuffer(0), m_modelBuffer(0), m_commandBuffer(0), m_visibleBuffer(0),
+      m_instanceCapacity(0), m_instanceCount(0),
+      m_depthTexture(0), m_depthFramebuffer(0), m_pyramid(0),
+      m_pyramidWidth(0), m_pyramidHeight(0), m_pyramidLevels(0), m_pyramidValid(false)
+{
+    for (unsigned int i = 0; i < MAX_MATERIALS; i++)
+    {
+        m_commands[i] = DrawCommand{0, 0, 0, 0};
+    }
+}
+
+GpuCuller::~GpuCuller()
+{
+    if (!m_supported) return;
+    glDeleteBuffers(1, &m_instanceBuffer);
+    glDeleteBuffers(1, &m_modelBuffer);
+    glDeleteBuffers(1, &m_commandBuffer);
+    glDeleteBuffers(1, &m_visibleBuffer);
+    glDeleteFramebuffers(1, &m_depthFramebuffer);
+    glDeleteTextures(1, &m_depthTexture);
+    glDeleteTextures(1, &m_pyramid);
+    delete m_cullShader;
+    delete m_pyramidShader;
+}
+
+bool GpuCuller::load_entry_points(GLADloadproc load)
+{
+    dispatchCompute = (DispatchComputeProc)load("glDispatchCompute");
+    memoryBarrier = (MemoryBarrierProc)load("glMemoryBarrier");
+    drawArraysIndirect = (DrawArraysIndirectProc)load("glDrawArraysIndirect");
+    bindImageTexture = (BindImageTextureProc)load("glBindImageTexture");
+    if (!dispatchCompute || !memoryBarrier || !drawArraysIndirect || !bindImageTexture) return false;
+
+    // counted with glad's when GL stats are on
+    GlStats::add_entry_point(GlStats::FUNCTION_glDispatchCompute, reinterpret_cast<void **>(&dispatchCompute));
+    GlStats::add_entry_point(GlStats::FUNCTION_glMemoryBarrier, reinterpret_cast<void **>(&memoryBarrier));
+    GlStats::add_entry_point(GlStats::FUNCTION_glDrawArraysIndirect, reinterpret_cast<void **>(&drawArraysIndirect));
+    GlStats::add_entry_point(GlStats::FUNCTION_glBindImageTexture, reinterpret_cast<void **>(&bindImageTexture));
+    return true;
+}
+
+bool GpuCuller::init(GLADloadproc load)
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major * 10 + minor < 43 || !load_entry_points(load))
+    {
+        printf("GPU culling needs GL 4.3, context is %d.%d. Falling back to CPU culling\n", major, minor);
+        return false;
+    }
+
+    m_cullShader = new ShaderHelper();
+    m_pyramidShader = new ShaderHelper();
+    if (!m_cullShader->add_shader(GL_COMPUTE_SHADER, &cullShaderSource) || !m_cullShader->link_shaders() ||
+        !m_pyramidShader->add_shader(GL_COMPUTE_SHADER, &pyramidShaderSource) || !m_pyramidShader->link_shaders())
+    {
+        delete m_cullShader;
+        delete m_pyramidShader;
+        m_cullShader = m_pyramidShader = nullptr;
+        return false;
+    }
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glGenBuffers(1, &m_modelBuffer);
+    glGenBuffers(1, &m_commandBuffer);
+    glGenBuffers(1, &m_visibleBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(m_commands), m_commands, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glGenTextures(1, &m_depthTexture);
+    glGenTextures(1, &m_pyramid);
+    glGenFramebuffers(1, &m_depthFramebuffer);
+
+    m_supported = true;
+    return true;
+}
+
+void GpuCuller::set_draw(unsigned int material, GLsizei vertexCount)
+{
+    if (material >= MAX_MATERIALS) return;
+    m_commands[material].count = vertexCount;
+}
+
+void GpuCuller::upload(const glm::mat4 *models, const AABB *bounds, const unsigned char *materials, unsigned int count)
+{
+    if (!m_supported) return;
+
+    m_instances.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        m_instances[i].centre = glm::vec4(bounds[i].centre(), (float)materials[i]);
+        m_instances[i].extent = glm::vec4(bounds[i].extent() * 0.5f, 0.0f);
+    }
+
+    // the visible lists are sized for the worst case of every instance sharing one material
+    if (count > m_instanceCapacity)
+    {
+        m_instanceCapacity = std::max(count, m_instanceCapacity * 2);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)m_instanceCapacity * MAX_MATERIALS * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+    }
+
+    // orphaned every frame so the driver never waits on last frame's draws
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)std::max(count, 1u) * sizeof(Instance), m_instances.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_modelBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)std::max(count, 1u) * sizeof(glm::mat4), models, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    m_instanceCount = count;
+}
+
+void GpuCuller::cull(const glm::mat4 &viewProj, bool useDepthPyramid)
+{
+    if (!m_supported) return;
+
+    // instance counts back to zero, the compute pass counts them up again
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(m_commands), m_commands);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_INSTANCES, m_instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_COMMANDS, m_commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_VISIBLE, m_visibleBuffer);
+
+    Frustum frustum = Frustum::from_matrix(viewProj);
+    bool depthTest = useDepthPyramid && m_pyramidValid;
+
+    m_cullShader->use();
+    glUniform1ui(m_cullShader->get_uniform_location("instanceCount"), m_instanceCount);
+    glUniform1ui(m_cullShader->get_uniform_location("capacity"), m_instanceCapacity);
+    glUniform4fv(m_cullShader->get_uniform_location("planes"), 6, glm::value_ptr(frustum.planes[0]));
+    glUniform1i(m_cullShader->get_uniform_location("useDepthPyramid"), depthTest);
+    if (depthTest)
+    {
+        glUniformMatrix4fv(m_cullShader->get_uniform_location("pyramidViewProj"), 1, GL_FALSE, glm::value_ptr(m_pyramidViewProj));
+        glUniform2i(m_cullShader->get_uniform_location("pyramidSize"), m_pyramidWidth, m_pyramidHeight);
+        glUniform1i(m_cullShader->get_uniform_location("pyramidLevels"), m_pyramidLevels);
+        glUniform1i(m_cullShader->get_uniform_location("pyramid"), 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_pyramid);
+    }
+
+    dispatchCompute((m_instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void GpuCuller::draw(unsigned int material)
+{
+    if (!m_supported || material >= MAX_MATERIALS || m_commands[material].count == 0) return;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_VISIBLE, m_visibleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_MODELS, m_modelBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    drawArraysIndirect(GL_TRIANGLES, (const void *)(material * sizeof(DrawCommand)));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GpuCuller::resize_pyramid(int width, int height)
+{
+    m_pyramidWidth = width;
+    m_pyramidHeight = height;
+    m_pyramidLevels = 1;
+    while ((std::max(width, height) >> m_pyramidLevels) > 0) m_pyramidLevels++;
+
+    glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_depthFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+    glBindTexture(GL_TEXTURE_2D, m_pyramid);
+    for (int level = 0; level < m_pyramidLevels; level++)
+    {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(width >> level, 1), std::max(height >> level, 1), 0, GL_RED, GL_FLOAT, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_pyramidLevels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GpuCuller::build_depth_pyramid(int width, int height, const glm::mat4 &viewProj)
+{
+    if (!m_supported || width <= 0 || height <= 0) return;
+
+    GLint drawFramebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+    if (width != m_pyramidWidth || height != m_pyramidHeight) resize_pyramid(width, height);
+
+    // depth can't be sampled from the window, so take a copy first
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, drawFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFramebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        // the window's depth format differs from ours. Culling still works, it just can't use depth
+        m_pyramidValid = false;
+        return;
+    }
+
+    m_pyramidShader->use();
+    int sourceLevelLocation = m_pyramidShader->get_uniform_location("sourceLevel");
+    int sourceSizeLocation = m_pyramidShader->get_uniform_location("sourceSize");
+    int destinationSizeLocation = m_pyramidShader->get_uniform_location("destinationSize");
+    glUniform1i(m_pyramidShader->get_uniform_location("source"), 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int level = 0; level < m_pyramidLevels; level++)
+    {
+        int w = std::max(width >> level, 1);
+        int h = std::max(height >> level, 1);
+        if (level == 0)
+        {
+            glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+            glUniform1i(sourceLevelLocation, -1);
+            glUniform2i(sourceSizeLocation, width, height);
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, m_pyramid);
+            glUniform1i(sourceLevelLocation, level - 1);
+            glUniform2i(sourceSizeLocation, std::max(width >> (level - 1), 1), std::max(height >> (level - 1), 1));
+        }
+        glUniform2i(destinationSizeLocation, w, h);
+        bindImageTexture(0, m_pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        dispatchCompute((w + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, (h + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+        memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_pyramidViewProj = viewProj;
+    m_pyramidValid = true;
+}
+
+void GpuCuller::read_visible(std::vector<unsigned int> &visible)
+{
+    visible.clear();
+    if (!m_supported) return;
+
+    DrawCommand commands[MAX_MATERIALS];
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(commands), commands);
+
+    std::vector<GLuint> ids((size_t)m_instanceCapacity * MAX_MATERIALS);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, ids.size() * sizeof(GLuint), ids.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    for (unsigned int m = 0; m < MAX_MATERIALS; m++)
+    {
+        const GLuint *list = &ids[(size_t)m * m_instanceCapacity];
+        visible.insert(visible.end(), list, list + commands[m].instanceCount);
+    }
+    std::sort(visible.begin(), visible.end());
+}
+
+bool GpuCuller::validate(const glm::mat4 &viewProj, const AABB *bounds)
+{
+    if (!m_supported) return false;
+
+    cull(viewProj, false);
+    std::vector<unsigned int> visible;
+    read_visible(visible);
+
+    // boxes sitting right on a plane can go either way depending on rounding, so the CPU answer is
+    // only trusted when a slightly grown and a slightly shrunk box agree with it
+    Frustum frustum = Frustum::from_matrix(viewProj);
+    const float tolerance = 1e-3f;
+    size_t next = 0;
+    for (unsigned int i = 0; i < m_instanceCount; i++)
+    {
+        bool gpu = next < visible.size() && visible[next] == i;
+        if (gpu) next++;
+
+        glm::vec3 margin = glm::vec3(tolerance) + bounds[i].extent() * tolerance;
+        glm::vec3 shrink = glm::min(margin, bounds[i].extent() * 0.5f);
+        bool surelyIn = frustum.test(AABB(bounds[i].min + shrink, bounds[i].max - shrink)) != Frustum::OUTSIDE;
+        bool surelyOut = frustum.test(AABB(bounds[i].min - margin, bounds[i].max + margin)) == Frustum::OUTSIDE;
+        if ((gpu && surelyOut) || (!gpu && surelyIn))
+        {
+            printf("GPU culling mismatch on instance %u: GPU says %s\n", i, gpu ? "visible" : "culled");
+            return false;
+        }
+    }
+    if (next != visible.size())
+    {
+        printf("GPU culling wrote %zu ids for %u instances\n", visible.size(), m_instanceCount);
+        return false;
+    }
+    return true;
+}
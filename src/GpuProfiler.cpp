@@ -0,0 +1,182 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// queries are made this many at a time when the pool runs dry
+#define QUERY_BATCH 32
+
+GpuProfiler::GpuProfiler(unsigned int historySize)
+    : m_frameIndex(0), m_recording(false), m_historySize(std::max(historySize, 1u))
+{
+    for (Frame &frame : m_frames)
+    {
+        frame.pending = false;
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (m_queries.empty()) return;
+    glDeleteQueries((GLsizei)m_queries.size(), m_queries.data());
+}
+
+unsigned int GpuProfiler::acquire_query()
+{
+    if (m_freeQueries.empty())
+    {
+        unsigned int batch[QUERY_BATCH];
+        glGenQueries(QUERY_BATCH, batch);
+        m_queries.insert(m_queries.end(), batch, batch + QUERY_BATCH);
+        m_freeQueries.insert(m_freeQueries.end(), batch, batch + QUERY_BATCH);
+    }
+    unsigned int query = m_freeQueries.back();
+    m_freeQueries.pop_back();
+    return query;
+}
+
+int GpuProfiler::child(int parent, const char *name)
+{
+    if (parent >= 0)
+    {
+        for (int c : m_nodes[parent].children)
+        {
+            if (strcmp(m_nodes[c].name.c_str(), name) == 0) return c;
+        }
+    }
+    else
+    {
+        for (int n = 0; n < (int)m_nodes.size(); n++)
+        {
+            if (m_nodes[n].parent < 0 && strcmp(m_nodes[n].name.c_str(), name) == 0) return n;
+        }
+    }
+
+    int node = (int)m_nodes.size();
+    m_nodes.push_back(Node{name, parent, {}, std::vector<float>(m_historySize, 0.0f), 0, 0});
+    if (parent >= 0) m_nodes[parent].children.push_back(node);
+    return node;
+}
+
+void GpuProfiler::begin_frame()
+{
+    collect();
+
+    // still waiting on the frame that used this slot, skip this one rather than wait
+    Frame &frame = m_frames[m_frameIndex];
+    m_recording = !frame.pending;
+    if (m_recording) frame.events.clear();
+    m_stack.clear();
+    push("frame");
+}
+
+void GpuProfiler::end_frame()
+{
+    pop();
+    if (m_recording) m_frames[m_frameIndex].pending = true;
+    m_frameIndex = (m_frameIndex + 1) % FRAME_LATENCY;
+    m_recording = false;
+}
+
+void GpuProfiler::push(const char *name)
+{
+    if (!m_recording) return;
+    Frame &frame = m_frames[m_frameIndex];
+    int parent = m_stack.empty() ? -1 : frame.events[m_stack.back()].node;
+    Event event = Event{child(parent, name), acquire_query(), 0};
+    glQueryCounter(event.begin, GL_TIMESTAMP);
+    m_stack.push_back((unsigned int)frame.events.size());
+    frame.events.push_back(event);
+}
+
+void GpuProfiler::pop()
+{
+    if (!m_recording || m_stack.empty()) return;
+    Event &event = m_frames[m_frameIndex].events[m_stack.back()];
+    event.end = acquire_query();
+    glQueryCounter(event.end, GL_TIMESTAMP);
+    m_stack.pop_back();
+}
+
+void GpuProfiler::collect()
+{
+    for (Frame &frame : m_frames)
+    {
+        if (frame.pending) resolve(frame);
+    }
+}
+
+void GpuProfiler::resolve(Frame &frame)
+{
+    // timestamps complete in order, once the frame's last one is back the rest are too
+    GLuint available = 0;
+    glGetQueryObjectuiv(frame.events[0].end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+
+    for (const Event &event : frame.events)
+    {
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(event.begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(event.end, GL_QUERY_RESULT, &end);
+        m_freeQueries.push_back(event.begin);
+        m_freeQueries.push_back(event.end);
+
+        Node &node = m_nodes[event.node];
+        node.history[node.next] = (float)((end - begin) / 1e6);
+        node.next = (node.next + 1) % m_historySize;
+        node.count = std::min(node.count + 1, m_historySize);
+    }
+    frame.pending = false;
+}
+
+void GpuProfiler::node_stats(int node, int depth, std::vector<PassStats> &out) const
+{
+    const Node &n = m_nodes[node];
+    PassStats s = PassStats{n.name, depth, n.count, 0.0, 0.0, 0.0, 0.0};
+    if (n.count > 0)
+    {
+        std::vector<float> sorted(n.history.begin(), n.history.begin() + n.count);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (float ms : sorted)
+        {
+            sum += ms;
+        }
+        // nearest rank
+        auto percentile = [&](double p) { return (double)sorted[std::min((size_t)(p * sorted.size()), sorted.size() - 1)]; };
+        s.averageMs = sum / sorted.size();
+        s.p50Ms = percentile(0.50);
+        s.p95Ms = percentile(0.95);
+        s.p99Ms = percentile(0.99);
+    }
+    out.push_back(s);
+
+    for (int c : n.children)
+    {
+        node_stats(c, depth + 1, out);
+    }
+}
+
+void GpuProfiler::stats(std::vector<PassStats> &out) const
+{
+    out.clear();
+    for (int n = 0; n < (int)m_nodes.size(); n++)
+    {
+        if (m_nodes[n].parent < 0) node_stats(n, 0, out);
+    }
+}
+
+void GpuProfiler::print() const
+{
+    std::vector<PassStats> passes;
+    stats(passes);
+    printf("%-28s %8s %8s %8s %8s\n", "GPU pass (ms)", "avg", "p50", "p95", "p99");
+    for (const PassStats &pass : passes)
+    {
+        if (pass.samples == 0) continue;
+        printf("%*s%-*s %8.3f %8.3f %8.3f %8.3f\n", pass.depth * 2, "", 28 - pass.depth * 2, pass.name.c_str(),
+               pass.averageMs, pass.p50Ms, pass.p95Ms, pass.p99Ms);
+    }
+}
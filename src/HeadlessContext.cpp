@@ -0,0 +1,181 @@
+#ifdef HEADLESS_EGL
+
+#include "HeadlessContext.h"
+
+#include <EGL/eglext.h>
+
+#include <cstdio>
+#include <vector>
+
+// newest first, the GPU culler needs 4.3 and everything else runs on 3.3
+static const EGLint CONTEXT_VERSIONS[][2] = { {4, 6}, {4, 5}, {4, 3}, {3, 3} };
+
+HeadlessContext::HeadlessContext()
+    : m_display(EGL_NO_DISPLAY), m_context(EGL_NO_CONTEXT), m_framebuffer(0), m_colour(0), m_depth(0), m_width(0), m_height(0)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    destroy();
+}
+
+void *HeadlessContext::get_proc_address(const char *name)
+{
+    return (void *)eglGetProcAddress(name);
+}
+
+bool HeadlessContext::create(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    // surfaceless needs no X or Wayland server, the default display is only a fallback for older drivers
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != nullptr)
+    {
+        m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, NULL, NULL))
+    {
+        m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, NULL, NULL))
+        {
+            printf("Failed to initialise an EGL display\n");
+            return false;
+        }
+    }
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        printf("EGL display has no desktop OpenGL\n");
+        return false;
+    }
+
+    // the config only matters for its API, nothing is ever drawn to a surface
+    const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = NULL;
+    EGLint configCount = 0;
+    eglChooseConfig(m_display, configAttributes, &config, 1, &configCount);
+
+    for (const EGLint *version : CONTEXT_VERSIONS)
+    {
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, version[0],
+            EGL_CONTEXT_MINOR_VERSION, version[1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        m_context = eglCreateContext(m_display, configCount > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+        if (m_context != EGL_NO_CONTEXT) break;
+    }
+    if (m_context == EGL_NO_CONTEXT)
+    {
+        printf("Failed to create an EGL context (0x%x)\n", eglGetError());
+        return false;
+    }
+    if (!make_current())
+    {
+        printf("EGL context can't be made current without a surface (0x%x)\n", eglGetError());
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)get_proc_address))
+    {
+        printf("Failed to initialize GLAD\n");
+        return false;
+    }
+    printf("headless: %s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+    return create_framebuffer();
+}
+
+bool HeadlessContext::create_framebuffer()
+{
+    // depth stencil to match GpuCuller's copy, the blit into its pyramid needs the same format
+    glGenRenderbuffers(1, &m_colour);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colour);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+    glGenRenderbuffers(1, &m_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colour);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete)
+    {
+        printf("Headless framebuffer is incomplete\n");
+    }
+    return complete;
+}
+
+void HeadlessContext::destroy()
+{
+    if (m_display == EGL_NO_DISPLAY) return;
+
+    if (m_context != EGL_NO_CONTEXT)
+    {
+        if (m_framebuffer != 0 && make_current())
+        {
+            glDeleteFramebuffers(1, &m_framebuffer);
+            glDeleteRenderbuffers(1, &m_colour);
+            glDeleteRenderbuffers(1, &m_depth);
+        }
+        release();
+        eglDestroyContext(m_display, m_context);
+    }
+    eglTerminate(m_display);
+    m_display = EGL_NO_DISPLAY;
+    m_context = EGL_NO_CONTEXT;
+    m_framebuffer = m_colour = m_depth = 0;
+}
+
+bool HeadlessContext::make_current()
+{
+    return eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context);
+}
+
+void HeadlessContext::release()
+{
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+void HeadlessContext::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void HeadlessContext::read_pixels(unsigned char *rgb) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
+
+bool HeadlessContext::save_ppm(const char *path) const
+{
+    std::vector<unsigned char> rgb((size_t)m_width * m_height * 3);
+    read_pixels(rgb.data());
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        printf("Failed to open %s\n", path);
+        return false;
+    }
+    // GL rows start at the bottom, PPM rows at the top
+    fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+    size_t rowBytes = (size_t)m_width * 3;
+    for (int y = m_height - 1; y >= 0; y--)
+    {
+        fwrite(&rgb[y * rowBytes], 1, rowBytes, file);
+    }
+    fclose(file);
+    return true;
+}
+
+#endif // HEADLESS_EGL
@@ -0,0 +1,242 @@
+#include "InputLatency.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// batches the GL thread hasn't picked up before the event thread folds new input into the newest one
+#define MAX_BATCHES 1024
+#define HISTOGRAM_WIDTH 50
+
+static const char *STAGE_NAMES[InputLatency::STAGE_COUNT] = {"poll", "queue", "submit", "swap", "gpu", "total"};
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+}
+
+InputLatency::InputLatency()
+    : m_inputs(0), m_firstInput(0.0), m_firstApplied(0.0), m_sequence(0), m_frame(0), m_measuring(false), m_current(), m_waits(0)
+{
+}
+
+double InputLatency::now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void InputLatency::input()
+{
+    if (m_inputs == 0)
+    {
+        m_firstInput = now();
+        m_firstApplied = 0.0;
+    }
+    m_inputs++;
+}
+
+void InputLatency::applied()
+{
+    if (m_inputs > 0 && m_firstApplied == 0.0) m_firstApplied = now();
+}
+
+unsigned long long InputLatency::published()
+{
+    m_sequence++;
+    // input that arrived after the last step waits for the next publish
+    if (m_inputs == 0 || m_firstApplied == 0.0) return m_sequence;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_batches.size() < MAX_BATCHES)
+    {
+        m_batches.push_back(Batch{m_sequence, m_inputs, m_firstInput, m_firstApplied, now()});
+    }
+    else
+    {
+        // the GL thread has stopped picking up, the frame that does will take every batch anyway
+        m_batches.back().sequence = m_sequence;
+        m_batches.back().inputs += m_inputs;
+    }
+    m_inputs = 0;
+    return m_sequence;
+}
+
+void InputLatency::frame_begin(unsigned long long sequence)
+{
+    collect(false);
+    m_frame++;
+    m_measuring = false;
+    if (sequence == 0) return;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    while (!m_batches.empty() && m_batches.front().sequence <= sequence)
+    {
+        const Batch &batch = m_batches.front();
+        if (!m_measuring)
+        {
+            // timed from the oldest input, newer ones folded into the same frame only add to the count
+            m_measuring = true;
+            m_current = Frame();
+            m_current.sample.frame = m_frame - 1;
+            m_current.input = batch.input;
+            m_current.applied = batch.applied;
+        }
+        m_current.sample.inputs += batch.inputs;
+        m_batches.pop_front();
+    }
+    if (m_measuring) m_current.picked = now();
+}
+
+void InputLatency::frame_submitted()
+{
+    if (!m_measuring) return;
+    m_current.submitted = now();
+    if (m_freeQueries.empty())
+    {
+        unsigned int query;
+        glGenQueries(1, &query);
+        m_queries.push_back(query);
+        m_freeQueries.push_back(query);
+    }
+    m_current.query = m_freeQueries.back();
+    m_freeQueries.pop_back();
+    glQueryCounter(m_current.query, GL_TIMESTAMP);
+}
+
+void InputLatency::frame_swapped()
+{
+    if (!m_measuring) return;
+    m_measuring = false;
+    m_current.swapped = now();
+    if (m_inFlight.size() >= QUERY_RING)
+    {
+        // the GPU is a whole ring of measured frames behind. Only the oldest is waited for, the rest stay queued so
+        // the backlog being measured isn't drained
+        m_waits++;
+        resolve_oldest(true);
+        collect(false);
+    }
+    m_inFlight.push_back(m_current);
+}
+
+void InputLatency::collect(bool wait)
+{
+    while (resolve_oldest(wait)) {}
+}
+
+/* Reads the oldest frame's query if it is done, or once it is when wait is set. GL_TIMESTAMP is on the GPU's
+   clock, lined up with the steady clock as each result is read. False if there was nothing to read */
+bool InputLatency::resolve_oldest(bool wait)
+{
+    if (m_inFlight.empty()) return false;
+    Frame &frame = m_inFlight.front();
+    if (!wait)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(frame.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+    }
+    GLuint64 timestamp = 0;
+    glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &timestamp);
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    double offset = now() - gpuNow * 1e-9;
+    resolve(frame, timestamp * 1e-9 + offset);
+    m_freeQueries.push_back(frame.query);
+    m_inFlight.pop_front();
+    return true;
+}
+
+void InputLatency::resolve(Frame &frame, double gpu)
+{
+    // the two clocks only line up to within a few microseconds, the GPU can't have finished before it was asked
+    gpu = std::max(gpu, frame.submitted);
+    double *ms = frame.sample.ms;
+    ms[STAGE_POLL] = (frame.applied - frame.input) * 1000.0;
+    ms[STAGE_QUEUE] = (frame.picked - frame.applied) * 1000.0;
+    ms[STAGE_SUBMIT] = (frame.submitted - frame.picked) * 1000.0;
+    ms[STAGE_SWAP] = (frame.swapped - frame.submitted) * 1000.0;
+    ms[STAGE_GPU] = std::max(gpu - frame.swapped, 0.0) * 1000.0;
+    ms[STAGE_TOTAL] = (std::max(gpu, frame.swapped) - frame.input) * 1000.0;
+    m_samples.push_back(frame.sample);
+}
+
+void InputLatency::finish()
+{
+    collect(true);
+    if (!m_queries.empty()) glDeleteQueries((GLsizei)m_queries.size(), m_queries.data());
+    m_queries.clear();
+    m_freeQueries.clear();
+}
+
+bool InputLatency::write_csv(const char *path) const
+{
+    FILE *file = fopen(path, "w");
+    if (file == nullptr)
+    {
+        printf("Failed to open %s\n", path);
+        return false;
+    }
+    fprintf(file, "frame,inputs");
+    for (const char *name : STAGE_NAMES)
+    {
+        fprintf(file, ",%s_ms", name);
+    }
+    fprintf(file, "\n");
+    for (const Sample &sample : m_samples)
+    {
+        fprintf(file, "%llu,%u", sample.frame, sample.inputs);
+        for (double ms : sample.ms)
+        {
+            fprintf(file, ",%.3f", ms);
+        }
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+void InputLatency::print() const
+{
+    unsigned long long inputs = 0;
+    for (const Sample &sample : m_samples)
+    {
+        inputs += sample.inputs;
+    }
+    printf("input latency: %zu of %llu frames showed new input, %llu inputs, %llu waits on the GPU\n",
+           m_samples.size(), m_frame, inputs, m_waits);
+    if (m_samples.empty()) return;
+
+    printf("  %-8s %8s %8s %8s %8s  ms\n", "", "p50", "p95", "p99", "max");
+    std::vector<double> sorted(m_samples.size());
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        for (size_t i = 0; i < m_samples.size(); i++)
+        {
+            sorted[i] = m_samples[i].ms[stage];
+        }
+        std::sort(sorted.begin(), sorted.end());
+        printf("  %-8s %8.2f %8.2f %8.2f %8.2f\n", STAGE_NAMES[stage], percentile(sorted, 0.5), percentile(sorted, 0.95),
+               percentile(sorted, 0.99), sorted.back());
+    }
+
+    unsigned int counts[BUCKETS] = {};
+    for (const Sample &sample : m_samples)
+    {
+        unsigned int bucket = (unsigned int)(sample.ms[STAGE_TOTAL] / BUCKET_MS);
+        counts[std::min(bucket, BUCKETS - 1)]++;
+    }
+    unsigned int first = 0;
+    unsigned int last = BUCKETS - 1;
+    while (counts[first] == 0) first++;
+    while (counts[last] == 0) last--;
+    unsigned int peak = *std::max_element(counts, counts + BUCKETS);
+    printf("  total:\n");
+    for (unsigned int bucket = first; bucket <= last; bucket++)
+    {
+        int bar = (int)((unsigned long long)counts[bucket] * HISTOGRAM_WIDTH / peak);
+        if (bucket == BUCKETS - 1) printf("  %4u+    ms |", bucket * BUCKET_MS);
+        else printf("  %4u-%-4u ms |", bucket * BUCKET_MS, (bucket + 1) * BUCKET_MS);
+        printf("%.*s %u\n", bar, "##################################################", counts[bucket]);
+    }
+}
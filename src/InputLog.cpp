@@ -0,0 +1,165 @@
+#include "InputLog.h"
+
+#include <cstring>
+
+#define LOG_MAGIC "INPUTLOG"
+#define LOG_VERSION 1u
+
+// Each event is its type byte, the steps since the previous event as a varint, the time as a double,
+// then two doubles for cursor, scroll and resize or a varint for keys. A cursor event within 127 steps of the
+// one before is 26 bytes.
+
+static void write_varint(FILE *file, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int)(value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static bool read_varint(FILE *file, unsigned long long &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = fgetc(file);
+        if (byte == EOF) return false;
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+InputLog::InputLog()
+    : m_file(nullptr), m_lastStep(0), m_lastKeys(0), m_next(0)
+{
+}
+
+InputLog::~InputLog()
+{
+    if (m_file != nullptr) fclose(m_file);
+}
+
+bool InputLog::open(const char *path)
+{
+    m_file = fopen(path, "wb");
+    if (m_file == nullptr)
+    {
+        printf("Failed to open %s to record input\n", path);
+        return false;
+    }
+    unsigned int version = LOG_VERSION;
+    fwrite(LOG_MAGIC, 1, 8, m_file);
+    fwrite(&version, sizeof(version), 1, m_file);
+    m_lastStep = 0;
+    m_lastKeys = 0;
+    return true;
+}
+
+void InputLog::write_event(const Event &event)
+{
+    fputc(event.type, m_file);
+    write_varint(m_file, event.step - m_lastStep);
+    fwrite(&event.time, sizeof(event.time), 1, m_file);
+    if (event.type == EVENT_KEYS)
+    {
+        write_varint(m_file, event.keys);
+    }
+    else if (event.type != EVENT_END)
+    {
+        fwrite(&event.x, sizeof(event.x), 1, m_file);
+        fwrite(&event.y, sizeof(event.y), 1, m_file);
+    }
+    m_lastStep = event.step;
+}
+
+void InputLog::record(EventType type, unsigned long long step, double time, double x, double y)
+{
+    if (m_file == nullptr) return;
+    write_event(Event{type, step, time, x, y, 0});
+}
+
+void InputLog::record_keys(unsigned long long step, double time, unsigned int keys)
+{
+    if (m_file == nullptr || keys == m_lastKeys) return;
+    write_event(Event{EVENT_KEYS, step, time, 0.0, 0.0, keys});
+    m_lastKeys = keys;
+}
+
+void InputLog::close(unsigned long long step, double time)
+{
+    if (m_file == nullptr) return;
+    write_event(Event{EVENT_END, step, time, 0.0, 0.0, 0});
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+bool InputLog::load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        printf("Failed to open input log %s\n", path);
+        return false;
+    }
+
+    char magic[8];
+    unsigned int version = 0;
+    if (fread(magic, 1, 8, file) != 8 || memcmp(magic, LOG_MAGIC, 8) != 0 ||
+        fread(&version, sizeof(version), 1, file) != 1 || version != LOG_VERSION)
+    {
+        printf("%s is not an input log this build can read\n", path);
+        fclose(file);
+        return false;
+    }
+
+    m_events.clear();
+    m_next = 0;
+    unsigned long long step = 0;
+    bool ended = false;
+    int type;
+    while (!ended && (type = fgetc(file)) != EOF)
+    {
+        Event event = {(EventType)type, 0, 0.0, 0.0, 0.0, 0};
+        unsigned long long delta;
+        bool ok = type <= EVENT_END && read_varint(file, delta) && fread(&event.time, sizeof(event.time), 1, file) == 1;
+        if (ok && type == EVENT_KEYS)
+        {
+            unsigned long long keys;
+            ok = read_varint(file, keys);
+            event.keys = (unsigned int)keys;
+        }
+        else if (ok && type != EVENT_END)
+        {
+            ok = fread(&event.x, sizeof(event.x), 1, file) == 1 && fread(&event.y, sizeof(event.y), 1, file) == 1;
+        }
+        if (!ok) break;
+        step += delta;
+        event.step = step;
+        m_events.push_back(event);
+        ended = type == EVENT_END;
+    }
+    fclose(file);
+
+    // a session that crashed has no end event, it plays up to the last thing it logged
+    if (!ended)
+    {
+        printf("Input log %s is cut short, replaying what is there\n", path);
+        m_events.push_back(Event{EVENT_END, step, m_events.empty() ? 0.0 : m_events.back().time, 0.0, 0.0, 0});
+    }
+    return true;
+}
+
+bool InputLog::next(unsigned long long step, Event &event)
+{
+    if (m_next >= m_events.size() || m_events[m_next].step > step || m_events[m_next].type == EVENT_END) return false;
+    event = m_events[m_next++];
+    return true;
+}
+
+unsigned long long InputLog::end_step() const
+{
+    return m_events.empty() ? 0 : m_events.back().step;
+}
@@ -0,0 +1,251 @@
+#include "JobSystem.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace JobSystem
+{
+    struct Task {
+        Job job;
+        Counter *counter;
+    };
+
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<WorkerQueue *> queues;     // queues[0] belongs to the thread that called init()
+    std::vector<std::thread> workers;
+    std::atomic<bool> quit(false);
+    std::atomic<int> pending(0);           // queued but not yet started
+    bool isRunning = false;
+
+    std::mutex sleepLock;
+    std::condition_variable wake;
+
+    thread_local int threadIndex = -1;
+
+    void push(Task task)
+    {
+        // threads that are not workers (e.g. a render thread) share queue 0
+        int index = threadIndex >= 0 ? threadIndex : 0;
+        {
+            std::lock_guard<std::mutex> lk(queues[index]->lock);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        pending.fetch_add(1, std::memory_order_release);
+        wake.notify_one();
+    }
+
+    bool find_task(Task &task)
+    {
+        if (pending.load(std::memory_order_acquire) <= 0) return false;
+
+        unsigned int count = (unsigned int)queues.size();
+        unsigned int self = threadIndex >= 0 ? threadIndex : 0;
+
+        // newest job from our own queue first, it is the most likely to still be in cache
+        {
+            WorkerQueue *q = queues[self];
+            std::lock_guard<std::mutex> lk(q->lock);
+            if (!q->tasks.empty())
+            {
+                task = std::move(q->tasks.back());
+                q->tasks.pop_back();
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        // otherwise steal the oldest job from someone else
+        for (unsigned int i = 1; i < count; i++)
+        {
+            WorkerQueue *q = queues[(self + i) % count];
+            std::lock_guard<std::mutex> lk(q->lock);
+            if (!q->tasks.empty())
+            {
+                task = std::move(q->tasks.front());
+                q->tasks.pop_front();
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void finish(Counter *counter)
+    {
+        std::vector<Job> jobs;
+        std::vector<Counter *> counters;
+        {
+            std::lock_guard<std::mutex> lk(counter->lock);
+            if (counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                jobs.swap(counter->continuations);
+                counters.swap(counter->continuationCounters);
+            }
+        }
+        // counter may be gone by now, only touch the local copies
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            push(Task{std::move(jobs[i]), counters[i]});
+        }
+    }
+
+    void execute(Task &task)
+    {
+        PROFILE_SCOPE("job");
+        task.job();
+        if (task.counter != nullptr) finish(task.counter);
+    }
+
+    void worker_loop(int index)
+    {
+        threadIndex = index;
+        PROFILE_THREAD("worker");
+        while (!quit.load(std::memory_order_acquire))
+        {
+            Task task;
+            if (find_task(task))
+            {
+                execute(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lk(sleepLock);
+            wake.wait_for(lk, std::chrono::milliseconds(2), []() { return quit.load() || pending.load() > 0; });
+        }
+    }
+
+    void init(unsigned int workerCount)
+    {
+        if (isRunning) return;
+
+        if (workerCount == 0)
+        {
+            unsigned int hw = std::thread::hardware_concurrency();
+            workerCount = hw > 1 ? hw - 1 : 0;
+        }
+
+        quit = false;
+        pending = 0;
+        threadIndex = 0;
+        for (unsigned int i = 0; i <= workerCount; i++)
+        {
+            queues.push_back(new WorkerQueue());
+        }
+        for (unsigned int i = 1; i <= workerCount; i++)
+        {
+            workers.emplace_back(worker_loop, (int)i);
+        }
+        isRunning = true;
+    }
+
+    void shutdown()
+    {
+        if (!isRunning) return;
+
+        quit = true;
+        wake.notify_all();
+        for (std::thread &t : workers)
+        {
+            t.join();
+        }
+        workers.clear();
+
+        for (WorkerQueue *q : queues)
+        {
+            assert(q->tasks.empty());
+            delete q;
+        }
+        queues.clear();
+        threadIndex = -1;
+        isRunning = false;
+    }
+
+    bool running()
+    {
+        return isRunning;
+    }
+
+    unsigned int thread_count()
+    {
+        return isRunning ? (unsigned int)queues.size() : 1;
+    }
+
+    unsigned int thread_index()
+    {
+        return threadIndex >= 0 ? threadIndex : 0;
+    }
+
+    void run(Job job, Counter *counter, Counter *dependency)
+    {
+        if (!isRunning)
+        {
+            // nothing to schedule on, behave like a plain function call
+            if (dependency != nullptr) wait(dependency);
+            job();
+            return;
+        }
+
+        if (counter != nullptr) counter->value.fetch_add(1, std::memory_order_relaxed);
+
+        if (dependency != nullptr)
+        {
+            std::lock_guard<std::mutex> lk(dependency->lock);
+            if (dependency->value.load(std::memory_order_acquire) > 0)
+            {
+                dependency->continuations.push_back(std::move(job));
+                dependency->continuationCounters.push_back(counter);
+                return;
+            }
+        }
+
+        push(Task{std::move(job), counter});
+    }
+
+    void wait(Counter *counter)
+    {
+        while (!counter->done())
+        {
+            Task task;
+            if (isRunning && find_task(task))
+            {
+                execute(task);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // the last finish() may still hold the lock, make sure it let go before the caller frees the counter
+        std::lock_guard<std::mutex> lk(counter->lock);
+    }
+
+    void parallel_for(unsigned int count, unsigned int grain, const std::function<void(unsigned int begin, unsigned int end)> &fn)
+    {
+        if (count == 0) return;
+        grain = std::max(1u, grain);
+
+        if (!isRunning || count <= grain)
+        {
+            fn(0, count);
+            return;
+        }
+
+        Counter counter;
+        for (unsigned int begin = 0; begin < count; begin += grain)
+        {
+            unsigned int end = std::min(count, begin + grain);
+            run([&fn, begin, end]() { fn(begin, end); }, &counter);
+        }
+        wait(&counter);
+    }
+};
@@ -0,0 +1,293 @@
+#include "LightProbes.h"
+#include "JobSystem.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <string>
+
+namespace
+{
+    // light from everything the geometry doesn't cover, the same sky as tools/bake_lightmap.cpp
+    const float SKY = 0.1f;
+    const float RAY_OFFSET = 1e-3f;
+    // changes further than this many probe spacings away are assumed not to matter
+    const float INFLUENCE_SPACINGS = 2.0f;
+    const float PI = 3.14159265f;
+    // cosine lobe convolution per band, divided by pi to match the shaders' N.L lighting
+    const float BAND_SCALE[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+    const int COEFFICIENT_BAND[9] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+    void sh_basis(const glm::vec3 &d, float *out)
+    {
+        out[0] = 0.282095f;
+        out[1] = 0.488603f * d.y;
+        out[2] = 0.488603f * d.z;
+        out[3] = 0.488603f * d.x;
+        out[4] = 1.092548f * d.x * d.y;
+        out[5] = 1.092548f * d.y * d.z;
+        out[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+        out[7] = 1.092548f * d.x * d.z;
+        out[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+    }
+
+    float horizontal_sum(vfloat v)
+    {
+        float f[4];
+        v_store(f, v);
+        return (f[0] + f[1]) + (f[2] + f[3]);
+    }
+}
+
+const char *LightProbes::shaderSource =
+    "uniform sampler3D probeCoefficients0;\n"
+    "uniform sampler3D probeCoefficients1;\n"
+    "uniform sampler3D probeCoefficients2;\n"
+    "uniform sampler3D probeCoefficients3;\n"
+    "uniform sampler3D probeCoefficients4;\n"
+    "uniform sampler3D probeCoefficients5;\n"
+    "uniform sampler3D probeCoefficients6;\n"
+    "uniform vec3 probeGridMin;\n"
+    "uniform vec3 probeGridExtent;\n"
+    "vec3 probe_irradiance(vec3 position, vec3 n)\n"
+    "{\n"
+    // probes sit at texel centres, so the grid maps straight onto texture coordinates
+    "  vec3 uvw = (position - probeGridMin) / probeGridExtent;\n"
+    "  vec4 t0 = texture(probeCoefficients0, uvw);\n"
+    "  vec4 t1 = texture(probeCoefficients1, uvw);\n"
+    "  vec4 t2 = texture(probeCoefficients2, uvw);\n"
+    "  vec4 t3 = texture(probeCoefficients3, uvw);\n"
+    "  vec4 t4 = texture(probeCoefficients4, uvw);\n"
+    "  vec4 t5 = texture(probeCoefficients5, uvw);\n"
+    "  vec4 t6 = texture(probeCoefficients6, uvw);\n"
+    "  vec3 e = t0.rgb * 0.282095\n"
+    "         + vec3(t0.a, t1.rg) * (0.488603 * n.y)\n"
+    "         + vec3(t1.ba, t2.r) * (0.488603 * n.z)\n"
+    "         + t2.gba * (0.488603 * n.x)\n"
+    "         + t3.rgb * (1.092548 * n.x * n.y)\n"
+    "         + vec3(t3.a, t4.rg) * (1.092548 * n.y * n.z)\n"
+    "         + vec3(t4.ba, t5.r) * (0.315392 * (3.0 * n.z * n.z - 1.0))\n"
+    "         + t5.gba * (1.092548 * n.x * n.z)\n"
+    "         + t6.rgb * (0.546274 * (n.x * n.x - n.y * n.y));\n"
+    "  return max(e, vec3(0.0));\n"
+    "}\n";
+
+LightProbes::LightProbes(const AABB &bounds)
+    : m_bounds(bounds), m_lightPos(0.0f), m_lightColour(0.0f), m_hasLight(false),
+      m_dirty(PROBE_COUNT, 1), m_dirtyCount(PROBE_COUNT), m_cursor(0),
+      m_texels((size_t)TEXTURE_COUNT * PROBE_COUNT, glm::vec4(0.0f)), m_uploadPending(false)
+{
+    m_spacing = bounds.extent() / glm::vec3(GRID_X, GRID_Y, GRID_Z);
+    for (int i = 0; i < TEXTURE_COUNT; i++)
+    {
+        m_textures[i] = 0;
+    }
+
+    // spherical Fibonacci directions, evenly spread so every sample carries the same solid angle
+    m_directions.resize(SAMPLES);
+    m_basis.resize((size_t)COEFFICIENTS * SAMPLES);
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        float z = 1.0f - (2.0f * i + 1.0f) / SAMPLES;
+        float r = sqrtf(std::max(0.0f, 1.0f - z * z));
+        float phi = i * 2.39996323f;
+        m_directions[i] = glm::vec3(r * cosf(phi), r * sinf(phi), z);
+
+        float basis[COEFFICIENTS];
+        sh_basis(m_directions[i], basis);
+        for (int k = 0; k < COEFFICIENTS; k++)
+        {
+            m_basis[(size_t)k * SAMPLES + i] = basis[k];
+        }
+    }
+}
+
+LightProbes::~LightProbes()
+{
+    if (m_textures[0] == 0) return;
+    glDeleteTextures(TEXTURE_COUNT, m_textures);
+}
+
+void LightProbes::setup()
+{
+    glGenTextures(TEXTURE_COUNT, m_textures);
+    for (int i = 0; i < TEXTURE_COUNT; i++)
+    {
+        glBindTexture(GL_TEXTURE_3D, m_textures[i]);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, GRID_X, GRID_Y, GRID_Z, 0, GL_RGBA, GL_FLOAT, &m_texels[(size_t)i * PROBE_COUNT]);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+glm::vec3 LightProbes::probe_position(unsigned int probe) const
+{
+    int x = probe % GRID_X;
+    int y = (probe / GRID_X) % GRID_Y;
+    int z = probe / (GRID_X * GRID_Y);
+    return m_bounds.min + (glm::vec3(x, y, z) + 0.5f) * m_spacing;
+}
+
+void LightProbes::set_geometry(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &albedos)
+{
+    m_bvh.build(positions);
+    m_triangleAlbedos = albedos;
+    m_triangleNormals.resize(positions.size() / 3);
+    for (size_t t = 0; t < m_triangleNormals.size(); t++)
+    {
+        m_triangleNormals[t] = glm::normalize(glm::cross(positions[t * 3 + 1] - positions[t * 3], positions[t * 3 + 2] - positions[t * 3]));
+    }
+}
+
+void LightProbes::set_light(const glm::vec3 &position, const glm::vec3 &colour)
+{
+    if (m_hasLight && position == m_lightPos && colour == m_lightColour) return;
+    m_lightPos = position;
+    m_lightColour = colour;
+    m_hasLight = true;
+    invalidate_all();
+}
+
+void LightProbes::invalidate(const AABB &region)
+{
+    AABB reach = region;
+    glm::vec3 margin = m_spacing * INFLUENCE_SPACINGS;
+    reach.min -= margin;
+    reach.max += margin;
+    for (unsigned int probe = 0; probe < (unsigned int)PROBE_COUNT; probe++)
+    {
+        glm::vec3 p = probe_position(probe);
+        if (m_dirty[probe] || !reach.overlaps(AABB(p, p))) continue;
+        m_dirty[probe] = 1;
+        m_dirtyCount++;
+    }
+}
+
+void LightProbes::invalidate_all()
+{
+    std::fill(m_dirty.begin(), m_dirty.end(), 1);
+    m_dirtyCount = PROBE_COUNT;
+}
+
+glm::vec3 LightProbes::radiance(const glm::vec3 &origin, const glm::vec3 &dir) const
+{
+    Ray ray(origin, dir);
+    MeshBvh::Hit hit;
+    if (!m_bvh.intersect(ray, hit)) return glm::vec3(SKY);
+
+    // the inside of something, it gives off nothing
+    glm::vec3 normal = m_triangleNormals[hit.triangle];
+    if (glm::dot(normal, dir) > 0.0f) return glm::vec3(0.0f);
+
+    // one bounce: the main light and the sky reflected off whatever was hit
+    glm::vec3 position = origin + dir * hit.t;
+    glm::vec3 light = glm::vec3(SKY);
+    glm::vec3 toLight = m_lightPos - position;
+    float distance = glm::length(toLight);
+    float cosine = glm::dot(normal, toLight) / distance;
+    if (m_hasLight && cosine > 0.0f && !m_bvh.occluded(Ray(position + normal * RAY_OFFSET, toLight / distance, distance)))
+    {
+        light += m_lightColour * cosine;
+    }
+    return m_triangleAlbedos[hit.triangle] * light;
+}
+
+void LightProbes::bake(unsigned int probe)
+{
+    glm::vec3 origin = probe_position(probe);
+    float r[SAMPLES], g[SAMPLES], b[SAMPLES];
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        glm::vec3 l = radiance(origin, m_directions[i]);
+        r[i] = l.r;
+        g[i] = l.g;
+        b[i] = l.b;
+    }
+
+    // project four directions at a time onto all nine basis functions
+    vfloat sums[COEFFICIENTS][3];
+    for (int k = 0; k < COEFFICIENTS; k++)
+    {
+        sums[k][0] = sums[k][1] = sums[k][2] = v_set(0.0f);
+    }
+    for (int i = 0; i < SAMPLES; i += 4)
+    {
+        vfloat vr = v_load(&r[i]);
+        vfloat vg = v_load(&g[i]);
+        vfloat vb = v_load(&b[i]);
+        for (int k = 0; k < COEFFICIENTS; k++)
+        {
+            vfloat y = v_load(&m_basis[(size_t)k * SAMPLES + i]);
+            sums[k][0] = v_add(sums[k][0], v_mul(y, vr));
+            sums[k][1] = v_add(sums[k][1], v_mul(y, vg));
+            sums[k][2] = v_add(sums[k][2], v_mul(y, vb));
+        }
+    }
+
+    float packed[TEXTURE_COUNT * 4] = {};
+    for (int k = 0; k < COEFFICIENTS; k++)
+    {
+        float scale = 4.0f * PI / SAMPLES * BAND_SCALE[COEFFICIENT_BAND[k]];
+        for (int c = 0; c < 3; c++)
+        {
+            packed[k * 3 + c] = horizontal_sum(sums[k][c]) * scale;
+        }
+    }
+    for (int t = 0; t < TEXTURE_COUNT; t++)
+    {
+        m_texels[(size_t)t * PROBE_COUNT + probe] = glm::vec4(packed[t * 4], packed[t * 4 + 1], packed[t * 4 + 2], packed[t * 4 + 3]);
+    }
+}
+
+void LightProbes::update()
+{
+    if (m_dirtyCount > 0)
+    {
+        m_batch.clear();
+        for (unsigned int i = 0; i < (unsigned int)PROBE_COUNT && m_batch.size() < (size_t)PROBES_PER_FRAME; i++)
+        {
+            unsigned int probe = (m_cursor + i) % PROBE_COUNT;
+            if (m_dirty[probe]) m_batch.push_back(probe);
+        }
+        m_cursor = (m_batch.back() + 1) % PROBE_COUNT;
+
+        JobSystem::parallel_for((unsigned int)m_batch.size(), 1, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++)
+            {
+                bake(m_batch[i]);
+            }
+        });
+        for (unsigned int probe : m_batch)
+        {
+            m_dirty[probe] = 0;
+        }
+        m_dirtyCount -= (unsigned int)m_batch.size();
+        m_uploadPending = true;
+    }
+
+    if (!m_uploadPending) return;
+    // the whole grid is a few KB per texture, cheaper than one upload per probe
+    for (int i = 0; i < TEXTURE_COUNT; i++)
+    {
+        glBindTexture(GL_TEXTURE_3D, m_textures[i]);
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, GRID_X, GRID_Y, GRID_Z, GL_RGBA, GL_FLOAT, &m_texels[(size_t)i * PROBE_COUNT]);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+    m_uploadPending = false;
+}
+
+void LightProbes::bind(ShaderHelper *shader, int firstUnit) const
+{
+    for (int i = 0; i < TEXTURE_COUNT; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_3D, m_textures[i]);
+        shader->set_uniform(("probeCoefficients" + std::to_string(i)).c_str(), firstUnit + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    shader->set_uniform("probeGridMin", m_bounds.min);
+    shader->set_uniform("probeGridExtent", m_bounds.extent());
+}
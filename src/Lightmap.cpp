@@ -0,0 +1,53 @@
+#include "Lightmap.h"
+#include "CpuProfiler.h"
+
+#include <cstdio>
+
+bool Lightmap::save(const char *path) const
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        printf("Could not write lightmap %s\n", path);
+        return false;
+    }
+
+    unsigned int header[5] = { MAGIC, VERSION, width, height, (unsigned int)uvs.size() };
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+    ok = ok && (uvs.empty() || fwrite(uvs.data(), sizeof(glm::vec2), uvs.size(), file) == uvs.size());
+    ok = ok && (texels.empty() || fwrite(texels.data(), sizeof(glm::vec3), texels.size(), file) == texels.size());
+    fclose(file);
+    if (!ok) printf("Failed writing lightmap %s\n", path);
+    return ok;
+}
+
+bool Lightmap::load(const char *path)
+{
+    PROFILE_SCOPE("Lightmap::load");
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    unsigned int header[5];
+    if (fread(header, sizeof(header), 1, file) != 1 || header[0] != MAGIC || header[1] != VERSION)
+    {
+        printf("%s is not a version %u lightmap\n", path, VERSION);
+        fclose(file);
+        return false;
+    }
+
+    width = header[2];
+    height = header[3];
+    uvs.resize(header[4]);
+    texels.resize((size_t)width * height);
+    bool ok = uvs.empty() || fread(uvs.data(), sizeof(glm::vec2), uvs.size(), file) == uvs.size();
+    ok = ok && (texels.empty() || fread(texels.data(), sizeof(glm::vec3), texels.size(), file) == texels.size());
+    fclose(file);
+    if (!ok)
+    {
+        printf("Lightmap %s is truncated\n", path);
+        width = height = 0;
+        uvs.clear();
+        texels.clear();
+    }
+    return ok;
+}
@@ -0,0 +1,344 @@
+#include "MeshBvh.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    const int TRAVERSAL_STACK_SIZE = 128;
+    // a traversal holds at most three pending children per 4-wide level above the node it is on, and a node4 is
+    // never deeper than the binary node it came from. Binary leaves no deeper than this keep the stack in bounds
+    const int MAX_LEAF_DEPTH = (TRAVERSAL_STACK_SIZE - 4) / 3 + 1;
+    // below this the triangle is edge on to the ray
+    const float DETERMINANT_EPSILON = 1e-9f;
+
+    /* Levels of halving it takes to get count triangles into leaves of leafSize */
+    int median_levels(unsigned int count, unsigned int leafSize)
+    {
+        int levels = 0;
+        while ((unsigned long long)leafSize << levels < count) levels++;
+        return levels;
+    }
+}
+
+MeshBvh::MeshBvh() : m_triangleCount(0)
+{
+}
+
+void MeshBvh::build(const std::vector<glm::vec3> &positions)
+{
+    m_nodes.clear();
+    m_packets.clear();
+    m_triangleCount = (unsigned int)(positions.size() / 3);
+    if (m_triangleCount == 0) return;
+
+    std::vector<AABB> bounds(m_triangleCount);
+    std::vector<glm::vec3> centroids(m_triangleCount);
+    std::vector<unsigned int> order(m_triangleCount);
+    for (unsigned int i = 0; i < m_triangleCount; i++)
+    {
+        bounds[i].grow(positions[i * 3]);
+        bounds[i].grow(positions[i * 3 + 1]);
+        bounds[i].grow(positions[i * 3 + 2]);
+        centroids[i] = bounds[i].centre();
+        order[i] = i;
+    }
+
+    std::vector<BuildNode> binary;
+    binary.reserve(2 * m_triangleCount);
+    build_binary(binary, order, bounds, centroids, 0, m_triangleCount, 0);
+
+    // the root is always a Node4, even when the whole mesh fits in one leaf
+    if (binary[0].left < 0)
+    {
+        Node4 root;
+        for (int i = 0; i < 4; i++)
+        {
+            AABB box = i == 0 ? binary[0].bounds : AABB();
+            root.minX[i] = box.min.x; root.minY[i] = box.min.y; root.minZ[i] = box.min.z;
+            root.maxX[i] = box.max.x; root.maxY[i] = box.max.y; root.maxZ[i] = box.max.z;
+            root.child[i] = 0;
+        }
+        root.child[0] = collapse(binary, 0, order, positions);
+        m_nodes.push_back(root);
+    }
+    else
+    {
+        collapse(binary, 0, order, positions);
+    }
+}
+
+int MeshBvh::build_binary(std::vector<BuildNode> &nodes, std::vector<unsigned int> &order, const std::vector<AABB> &bounds,
+                          const std::vector<glm::vec3> &centroids, unsigned int begin, unsigned int end, int depth)
+{
+    int index = (int)nodes.size();
+    nodes.push_back(BuildNode());
+
+    AABB nodeBounds;
+    AABB centroidBounds;
+    for (unsigned int i = begin; i < end; i++)
+    {
+        nodeBounds.grow(bounds[order[i]]);
+        centroidBounds.grow(centroids[order[i]]);
+    }
+    unsigned int count = end - begin;
+    nodes[index] = BuildNode{nodeBounds, -1, -1, begin, count};
+    if (count <= (unsigned int)MAX_LEAF_SIZE) return index;
+
+    // leaves can't grow past a packet, so once lopsided splits have used up all but the depth halving still
+    // needs, only halve from here on
+    bool balance = depth + median_levels(count, MAX_LEAF_SIZE) >= MAX_LEAF_DEPTH;
+
+    // binned SAH over the centroids, the same scheme as Bvh but every leaf must fit one packet
+    int bestAxis = -1;
+    float bestPosition = 0.0f;
+    float bestCost = FLT_MAX;
+    for (int a = 0; a < 3 && !balance; a++)
+    {
+        float lo = centroidBounds.min[a];
+        float hi = centroidBounds.max[a];
+        if (hi <= lo) continue;
+
+        AABB binBounds[BIN_COUNT];
+        unsigned int binCounts[BIN_COUNT] = {};
+        float scale = BIN_COUNT / (hi - lo);
+        for (unsigned int i = begin; i < end; i++)
+        {
+            int bin = std::min(BIN_COUNT - 1, (int)((centroids[order[i]][a] - lo) * scale));
+            binCounts[bin]++;
+            binBounds[bin].grow(bounds[order[i]]);
+        }
+
+        float rightArea[BIN_COUNT];
+        unsigned int rightCount[BIN_COUNT];
+        AABB right;
+        unsigned int rightTotal = 0;
+        for (int b = BIN_COUNT - 1; b > 0; b--)
+        {
+            right.grow(binBounds[b]);
+            rightTotal += binCounts[b];
+            rightArea[b] = right.surface_area();
+            rightCount[b] = rightTotal;
+        }
+
+        AABB left;
+        unsigned int leftTotal = 0;
+        for (int b = 0; b < BIN_COUNT - 1; b++)
+        {
+            left.grow(binBounds[b]);
+            leftTotal += binCounts[b];
+            if (leftTotal == 0 || rightCount[b + 1] == 0) continue;
+            float cost = leftTotal * left.surface_area() + rightCount[b + 1] * rightArea[b + 1];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = a;
+                bestPosition = lo + (b + 1) / scale;
+            }
+        }
+    }
+
+    unsigned int mid = begin + count / 2;
+    if (bestAxis >= 0)
+    {
+        mid = (unsigned int)(std::partition(order.begin() + begin, order.begin() + end, [&](unsigned int t) {
+            return centroids[t][bestAxis] < bestPosition;
+        }) - order.begin());
+        if (mid == begin || mid == end) mid = begin + count / 2;
+    }
+    else if (balance)
+    {
+        glm::vec3 e = centroidBounds.extent();
+        int axis = (e.x > e.y && e.x > e.z) ? 0 : (e.y > e.z ? 1 : 2);
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](unsigned int a, unsigned int b) { return centroids[a][axis] < centroids[b][axis]; });
+    }
+
+    int left = build_binary(nodes, order, bounds, centroids, begin, mid, depth + 1);
+    int right = build_binary(nodes, order, bounds, centroids, mid, end, depth + 1);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+int MeshBvh::collapse(const std::vector<BuildNode> &nodes, int node, const std::vector<unsigned int> &order, const std::vector<glm::vec3> &positions)
+{
+    const BuildNode &source = nodes[node];
+    if (source.left < 0)
+    {
+        Triangle4 packet;
+        for (int i = 0; i < 4; i++)
+        {
+            glm::vec3 v0 = glm::vec3(0.0f), e1 = glm::vec3(0.0f), e2 = glm::vec3(0.0f);
+            unsigned int id = 0;
+            if (i < (int)source.count)
+            {
+                id = order[source.first + i];
+                v0 = positions[id * 3];
+                e1 = positions[id * 3 + 1] - v0;
+                e2 = positions[id * 3 + 2] - v0;
+            }
+            packet.v0x[i] = v0.x; packet.v0y[i] = v0.y; packet.v0z[i] = v0.z;
+            packet.e1x[i] = e1.x; packet.e1y[i] = e1.y; packet.e1z[i] = e1.z;
+            packet.e2x[i] = e2.x; packet.e2y[i] = e2.y; packet.e2z[i] = e2.z;
+            packet.id[i] = id;
+        }
+        m_packets.push_back(packet);
+        return ~(int)(m_packets.size() - 1);
+    }
+
+    // open up the biggest interior child until there are four
+    int children[4] = { source.left, source.right, -1, -1 };
+    int childCount = 2;
+    while (childCount < 4)
+    {
+        int widest = -1;
+        float widestArea = -1.0f;
+        for (int i = 0; i < childCount; i++)
+        {
+            const BuildNode &c = nodes[children[i]];
+            if (c.left < 0) continue;
+            if (c.bounds.surface_area() > widestArea)
+            {
+                widestArea = c.bounds.surface_area();
+                widest = i;
+            }
+        }
+        if (widest < 0) break;
+        int opened = children[widest];
+        children[widest] = nodes[opened].left;
+        children[childCount++] = nodes[opened].right;
+    }
+
+    int index = (int)m_nodes.size();
+    m_nodes.push_back(Node4());
+    for (int i = 0; i < 4; i++)
+    {
+        AABB box;
+        int child = 0;
+        if (i < childCount)
+        {
+            box = nodes[children[i]].bounds;
+            child = collapse(nodes, children[i], order, positions);
+        }
+        // the vector may have grown during the recursion
+        Node4 &out = m_nodes[index];
+        out.minX[i] = box.min.x; out.minY[i] = box.min.y; out.minZ[i] = box.min.z;
+        out.maxX[i] = box.max.x; out.maxY[i] = box.max.y; out.maxZ[i] = box.max.z;
+        out.child[i] = child;
+    }
+    return index;
+}
+
+bool MeshBvh::intersect(const Ray &ray, Hit &hit) const
+{
+    return traverse(ray, hit, false);
+}
+
+bool MeshBvh::occluded(const Ray &ray) const
+{
+    Hit hit;
+    return traverse(ray, hit, true);
+}
+
+bool MeshBvh::traverse(const Ray &ray, Hit &hit, bool anyHit) const
+{
+    if (m_nodes.empty()) return false;
+
+    const vfloat ox = v_set(ray.origin.x), oy = v_set(ray.origin.y), oz = v_set(ray.origin.z);
+    const vfloat dx = v_set(ray.dir.x), dy = v_set(ray.dir.y), dz = v_set(ray.dir.z);
+    const vfloat ix = v_set(ray.invDir.x), iy = v_set(ray.invDir.y), iz = v_set(ray.invDir.z);
+    const vfloat zero = v_set(0.0f);
+    const vfloat one = v_set(1.0f);
+    // near and far planes picked by the ray's direction, so empty (inverted) boxes can never be entered
+    const bool flipX = ray.invDir.x < 0.0f, flipY = ray.invDir.y < 0.0f, flipZ = ray.invDir.z < 0.0f;
+
+    float tMax = ray.tMax;
+    bool found = false;
+
+    int stack[TRAVERSAL_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        int code = stack[--top];
+        if (code < 0)
+        {
+            const Triangle4 &p = m_packets[~code];
+            vfloat e1x = v_load(p.e1x), e1y = v_load(p.e1y), e1z = v_load(p.e1z);
+            vfloat e2x = v_load(p.e2x), e2y = v_load(p.e2y), e2z = v_load(p.e2z);
+
+            // Moller-Trumbore on all four at once
+            vfloat px = v_sub(v_mul(dy, e2z), v_mul(dz, e2y));
+            vfloat py = v_sub(v_mul(dz, e2x), v_mul(dx, e2z));
+            vfloat pz = v_sub(v_mul(dx, e2y), v_mul(dy, e2x));
+            vfloat det = v_add(v_add(v_mul(e1x, px), v_mul(e1y, py)), v_mul(e1z, pz));
+            vfloat inv = v_div(one, det);
+
+            vfloat sx = v_sub(ox, v_load(p.v0x)), sy = v_sub(oy, v_load(p.v0y)), sz = v_sub(oz, v_load(p.v0z));
+            vfloat u = v_mul(v_add(v_add(v_mul(sx, px), v_mul(sy, py)), v_mul(sz, pz)), inv);
+            vfloat qx = v_sub(v_mul(sy, e1z), v_mul(sz, e1y));
+            vfloat qy = v_sub(v_mul(sz, e1x), v_mul(sx, e1z));
+            vfloat qz = v_sub(v_mul(sx, e1y), v_mul(sy, e1x));
+            vfloat v = v_mul(v_add(v_add(v_mul(dx, qx), v_mul(dy, qy)), v_mul(dz, qz)), inv);
+            vfloat t = v_mul(v_add(v_add(v_mul(e2x, qx), v_mul(e2y, qy)), v_mul(e2z, qz)), inv);
+
+            vfloat valid = v_or(v_ge(det, v_set(DETERMINANT_EPSILON)), v_le(det, v_set(-DETERMINANT_EPSILON)));
+            valid = v_and(valid, v_and(v_ge(u, zero), v_ge(v, zero)));
+            valid = v_and(valid, v_le(v_add(u, v), one));
+            valid = v_and(valid, v_and(v_ge(t, zero), v_le(t, v_set(tMax))));
+            int mask = v_mask(valid);
+            if (mask == 0) continue;
+            if (anyHit) return true;
+
+            float ts[4], us[4], vs[4];
+            v_store(ts, t);
+            v_store(us, u);
+            v_store(vs, v);
+            for (int i = 0; i < 4; i++)
+            {
+                if (!(mask & (1 << i)) || ts[i] > tMax) continue;
+                tMax = ts[i];
+                hit = Hit{ts[i], p.id[i], us[i], vs[i]};
+                found = true;
+            }
+            continue;
+        }
+
+        const Node4 &n = m_nodes[code];
+        vfloat tx0 = v_mul(v_sub(v_load(flipX ? n.maxX : n.minX), ox), ix);
+        vfloat tx1 = v_mul(v_sub(v_load(flipX ? n.minX : n.maxX), ox), ix);
+        vfloat ty0 = v_mul(v_sub(v_load(flipY ? n.maxY : n.minY), oy), iy);
+        vfloat ty1 = v_mul(v_sub(v_load(flipY ? n.minY : n.maxY), oy), iy);
+        vfloat tz0 = v_mul(v_sub(v_load(flipZ ? n.maxZ : n.minZ), oz), iz);
+        vfloat tz1 = v_mul(v_sub(v_load(flipZ ? n.minZ : n.maxZ), oz), iz);
+        vfloat enter = v_max(v_max(tx0, ty0), v_max(tz0, zero));
+        vfloat exit = v_min(v_min(tx1, ty1), v_min(tz1, v_set(tMax)));
+        int mask = v_mask(v_le(enter, exit));
+        if (mask == 0) continue;
+
+        // farthest pushed first so the nearest child comes off the stack next
+        float enters[4];
+        v_store(enters, enter);
+        int lanes[4];
+        int laneCount = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            if (!(mask & (1 << i))) continue;
+            int at = laneCount++;
+            while (at > 0 && enters[lanes[at - 1]] < enters[i])
+            {
+                lanes[at] = lanes[at - 1];
+                at--;
+            }
+            lanes[at] = i;
+        }
+        assert(top + laneCount <= TRAVERSAL_STACK_SIZE);
+        for (int i = 0; i < laneCount; i++)
+        {
+            stack[top++] = n.child[lanes[i]];
+        }
+    }
+    return found;
+}
@@ -0,0 +1,264 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "Simd.h"
+
+#include <algorithm>
+
+namespace
+{
+    // triangles with a vertex this close to the eye plane are skipped rather than clipped. Dropping occluder
+    // triangles can only make the test more conservative
+    const float NEAR_W = 1e-4f;
+    const unsigned int CULL_GRAIN = 256;
+
+    glm::vec3 to_screen(const glm::vec4 &clip)
+    {
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3((ndc.x * 0.5f + 0.5f) * OcclusionCuller::WIDTH,
+                         (ndc.y * 0.5f + 0.5f) * OcclusionCuller::HEIGHT,
+                         ndc.z * 0.5f + 0.5f);
+    }
+}
+
+OcclusionCuller::OcclusionCuller()
+    : m_depth(WIDTH * HEIGHT, 1.0f), m_tileMax(TILES_X * TILES_Y, 1.0f)
+{
+}
+
+void OcclusionCuller::begin(const glm::mat4 &viewProj)
+{
+    m_viewProj = viewProj;
+    m_occluders.clear();
+    std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+    std::fill(m_tileMax.begin(), m_tileMax.end(), 1.0f);
+}
+
+void OcclusionCuller::add_occluder(const glm::vec3 *vertices, const unsigned int *indices, unsigned int indexCount, const glm::mat4 &model, const AABB &worldBounds)
+{
+    int x0, y0, x1, y1;
+    float nearest;
+    if (!project(worldBounds, x0, y0, x1, y1, nearest)) return;
+
+    float area = (float)(x1 - x0 + 1) * (float)(y1 - y0 + 1);
+    m_occluders.push_back(Occluder{vertices, indices, indexCount, model, area});
+}
+
+void OcclusionCuller::rasterize()
+{
+    // biggest on screen first, they hide the most for the least work
+    if (m_occluders.size() > MAX_OCCLUDERS)
+    {
+        std::partial_sort(m_occluders.begin(), m_occluders.begin() + MAX_OCCLUDERS, m_occluders.end(),
+                          [](const Occluder &a, const Occluder &b) { return a.screenArea > b.screenArea; });
+        m_occluders.resize(MAX_OCCLUDERS);
+    }
+
+    std::vector<unsigned int> firstTriangle(m_occluders.size() + 1, 0);
+    for (size_t i = 0; i < m_occluders.size(); i++)
+    {
+        firstTriangle[i + 1] = firstTriangle[i] + m_occluders[i].indexCount / 3;
+    }
+    m_triangles.resize(firstTriangle.back());
+
+    JobSystem::parallel_for((unsigned int)m_occluders.size(), 1, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int o = begin; o < end; o++)
+        {
+            const Occluder &occ = m_occluders[o];
+            glm::mat4 mvp = m_viewProj * occ.model;
+            for (unsigned int t = 0; t < occ.indexCount / 3; t++)
+            {
+                ScreenTriangle &tri = m_triangles[firstTriangle[o] + t];
+                tri.valid = true;
+                for (int k = 0; k < 3; k++)
+                {
+                    glm::vec4 clip = mvp * glm::vec4(occ.vertices[occ.indices[t * 3 + k]], 1.0f);
+                    if (clip.w < NEAR_W)
+                    {
+                        tri.valid = false;
+                        break;
+                    }
+                    tri.v[k] = to_screen(clip);
+                }
+            }
+        }
+    });
+
+    // every band of tile rows is independent, so there is no sharing between jobs
+    JobSystem::parallel_for(TILES_Y, 1, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int row = begin; row < end; row++)
+        {
+            rasterize_band(row);
+        }
+    });
+}
+
+void OcclusionCuller::rasterize_band(int tileRow)
+{
+    const int bandMinY = tileRow * TILE_SIZE;
+    const int bandMaxY = bandMinY + TILE_SIZE - 1;
+    const vfloat laneOffsets = v_set(0.5f, 1.5f, 2.5f, 3.5f);
+    const vfloat zero = v_set(0.0f);
+
+    for (const ScreenTriangle &tri : m_triangles)
+    {
+        if (!tri.valid) continue;
+
+        glm::vec3 a = tri.v[0];
+        glm::vec3 b = tri.v[1];
+        glm::vec3 c = tri.v[2];
+
+        float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (fabsf(area) < 1e-6f) continue;
+        if (area < 0.0f)
+        {
+            std::swap(b, c);
+            area = -area;
+        }
+
+        int minY = std::max(bandMinY, (int)floorf(fminf(a.y, fminf(b.y, c.y))));
+        int maxY = std::min(bandMaxY, (int)ceilf(fmaxf(a.y, fmaxf(b.y, c.y))));
+        if (minY > maxY) continue;
+        int minX = std::max(0, (int)floorf(fminf(a.x, fminf(b.x, c.x))));
+        int maxX = std::min(WIDTH - 1, (int)ceilf(fmaxf(a.x, fmaxf(b.x, c.x))));
+        if (minX > maxX) continue;
+        minX &= ~3;
+
+        // edge functions, positive inside: e(p) = A * x + B * y + C
+        glm::vec3 edgeA = glm::vec3(a.y - b.y, b.y - c.y, c.y - a.y);
+        glm::vec3 edgeB = glm::vec3(b.x - a.x, c.x - b.x, a.x - c.x);
+        glm::vec3 edgeC = glm::vec3(-(edgeA.x * a.x + edgeB.x * a.y),
+                                    -(edgeA.y * b.x + edgeB.y * b.y),
+                                    -(edgeA.z * c.x + edgeB.z * c.y));
+
+        // depth is affine in screen space: z = z0 + dzdx * x + dzdy * y
+        float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+        float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+        float z0 = a.z - dzdx * a.x - dzdy * a.y;
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            float py = y + 0.5f;
+            float *row = &m_depth[y * WIDTH];
+
+            vfloat rowE0 = v_set(edgeB.x * py + edgeC.x);
+            vfloat rowE1 = v_set(edgeB.y * py + edgeC.y);
+            vfloat rowE2 = v_set(edgeB.z * py + edgeC.z);
+            vfloat rowZ = v_set(dzdy * py + z0);
+
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                vfloat px = v_add(v_set((float)x), laneOffsets);
+                vfloat e0 = v_add(v_mul(v_set(edgeA.x), px), rowE0);
+                vfloat e1 = v_add(v_mul(v_set(edgeA.y), px), rowE1);
+                vfloat e2 = v_add(v_mul(v_set(edgeA.z), px), rowE2);
+                vfloat inside = v_and(v_ge(e0, zero), v_and(v_ge(e1, zero), v_ge(e2, zero)));
+                if (v_mask(inside) == 0) continue;
+
+                vfloat z = v_add(v_mul(v_set(dzdx), px), rowZ);
+                vfloat current = v_load(row + x);
+                v_store(row + x, v_select(inside, v_min(current, z), current));
+            }
+        }
+    }
+
+    // farthest depth per tile, so a box nearer than all of it cannot be hidden there
+    for (int tx = 0; tx < TILES_X; tx++)
+    {
+        vfloat farthest = v_set(0.0f);
+        for (int y = bandMinY; y <= bandMaxY; y++)
+        {
+            const float *p = &m_depth[y * WIDTH + tx * TILE_SIZE];
+            for (int x = 0; x < TILE_SIZE; x += 4)
+            {
+                farthest = v_max(farthest, v_load(p + x));
+            }
+        }
+        float lanes[4];
+        v_store(lanes, farthest);
+        m_tileMax[tileRow * TILES_X + tx] = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+    }
+}
+
+bool OcclusionCuller::project(const AABB &bounds, int &x0, int &y0, int &x1, int &y1, float &nearest) const
+{
+    glm::vec2 lo = glm::vec2(FLT_MAX);
+    glm::vec2 hi = glm::vec2(-FLT_MAX);
+    nearest = 1.0f;
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner = glm::vec3(i & 1 ? bounds.max.x : bounds.min.x,
+                                     i & 2 ? bounds.max.y : bounds.min.y,
+                                     i & 4 ? bounds.max.z : bounds.min.z);
+        glm::vec4 clip = m_viewProj * glm::vec4(corner, 1.0f);
+        // crosses the eye plane, treat as covering the whole screen right up to the camera
+        if (clip.w < NEAR_W)
+        {
+            x0 = y0 = 0;
+            x1 = WIDTH - 1;
+            y1 = HEIGHT - 1;
+            nearest = 0.0f;
+            return true;
+        }
+        glm::vec3 s = to_screen(clip);
+        lo = glm::min(lo, glm::vec2(s));
+        hi = glm::max(hi, glm::vec2(s));
+        nearest = fminf(nearest, s.z);
+    }
+
+    x0 = std::max(0, (int)floorf(lo.x));
+    y0 = std::max(0, (int)floorf(lo.y));
+    x1 = std::min(WIDTH - 1, (int)ceilf(hi.x));
+    y1 = std::min(HEIGHT - 1, (int)ceilf(hi.y));
+    return x0 <= x1 && y0 <= y1;
+}
+
+bool OcclusionCuller::is_visible(const AABB &bounds) const
+{
+    int x0, y0, x1, y1;
+    float nearest;
+    // off screen is the frustum culler's call, not ours
+    if (!project(bounds, x0, y0, x1, y1, nearest)) return true;
+    if (nearest <= 0.0f) return true;
+
+    for (int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ty++)
+    {
+        for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++)
+        {
+            // whole tile has occluders nearer than the box
+            if (nearest > m_tileMax[ty * TILES_X + tx]) continue;
+
+            int pxMin = std::max(x0, tx * TILE_SIZE);
+            int pxMax = std::min(x1, tx * TILE_SIZE + TILE_SIZE - 1);
+            int pyMin = std::max(y0, ty * TILE_SIZE);
+            int pyMax = std::min(y1, ty * TILE_SIZE + TILE_SIZE - 1);
+            for (int y = pyMin; y <= pyMax; y++)
+            {
+                const float *row = &m_depth[y * WIDTH];
+                for (int x = pxMin; x <= pxMax; x++)
+                {
+                    if (nearest <= row[x]) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void OcclusionCuller::cull(std::vector<unsigned int> &objects, const Bvh &bvh) const
+{
+    std::vector<unsigned char> visible(objects.size());
+    JobSystem::parallel_for((unsigned int)objects.size(), CULL_GRAIN, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+        {
+            visible[i] = is_visible(bvh.object_bounds(objects[i]));
+        }
+    });
+
+    size_t kept = 0;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (visible[i]) objects[kept++] = objects[i];
+    }
+    objects.resize(kept);
+}
@@ -0,0 +1,189 @@
+#include "OcclusionQueries.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace
+{
+    const char *proxyVertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n"
+        "uniform mat4 mvp;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_Position = mvp * vec4(aPos, 1.0);\n"
+        "}";
+
+    // colour writes are masked off while proxies draw, the query only needs the depth test
+    const char *proxyFragmentShaderSource = "#version 330 core\n"
+        "out vec4 FragColor;\n"
+        "void main()\n"
+        "{\n"
+        "  FragColor = vec4(1.0);\n"
+        "}";
+
+    // unit cube as 12 triangles
+    const float proxyVertices[] = {
+        -0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,   0.5f, -0.5f, -0.5f,
+         0.5f,  0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+        -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+         0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,
+        -0.5f,  0.5f,  0.5f,  -0.5f,  0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,
+        -0.5f, -0.5f, -0.5f,  -0.5f, -0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,
+         0.5f,  0.5f,  0.5f,   0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,
+         0.5f, -0.5f, -0.5f,   0.5f,  0.5f,  0.5f,   0.5f, -0.5f,  0.5f,
+        -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, -0.5f,  0.5f,
+         0.5f, -0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,  -0.5f, -0.5f, -0.5f,
+        -0.5f,  0.5f, -0.5f,   0.5f,  0.5f,  0.5f,   0.5f,  0.5f, -0.5f,
+         0.5f,  0.5f,  0.5f,  -0.5f,  0.5f, -0.5f,  -0.5f,  0.5f,  0.5f,
+    };
+}
+
+OcclusionQueries::OcclusionQueries()
+    : m_proxyShader(nullptr), m_mvpLocation(-1), m_proxyVao(0), m_proxyVbo(0),
+      m_frame(0), m_nearDistance(0.0f), m_proxiesDrawn(0)
+{
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+    for (Slot &s : m_slots)
+    {
+        glDeleteQueries(LATENCY, s.queries);
+    }
+    if (m_proxyShader == nullptr) return;
+    glDeleteVertexArrays(1, &m_proxyVao);
+    glDeleteBuffers(1, &m_proxyVbo);
+    delete m_proxyShader;
+}
+
+void OcclusionQueries::setup()
+{
+    m_proxyShader = new ShaderHelper();
+    m_proxyShader->add_shader(GL_VERTEX_SHADER, &proxyVertexShaderSource);
+    m_proxyShader->add_shader(GL_FRAGMENT_SHADER, &proxyFragmentShaderSource);
+    m_proxyShader->link_shaders();
+    m_mvpLocation = m_proxyShader->get_uniform_location("mvp");
+
+    glGenVertexArrays(1, &m_proxyVao);
+    glBindVertexArray(m_proxyVao);
+    glGenBuffers(1, &m_proxyVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_proxyVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(proxyVertices), proxyVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+OcclusionQueries::Slot &OcclusionQueries::slot(unsigned int object)
+{
+    while (m_slots.size() <= object)
+    {
+        Slot s;
+        glGenQueries(LATENCY, s.queries);
+        for (unsigned int r = 0; r < LATENCY; r++)
+        {
+            s.issuedFrame[r] = 0;
+            s.pending[r] = false;
+        }
+        s.lastResultFrame = 0;
+        s.hold = 0;
+        m_slots.push_back(s);
+    }
+    return m_slots[object];
+}
+
+void OcclusionQueries::poll(Slot &s)
+{
+    for (unsigned int r = 0; r < LATENCY; r++)
+    {
+        if (!s.pending[r]) continue;
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(s.queries[r], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint passed = 0;
+        glGetQueryObjectuiv(s.queries[r], GL_QUERY_RESULT, &passed);
+        s.pending[r] = false;
+
+        // results can come back out of order, an older one says nothing new
+        if (s.issuedFrame[r] < s.lastResultFrame) continue;
+        s.lastResultFrame = s.issuedFrame[r];
+
+        // one hit trusts the object for a while, it takes VISIBLE_HOLD misses in a row to lose it
+        if (passed) s.hold = VISIBLE_HOLD;
+        else if (s.hold > 0) s.hold--;
+    }
+}
+
+void OcclusionQueries::begin_frame(const glm::mat4 &viewProj, const glm::vec3 &eye, float nearDistance)
+{
+    m_frame++;
+    m_viewProj = viewProj;
+    m_eye = eye;
+    m_nearDistance = nearDistance;
+    m_proxiesDrawn = 0;
+
+    for (Slot &s : m_slots)
+    {
+        poll(s);
+    }
+}
+
+void OcclusionQueries::draw_proxy(const AABB &bounds)
+{
+    glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), bounds.centre()), bounds.extent());
+    glm::mat4 mvp = m_viewProj * model;
+
+    m_proxyShader->use();
+    glUniformMatrix4fv(m_mvpLocation, 1, GL_FALSE, glm::value_ptr(mvp));
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(m_proxyVao);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void OcclusionQueries::draw(unsigned int object, const AABB &bounds, const std::function<void()> &drawObject)
+{
+    Slot &s = slot(object);
+
+    // with the eye in or right next to the box the near plane cuts the proxy open, so there is nothing to test
+    glm::vec3 margin = glm::vec3(m_nearDistance * 2.0f);
+    if (AABB(bounds.min - margin, bounds.max + margin).contains(AABB(m_eye, m_eye)))
+    {
+        s.hold = VISIBLE_HOLD;
+        drawObject();
+        return;
+    }
+
+    // the query this frame would reuse is still in flight. Waiting on it is exactly what we are avoiding
+    unsigned int r = m_frame % LATENCY;
+    if (s.pending[r])
+    {
+        drawObject();
+        return;
+    }
+    s.pending[r] = true;
+    s.issuedFrame[r] = m_frame;
+
+    if (s.hold > 0)
+    {
+        // the real draw is the query, it costs nothing extra while the object stays in view
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, s.queries[r]);
+        drawObject();
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        return;
+    }
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, s.queries[r]);
+    draw_proxy(bounds);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+    // no wait: if the GPU hasn't got the answer by the time it reaches the draw, it draws anyway
+    glBeginConditionalRender(s.queries[r], GL_QUERY_NO_WAIT);
+    drawObject();
+    glEndConditionalRender();
+    m_proxiesDrawn++;
+}
@@ -0,0 +1,848 @@
+#include "Renderer.h"
+#include "ShaderHelper.h"
+#include "CommandList.h"
+#include "JobSystem.h"
+#include "GpuCuller.h"
+#include "OcclusionQueries.h"
+#include "ClusteredLights.h"
+#include "DeferredShading.h"
+#include "ShadowCache.h"
+#include "LightProbes.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "Lightmap.h"
+#include "container.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+
+// visible objects per recording job, each job fills its own command list
+#define RECORD_GRAIN 64
+// the main light has no real falloff, it just needs a radius that covers the whole view
+#define MAIN_LIGHT_RADIUS 1000.0f
+#define POINT_LIGHT_CUBE_SIZE 0.04f
+// first texture unit of the clustered lighting buffers, 0 and 1 hold the material textures
+#define LIGHT_TEXTURE_UNIT 2
+// between the shadow map at ShadowCache::TEXTURE_UNIT and the probes at LightProbes::TEXTURE_UNIT
+#define LIGHTMAP_TEXTURE_UNIT 6
+// baked by tools/bake_lightmap.cpp, the container falls back to real time lighting without it
+#define LIGHTMAP_PATH "assets/container.lightmap"
+// how often the GPU pass timings are printed
+#define TIMING_REPORT_SECONDS 2.0
+
+namespace Renderer
+{
+    // Everything a recording job needs to draw one material without touching GL
+    struct DrawItem {
+        ShaderHelper *shader;
+        unsigned int vao;
+        int modelLocation;
+        GLsizei vertexCount;
+        AABB localBounds;
+        bool occlusionQuery;     // expensive enough to be worth a hardware query first
+        bool castsShadow;
+    };
+
+    // the main light's shadow is a spot aimed at the container
+    const glm::vec3 shadowTarget = glm::vec3(0.0f);
+    // where the ambient probes are placed, around the scene the camera starts in
+    const AABB probeBounds(glm::vec3(-6.0f, -3.0f, -6.0f), glm::vec3(6.0f, 3.0f, 6.0f));
+    const glm::vec3 materialAlbedos[MATERIAL_COUNT] = { glm::vec3(1.0f, 0.5f, 0.31f), glm::vec3(1.0f), glm::vec3(1.0f, 0.5f, 0.31f) };
+
+    const char *vertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n"
+        "layout (location = 1) in vec3 aNormal;\n"
+        "layout (location = 2) in vec2 aTexCoord;\n"
+        "layout (location = 5) in vec2 aLightmapUV;\n"
+        "out vec3 Normal;\n"
+        "out vec3 FragPos;\n"
+        "out vec2 LightmapUV;\n"
+        "uniform mat4 model;\n"
+        "uniform mat4 view;\n"
+        "uniform mat4 projection;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+        "  Normal = aNormal;\n"
+        "  FragPos = vec3(model * vec4(aPos, 1.0));\n"
+        "  LightmapUV = aLightmapUV;\n"
+        "}";
+
+    // the shadowed main light, plus every point light whose sphere reaches this fragment's cluster, see ClusteredLights.
+    // Ambient comes from the irradiance probes. With LIGHTMAP defined, for the baked container only, the ambient and main
+    // light come from the bake instead
+    const char *fragment2ShaderBody =
+        "in vec3 Normal;\n"
+        "in vec3 FragPos;\n"
+        "out vec4 FragColor;\n"
+        "uniform vec3 objectColor;\n"
+        "uniform vec3 viewPos;\n"
+        "uniform vec3 lightPos;\n"
+        "uniform vec3 lightColor;\n"
+        "#ifdef LIGHTMAP\n"
+        "in vec2 LightmapUV;\n"
+        "uniform sampler2D lightmap;\n"
+        "void main()\n"
+        "{\n"
+        "  vec3 norm    = normalize(Normal);\n"
+        "  vec3 result  = (texture(lightmap, LightmapUV).rgb + cluster_lighting(FragPos, norm, viewPos)) * objectColor;\n"
+        "  FragColor = vec4(result, 1.0);\n"
+        "}\n"
+        "#else\n"
+        "void main()\n"
+        "{\n"
+        "  vec3 norm    = normalize(Normal);\n"
+        "  vec3 ambient = probe_irradiance(FragPos, norm);\n"
+        "  vec3 lightDir = normalize(lightPos - FragPos);\n"
+        "  float diff   = max(dot(norm, lightDir), 0.0);\n"
+        "  float spec   = pow(max(dot(normalize(viewPos - FragPos), reflect(-lightDir, norm)), 0.0), 32);\n"
+        "  vec3 direct  = (diff + 0.5 * spec) * lightColor * shadow_factor(FragPos, norm);\n"
+        "  vec3 result  = (ambient + direct + cluster_lighting(FragPos, norm, viewPos)) * objectColor;\n"
+        "  FragColor = vec4(result, 1.0);\n"
+        "}\n"
+        "#endif\n";
+
+    const char *lightSourceVertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n"
+        "uniform mat4 model;\n"
+        "uniform mat4 view;\n"
+        "uniform mat4 projection;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+        "}";
+
+    const char *lightSourceFragmentShaderSource = "#version 330 core\n"
+        "out vec4 FragColor;\n"
+        "void main()\n"
+        "{\n"
+        "  FragColor = vec4(1.0);\n"
+        "}";
+
+    // every point light's cube in one draw, position and size in one instance attribute and colour in another
+    const char *lightInstanceVertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n"
+        "layout (location = 3) in vec4 aPositionSize;\n"
+        "layout (location = 4) in vec3 aColour;\n"
+        "out vec3 Colour;\n"
+        "uniform mat4 view;\n"
+        "uniform mat4 projection;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_Position = projection * view * vec4(aPos * aPositionSize.w + aPositionSize.xyz, 1.0);\n"
+        "  Colour = aColour;\n"
+        "}";
+
+    const char *lightInstanceFragmentShaderSource = "#version 330 core\n"
+        "in vec3 Colour;\n"
+        "out vec4 FragColor;\n"
+        "void main()\n"
+        "{\n"
+        "  FragColor = vec4(Colour, 1.0);\n"
+        "}";
+
+    // one light instance as uploaded, matches the attributes above
+    struct LightInstance {
+        glm::vec4 positionSize;
+        glm::vec3 colour;
+    };
+
+    // GPU culled path: the same lighting, with the model matrix looked up from the culler's buffers
+    const char *gpuVertexShaderBody =
+        "layout (location = 0) in vec3 aPos;\n"
+        "layout (location = 1) in vec3 aNormal;\n"
+        "layout (location = 5) in vec2 aLightmapUV;\n"
+        "out vec3 Normal;\n"
+        "out vec3 FragPos;\n"
+        "out vec2 LightmapUV;\n"
+        "uniform mat4 view;\n"
+        "uniform mat4 projection;\n"
+        "void main()\n"
+        "{\n"
+        "  mat4 model = model_matrix();\n"
+        "  gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+        "  Normal = aNormal;\n"
+        "  FragPos = vec3(model * vec4(aPos, 1.0));\n"
+        "  LightmapUV = aLightmapUV;\n"
+        "}";
+
+    const char *gpuLightVertexShaderBody =
+        "layout (location = 0) in vec3 aPos;\n"
+        "uniform mat4 view;\n"
+        "uniform mat4 projection;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_Position = projection * view * model_matrix() * vec4(aPos, 1.0);\n"
+        "}";
+
+    ShaderHelper *sh = nullptr;
+    ShaderHelper *bakedSh = nullptr;
+    ShaderHelper *lightsh = nullptr;
+    unsigned int VAO;
+    unsigned int bakedVAO;
+    unsigned int VBO;
+    unsigned int lightVAO;
+    unsigned int texture1;
+    unsigned int texture2;
+
+    DrawItem materialDraws[MATERIAL_COUNT];
+    GpuCuller *gpuCuller = nullptr;
+    ShaderHelper *gpuShaders[MATERIAL_COUNT] = {nullptr, nullptr, nullptr};
+    std::vector<glm::mat4> gpuModels;
+    std::vector<AABB> gpuBounds;
+    std::vector<CommandList> commandLists;
+    OcclusionQueries *occlusionQueries = nullptr;
+    std::vector<unsigned int> recordedObjects;
+    std::vector<unsigned int> queriedObjects;
+    int viewportWidth = 0;
+    int viewportHeight = 0;
+
+    bool lightmapped = false;
+    unsigned int lightmapTexture;
+    unsigned int lightmapVBO;
+
+    ShadowCache *shadows = nullptr;
+
+    // the probes trace the static shadow casters, rebuilt whenever the static scene changes
+    LightProbes *probes = nullptr;
+    bool probeSceneBuilt = false;
+    unsigned long long probeStaticVersion = 0;
+    std::vector<AABB> probeObjectBounds;
+    std::vector<glm::vec3> probePositions;
+    std::vector<glm::vec3> probeAlbedos;
+
+    ClusteredLights *clusteredLights = nullptr;
+    std::vector<PointLight> frameLights;
+    ShaderHelper *lightInstanceSh = nullptr;
+    unsigned int lightInstanceVAO;
+    unsigned int lightInstanceVBO;
+    std::vector<LightInstance> lightInstances;
+
+    // deferred path: its own geometry pass programs per material, the lighting lives in DeferredShading
+    DeferredShading *deferred = nullptr;
+    DrawItem deferredDraws[MATERIAL_COUNT];
+    ShaderHelper *gbufferShaders[MATERIAL_COUNT] = {nullptr, nullptr, nullptr};
+
+    // GPU time of every pass, read back a few frames late
+    GpuProfiler *gpuProfiler = nullptr;
+    std::chrono::steady_clock::time_point lastTimingReport;
+
+    bool setup(glm::vec3 lightPos, GLADloadproc loadProc)
+    {
+        // the container's static lighting, baked offline, one uv per vertex of its mesh
+        Lightmap lightmap;
+        const unsigned int containerVertexCount = sizeof(container_buffer_data) / sizeof(float) / container_buffer_data_stride;
+        lightmapped = lightmap.load(LIGHTMAP_PATH);
+        if (lightmapped && lightmap.uvs.size() != containerVertexCount)
+        {
+            printf("%s was baked for a different mesh, rebake it with make lightmaps\n", LIGHTMAP_PATH);
+            lightmapped = false;
+        }
+
+        // the bake only holds for the one container it was made for, every other one keeps real time lighting
+        std::string fragmentSource = std::string("#version 330 core\n") +
+            ShadowCache::shaderSource + LightProbes::shaderSource + ClusteredLights::shaderSource + fragment2ShaderBody;
+        std::string bakedFragmentSource = std::string("#version 330 core\n") + (lightmapped ? "#define LIGHTMAP\n" : "") +
+            ShadowCache::shaderSource + LightProbes::shaderSource + ClusteredLights::shaderSource + fragment2ShaderBody;
+        const char *fragment2ShaderSource = fragmentSource.c_str();
+        const char *bakedFragmentShaderSource = bakedFragmentSource.c_str();
+
+        sh = new ShaderHelper();
+        sh->add_shader(GL_VERTEX_SHADER, &vertexShaderSource);
+        sh->add_shader(GL_FRAGMENT_SHADER, &fragment2ShaderSource);
+        sh->link_shaders();
+
+        bakedSh = new ShaderHelper();
+        bakedSh->add_shader(GL_VERTEX_SHADER, &vertexShaderSource);
+        bakedSh->add_shader(GL_FRAGMENT_SHADER, &bakedFragmentShaderSource);
+        bakedSh->link_shaders();
+        bakedSh->set_uniform("objectColor", 1.0f, 0.5f, 0.31f);
+
+        // textures
+        texture1 = sh->load_texture("assets/container.jpg", false);
+        texture2 = sh->load_texture("assets/awesomeface.png", true);
+
+        sh->use();
+        sh->set_uniform("texture1", 0);
+        sh->set_uniform("texture2", 1);
+        sh->set_uniform("objectColor", 1.0f, 0.5f, 0.31f);
+
+        // things bound when VAO is bound are attached to that object
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        // create one VBO. the function returns a "number" that represent internally where the VBO would go
+        glGenBuffers(1, &VBO);
+        // easy way to reference VBO, by binding it to the keyword and using that keyword instead
+        // only one of each type can be binding to its associated keyword
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+        // copy our data into a buffer for OpenGL
+        glBufferData(GL_ARRAY_BUFFER, sizeof(container_buffer_data), container_buffer_data, GL_STATIC_DRAW);
+
+        // vertex attribute is an attribute unique to each vector
+        // first arg is the # of the vertex attribute 
+        // second arg is the size of the vertex attribute, related to third arg (datatype)
+        // fourth arg is about whether or not to normalize to 0/-1 and 1
+        // fifth arg is distance between each vertex attribute. It would be the width of each vertex attribute
+        //   if we know it is tightly packed we can pass 0 to let opengl figure out the stride
+        // sixth arg is the offset of where the vertex attribute data begins in the buffer
+        // THE VBO BOUND TO GL_ARRAY_BUFFER IS THE ONE OPENGL uses for vertex data
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    
+        // vertex attribute are disabled by default
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3*sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        // glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6*sizeof(float)));
+        // glEnableVertexAttribArray(2);
+
+        // the same container, plus the lightmap uvs when there is a bake
+        glGenVertexArrays(1, &bakedVAO);
+        glBindVertexArray(bakedVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3*sizeof(float)));
+        glEnableVertexAttribArray(1);
+        if (lightmapped)
+        {
+            glGenBuffers(1, &lightmapVBO);
+            glBindBuffer(GL_ARRAY_BUFFER, lightmapVBO);
+            glBufferData(GL_ARRAY_BUFFER, lightmap.uvs.size() * sizeof(glm::vec2), lightmap.uvs.data(), GL_STATIC_DRAW);
+            glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+            glEnableVertexAttribArray(5);
+
+            glGenTextures(1, &lightmapTexture);
+            glBindTexture(GL_TEXTURE_2D, lightmapTexture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, lightmap.width, lightmap.height, 0, GL_RGB, GL_FLOAT, lightmap.texels.data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            bakedSh->set_uniform("lightmap", LIGHTMAP_TEXTURE_UNIT);
+        }
+
+        // lighting
+        glGenVertexArrays(1, &lightVAO);
+        glBindVertexArray(lightVAO);
+        // we only need to bind to the VBO, the container’s VBO’s data
+        // already contains the data.
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        lightsh = new ShaderHelper();
+        lightsh->add_shader(GL_VERTEX_SHADER, &lightSourceVertexShaderSource);
+        lightsh->add_shader(GL_FRAGMENT_SHADER, &lightSourceFragmentShaderSource);
+        lightsh->link_shaders();
+
+        lightInstanceSh = new ShaderHelper();
+        lightInstanceSh->add_shader(GL_VERTEX_SHADER, &lightInstanceVertexShaderSource);
+        lightInstanceSh->add_shader(GL_FRAGMENT_SHADER, &lightInstanceFragmentShaderSource);
+        lightInstanceSh->link_shaders();
+
+        // the cube positions again, plus one LightInstance per instance
+        glGenVertexArrays(1, &lightInstanceVAO);
+        glBindVertexArray(lightInstanceVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glGenBuffers(1, &lightInstanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, lightInstanceVBO);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(LightInstance), (void*)offsetof(LightInstance, positionSize));
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(LightInstance), (void*)offsetof(LightInstance, colour));
+        glEnableVertexAttribArray(4);
+        glVertexAttribDivisor(4, 1);
+        glBindVertexArray(0);
+
+        clusteredLights = new ClusteredLights();
+        clusteredLights->setup();
+        shadows = new ShadowCache();
+        shadows->setup();
+        probes = new LightProbes(probeBounds);
+        probes->setup();
+
+        gpuProfiler = new GpuProfiler();
+        lastTimingReport = std::chrono::steady_clock::now();
+
+        const AABB unitCube(glm::vec3(-0.5f), glm::vec3(0.5f));
+        materialDraws[MATERIAL_CONTAINER] = DrawItem{sh, VAO, sh->get_uniform_location("model"), 36, unitCube, true, true};
+        materialDraws[MATERIAL_LIGHT] = DrawItem{lightsh, lightVAO, lightsh->get_uniform_location("model"), 36, unitCube, false, false};
+        materialDraws[MATERIAL_BAKED_CONTAINER] = DrawItem{bakedSh, bakedVAO, bakedSh->get_uniform_location("model"), 36, unitCube, true, true};
+        occlusionQueries = new OcclusionQueries();
+        occlusionQueries->setup();
+
+        deferred = new DeferredShading();
+        deferred->setup();
+        // specular strength 1 marks the light cube as unlit. The deferred path has no lightmap, the baked container
+        // is lit like any other there
+        const float speculars[MATERIAL_COUNT] = { 0.5f, 1.0f, 0.5f };
+        for (unsigned int m = 0; m < MATERIAL_COUNT; m++)
+        {
+            gbufferShaders[m] = new ShaderHelper();
+            gbufferShaders[m]->add_shader(GL_VERTEX_SHADER, &vertexShaderSource);
+            gbufferShaders[m]->add_shader(GL_FRAGMENT_SHADER, &DeferredShading::geometryFragmentShaderSource);
+            gbufferShaders[m]->link_shaders();
+            gbufferShaders[m]->set_uniform("albedo", materialAlbedos[m]);
+            gbufferShaders[m]->set_uniform("specular", speculars[m]);
+            // both use the container VAO, the geometry pass needs normals even for the unlit cube
+            deferredDraws[m] = DrawItem{gbufferShaders[m], VAO, gbufferShaders[m]->get_uniform_location("model"), 36, materialDraws[m].localBounds, materialDraws[m].occlusionQuery, materialDraws[m].castsShadow};
+        }
+
+        gpuCuller = new GpuCuller();
+        if (gpuCuller->init(loadProc))
+        {
+            std::string containerSource = std::string(GpuCuller::drawShaderHeader) + gpuVertexShaderBody;
+            std::string lightSource = std::string(GpuCuller::drawShaderHeader) + gpuLightVertexShaderBody;
+            const char *container = containerSource.c_str();
+            const char *light = lightSource.c_str();
+
+            gpuShaders[MATERIAL_CONTAINER] = new ShaderHelper();
+            gpuShaders[MATERIAL_CONTAINER]->add_shader(GL_VERTEX_SHADER, &container);
+            gpuShaders[MATERIAL_CONTAINER]->add_shader(GL_FRAGMENT_SHADER, &fragment2ShaderSource);
+            gpuShaders[MATERIAL_CONTAINER]->link_shaders();
+            gpuShaders[MATERIAL_CONTAINER]->set_uniform("objectColor", 1.0f, 0.5f, 0.31f);
+
+            gpuShaders[MATERIAL_BAKED_CONTAINER] = new ShaderHelper();
+            gpuShaders[MATERIAL_BAKED_CONTAINER]->add_shader(GL_VERTEX_SHADER, &container);
+            gpuShaders[MATERIAL_BAKED_CONTAINER]->add_shader(GL_FRAGMENT_SHADER, &bakedFragmentShaderSource);
+            gpuShaders[MATERIAL_BAKED_CONTAINER]->link_shaders();
+            gpuShaders[MATERIAL_BAKED_CONTAINER]->set_uniform("objectColor", 1.0f, 0.5f, 0.31f);
+            gpuShaders[MATERIAL_BAKED_CONTAINER]->set_uniform("lightmap", LIGHTMAP_TEXTURE_UNIT);
+
+            gpuShaders[MATERIAL_LIGHT] = new ShaderHelper();
+            gpuShaders[MATERIAL_LIGHT]->add_shader(GL_VERTEX_SHADER, &light);
+            gpuShaders[MATERIAL_LIGHT]->add_shader(GL_FRAGMENT_SHADER, &lightSourceFragmentShaderSource);
+            gpuShaders[MATERIAL_LIGHT]->link_shaders();
+
+            for (unsigned int m = 0; m < MATERIAL_COUNT; m++)
+            {
+                gpuCuller->set_draw(m, materialDraws[m].vertexCount);
+            }
+        }
+
+        Camera::setup_hud(lightPos, glm::vec3(1.0f));
+
+        glEnable(GL_DEPTH_TEST);
+
+        return true;
+    }
+
+    void set_forward_uniforms(const FrameSnapshot &snapshot, const Camera::State &camera, const glm::mat4 &projection, const glm::mat4 &view)
+    {
+        for (ShaderHelper *container : {sh, bakedSh})
+        {
+            container->use();
+            container->set_uniform_matrix4("projection", 1, GL_FALSE, glm::value_ptr(projection));
+            container->set_uniform("mixU", snapshot.mixPercent);
+            container->set_uniform("viewPos", camera.pos);
+            container->set_uniform("lightPos", snapshot.lightPos);
+            container->set_uniform("lightColor", 1.0f, 1.0f, 1.0f);
+            container->set_uniform_matrix4("view", 1, GL_FALSE, glm::value_ptr(view));
+        }
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture1);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, texture2);
+
+        lightsh->use();
+        lightsh->set_uniform_matrix4("projection", 1, GL_FALSE, glm::value_ptr(projection));
+        lightsh->set_uniform_matrix4("view", 1, GL_FALSE, glm::value_ptr(view));
+    }
+
+    /* Draws the snapshot's visible objects with the given per material draws */
+    void draw_cpu_culled(const FrameSnapshot &snapshot, float alpha, const Camera::State &camera, const glm::mat4 &projection, const glm::mat4 &view, const DrawItem *draws)
+    {
+        PROFILE_SCOPE("draw_cpu_culled");
+        // cheap objects go through the command lists, expensive ones wait for a hardware occlusion query
+        recordedObjects.clear();
+        queriedObjects.clear();
+        for (unsigned int obj : snapshot.visibleObjects)
+        {
+            if (draws[snapshot.materials[obj]].occlusionQuery) queriedObjects.push_back(obj);
+            else recordedObjects.push_back(obj);
+        }
+
+        // workers record their share of the visible objects, this thread replays the lists in order
+        const std::vector<unsigned int> &visible = recordedObjects;
+        unsigned int listCount = ((unsigned int)visible.size() + RECORD_GRAIN - 1) / RECORD_GRAIN;
+        if (commandLists.size() < listCount) commandLists.resize(listCount);
+        JobSystem::parallel_for((unsigned int)visible.size(), RECORD_GRAIN, [&](unsigned int begin, unsigned int end) {
+            CommandList &list = commandLists[begin / RECORD_GRAIN];
+            list.reset();
+            for (unsigned int i = begin; i < end; i++)
+            {
+                const DrawItem &item = draws[snapshot.materials[visible[i]]];
+                list.bind_shader(item.shader);
+                list.bind_vao(item.vao);
+                // a straight blend of the matrices, steps are short enough that rotations don't visibly shear
+                glm::mat4 model = snapshot.previousWorldMatrices[visible[i]] * (1.0f - alpha) + snapshot.worldMatrices[visible[i]] * alpha;
+                list.set_uniform_matrix4(item.modelLocation, model);
+                list.draw_arrays(GL_TRIANGLES, 0, item.vertexCount);
+            }
+        });
+        CommandList::replay(commandLists.data(), listCount);
+
+        // front to back, so the nearer ones are already in the depth buffer when the farther proxies are tested
+        std::sort(queriedObjects.begin(), queriedObjects.end(), [&](unsigned int a, unsigned int b) {
+            return glm::length(glm::vec3(snapshot.worldMatrices[a][3]) - camera.pos) < glm::length(glm::vec3(snapshot.worldMatrices[b][3]) - camera.pos);
+        });
+        occlusionQueries->begin_frame(projection * view, camera.pos, Camera::NEAR_PLANE);
+        for (unsigned int obj : queriedObjects)
+        {
+            const DrawItem &item = draws[snapshot.materials[obj]];
+            glm::mat4 model = snapshot.previousWorldMatrices[obj] * (1.0f - alpha) + snapshot.worldMatrices[obj] * alpha;
+            occlusionQueries->draw(obj, AABB::transformed(item.localBounds, model), [&]() {
+                item.shader->use();
+                glUniformMatrix4fv(item.modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+                glBindVertexArray(item.vao);
+                glDrawArrays(GL_TRIANGLES, 0, item.vertexCount);
+            });
+        }
+        glBindVertexArray(0);
+    }
+
+    void draw_gpu_culled(const FrameSnapshot &snapshot, float alpha, const Camera::State &camera, const glm::mat4 &projection, const glm::mat4 &view)
+    {
+        PROFILE_SCOPE("draw_gpu_culled");
+        // every object goes up, the compute pass decides what is drawn
+        unsigned int count = (unsigned int)snapshot.worldMatrices.size();
+        gpuModels.resize(count);
+        gpuBounds.resize(count);
+        JobSystem::parallel_for(count, RECORD_GRAIN, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++)
+            {
+                gpuModels[i] = snapshot.previousWorldMatrices[i] * (1.0f - alpha) + snapshot.worldMatrices[i] * alpha;
+                gpuBounds[i] = AABB::transformed(materialDraws[snapshot.materials[i]].localBounds, gpuModels[i]);
+            }
+        });
+        gpuCuller->upload(gpuModels.data(), gpuBounds.data(), reinterpret_cast<const unsigned char *>(snapshot.materials.data()), count);
+
+        glm::mat4 viewProj = projection * view;
+        {
+            GpuProfiler::Scope scope(*gpuProfiler, "cull");
+            gpuCuller->cull(viewProj, true);
+        }
+
+        for (ShaderHelper *container : {gpuShaders[MATERIAL_CONTAINER], gpuShaders[MATERIAL_BAKED_CONTAINER]})
+        {
+            container->set_uniform_matrix4("projection", 1, GL_FALSE, glm::value_ptr(projection));
+            container->set_uniform_matrix4("view", 1, GL_FALSE, glm::value_ptr(view));
+            container->set_uniform("viewPos", camera.pos);
+            container->set_uniform("lightPos", snapshot.lightPos);
+            container->set_uniform("lightColor", 1.0f, 1.0f, 1.0f);
+        }
+        ShaderHelper *light = gpuShaders[MATERIAL_LIGHT];
+        light->set_uniform_matrix4("projection", 1, GL_FALSE, glm::value_ptr(projection));
+        light->set_uniform_matrix4("view", 1, GL_FALSE, glm::value_ptr(view));
+
+        // one indirect draw per material, however many objects there are
+        {
+            GpuProfiler::Scope scope(*gpuProfiler, "draw");
+            for (unsigned int m = 0; m < MATERIAL_COUNT; m++)
+            {
+                gpuShaders[m]->use();
+                glUniform1ui(gpuShaders[m]->get_uniform_location("visibleOffset"), gpuCuller->visible_offset(m));
+                glBindVertexArray(materialDraws[m].vao);
+                gpuCuller->draw(m);
+            }
+            glBindVertexArray(0);
+        }
+
+        // depth before the HUD goes on top, next frame tests against it
+        GpuProfiler::Scope scope(*gpuProfiler, "depth pyramid");
+        gpuCuller->build_depth_pyramid(viewportWidth, viewportHeight, viewProj);
+    }
+
+    /* Redraws the main light's shadow map where casters moved. Casters outside the view still cast, so every
+       object is considered, not just the visible ones */
+    void update_shadows(const FrameSnapshot &snapshot, float alpha)
+    {
+        PROFILE_SCOPE("update_shadows");
+        bool hasDynamic = false;
+        bool dynamicMoved = false;
+        for (unsigned int obj = 0; obj < snapshot.worldMatrices.size(); obj++)
+        {
+            if (!materialDraws[snapshot.materials[obj]].castsShadow || !snapshot.dynamicObjects[obj]) continue;
+            hasDynamic = true;
+            // while the two states differ the blend moves it every frame
+            if (snapshot.previousWorldMatrices[obj] != snapshot.worldMatrices[obj]) dynamicMoved = true;
+        }
+
+        shadows->update(snapshot.lightPos, shadowTarget, snapshot.staticVersion, hasDynamic, dynamicMoved, [&](bool dynamic) {
+            for (unsigned int obj = 0; obj < snapshot.worldMatrices.size(); obj++)
+            {
+                const DrawItem &item = materialDraws[snapshot.materials[obj]];
+                if (!item.castsShadow || (snapshot.dynamicObjects[obj] != 0) != dynamic) continue;
+                glm::mat4 model = snapshot.previousWorldMatrices[obj] * (1.0f - alpha) + snapshot.worldMatrices[obj] * alpha;
+                shadows->draw_caster(model, item.vao, item.vertexCount);
+            }
+        });
+    }
+
+    /* Rebuilds the probes' scene when static objects changed, dirtying the probes around where they were and
+       where they are now, then re-bakes the next few dirty probes. Dynamic objects are left out */
+    void update_probes(const FrameSnapshot &snapshot)
+    {
+        PROFILE_SCOPE("update_probes");
+        if (!probeSceneBuilt || snapshot.staticVersion != probeStaticVersion)
+        {
+            const unsigned int vertexCount = sizeof(container_buffer_data) / sizeof(float) / container_buffer_data_stride;
+            probePositions.clear();
+            probeAlbedos.clear();
+            probeObjectBounds.resize(snapshot.worldMatrices.size());
+            for (unsigned int obj = 0; obj < snapshot.worldMatrices.size(); obj++)
+            {
+                const DrawItem &item = materialDraws[snapshot.materials[obj]];
+                AABB bounds;
+                if (item.castsShadow && !snapshot.dynamicObjects[obj])
+                {
+                    const glm::mat4 &model = snapshot.worldMatrices[obj];
+                    for (unsigned int v = 0; v < vertexCount; v++)
+                    {
+                        const float *p = &container_buffer_data[v * container_buffer_data_stride];
+                        probePositions.push_back(glm::vec3(model * glm::vec4(p[0], p[1], p[2], 1.0f)));
+                    }
+                    probeAlbedos.insert(probeAlbedos.end(), vertexCount / 3, materialAlbedos[snapshot.materials[obj]]);
+                    bounds = AABB::transformed(item.localBounds, model);
+                }
+                // every probe starts dirty, after that only the ones near something that moved
+                if (probeSceneBuilt && bounds != probeObjectBounds[obj])
+                {
+                    if (probeObjectBounds[obj].valid()) probes->invalidate(probeObjectBounds[obj]);
+                    if (bounds.valid()) probes->invalidate(bounds);
+                }
+                probeObjectBounds[obj] = bounds;
+            }
+            probes->set_geometry(probePositions, probeAlbedos);
+            probeSceneBuilt = true;
+            probeStaticVersion = snapshot.staticVersion;
+        }
+
+        probes->set_light(snapshot.lightPos, glm::vec3(1.0f));
+        probes->update();
+    }
+
+    /* Prints the pass timings now and then */
+    void report_timings()
+    {
+        // wall clock rather than the window's, headless runs have no window
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - lastTimingReport).count() >= TIMING_REPORT_SECONDS)
+        {
+            gpuProfiler->print();
+            lastTimingReport = now;
+        }
+    }
+
+    void draw_frame(const FrameSnapshot &snapshot, float alpha)
+    {
+        if (snapshot.framebufferWidth != viewportWidth || snapshot.framebufferHeight != viewportHeight)
+        {
+            viewportWidth = snapshot.framebufferWidth;
+            viewportHeight = snapshot.framebufferHeight;
+            glViewport(0, 0, viewportWidth, viewportHeight);
+        }
+
+        gpuProfiler->begin_frame();
+        report_timings();
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        Camera::State camera = Camera::interpolate(snapshot.previousCamera, snapshot.camera, alpha);
+        glm::mat4 projection = Camera::projection_matrix(camera);
+        glm::mat4 view = Camera::view_matrix(camera);
+
+        // the main light reaches everything, the point lights blend like the rest of the scene
+        unsigned int pointLightCount = (unsigned int)snapshot.pointLights.size();
+        frameLights.resize(pointLightCount + 1);
+        frameLights[0] = PointLight{snapshot.lightPos, MAIN_LIGHT_RADIUS, glm::vec3(1.0f)};
+        lightInstances.resize(pointLightCount);
+        for (unsigned int i = 0; i < pointLightCount; i++)
+        {
+            PointLight light = snapshot.pointLights[i];
+            light.position = glm::mix(snapshot.previousPointLights[i].position, light.position, alpha);
+            frameLights[i + 1] = light;
+            lightInstances[i] = LightInstance{glm::vec4(light.position, POINT_LIGHT_CUBE_SIZE), light.colour};
+        }
+
+        {
+            GpuProfiler::Scope scope(*gpuProfiler, "shadows");
+            update_shadows(snapshot, alpha);
+        }
+        {
+            GpuProfiler::Scope scope(*gpuProfiler, "probes");
+            update_probes(snapshot);
+        }
+
+        if (snapshot.deferredShading)
+        {
+            GpuProfiler::Scope scene(*gpuProfiler, "scene");
+            GpuProfiler::Scope path(*gpuProfiler, "deferred");
+            // geometry into the G-buffer, then lighting that costs per lit pixel rather than per object drawn
+            for (ShaderHelper *gbufferShader : gbufferShaders)
+            {
+                gbufferShader->set_uniform_matrix4("projection", 1, GL_FALSE, glm::value_ptr(projection));
+                gbufferShader->set_uniform_matrix4("view", 1, GL_FALSE, glm::value_ptr(view));
+            }
+            {
+                GpuProfiler::Scope scope(*gpuProfiler, "geometry");
+                deferred->begin_geometry(viewportWidth, viewportHeight);
+                draw_cpu_culled(snapshot, alpha, camera, projection, view, deferredDraws);
+            }
+            {
+                GpuProfiler::Scope scope(*gpuProfiler, "lighting");
+                deferred->light(frameLights[0], *shadows, *probes, frameLights.data() + 1, pointLightCount, projection * view, camera.pos);
+            }
+            gpuCuller->invalidate_depth_pyramid();
+        }
+        else
+        {
+            GpuProfiler::Scope scene(*gpuProfiler, "scene");
+            GpuProfiler::Scope path(*gpuProfiler, "forward");
+            {
+                GpuProfiler::Scope scope(*gpuProfiler, "clusters");
+                // the main light is shaded on its own so it can be shadowed, the clusters only hold the point lights
+                clusteredLights->assign(frameLights.data() + 1, pointLightCount, view, projection, Camera::NEAR_PLANE, Camera::FAR_PLANE);
+                clusteredLights->upload();
+            }
+            for (ShaderHelper *container : {sh, bakedSh, gpuShaders[MATERIAL_CONTAINER], gpuShaders[MATERIAL_BAKED_CONTAINER]})
+            {
+                if (container == nullptr) continue;
+                clusteredLights->bind(container, LIGHT_TEXTURE_UNIT, viewportWidth, viewportHeight);
+                shadows->bind(container, ShadowCache::TEXTURE_UNIT);
+                probes->bind(container, LightProbes::TEXTURE_UNIT);
+            }
+            if (lightmapped)
+            {
+                glActiveTexture(GL_TEXTURE0 + LIGHTMAP_TEXTURE_UNIT);
+                glBindTexture(GL_TEXTURE_2D, lightmapTexture);
+                glActiveTexture(GL_TEXTURE0);
+            }
+
+            if (gpuCuller->supported() && snapshot.gpuCulling)
+            {
+                draw_gpu_culled(snapshot, alpha, camera, projection, view);
+            }
+            else
+            {
+                {
+                    GpuProfiler::Scope scope(*gpuProfiler, "draw");
+                    set_forward_uniforms(snapshot, camera, projection, view);
+                    draw_cpu_culled(snapshot, alpha, camera, projection, view, materialDraws);
+                }
+                gpuCuller->invalidate_depth_pyramid();
+            }
+        }
+
+        if (pointLightCount > 0)
+        {
+            GpuProfiler::Scope scope(*gpuProfiler, "point lights");
+            lightInstanceSh->set_uniform_matrix4("projection", 1, GL_FALSE, glm::value_ptr(projection));
+            lightInstanceSh->set_uniform_matrix4("view", 1, GL_FALSE, glm::value_ptr(view));
+            glBindBuffer(GL_ARRAY_BUFFER, lightInstanceVBO);
+            glBufferData(GL_ARRAY_BUFFER, lightInstances.size() * sizeof(LightInstance), lightInstances.data(), GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(lightInstanceVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, pointLightCount);
+            glBindVertexArray(0);
+        }
+
+        {
+            GpuProfiler::Scope scope(*gpuProfiler, "hud");
+            Camera::draw_hud(camera);
+        }
+        gpuProfiler->end_frame();
+    }
+
+    bool validate_gpu_culling(const FrameSnapshot &snapshot)
+    {
+        if (!gpuCuller->supported())
+        {
+            printf("GPU culling needs GL 4.3, nothing to validate\n");
+            return false;
+        }
+        unsigned int count = (unsigned int)snapshot.worldMatrices.size();
+        gpuModels.resize(count);
+        gpuBounds.resize(count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            gpuModels[i] = snapshot.worldMatrices[i];
+            gpuBounds[i] = AABB::transformed(materialDraws[snapshot.materials[i]].localBounds, gpuModels[i]);
+        }
+        gpuCuller->upload(gpuModels.data(), gpuBounds.data(), reinterpret_cast<const unsigned char *>(snapshot.materials.data()), count);
+        return gpuCuller->validate(Camera::projection_matrix(snapshot.camera) * Camera::view_matrix(snapshot.camera), gpuBounds.data());
+    }
+
+    unsigned long long shadow_static_renders()
+    {
+        return shadows->static_renders();
+    }
+
+    unsigned long long shadow_dynamic_renders()
+    {
+        return shadows->dynamic_renders();
+    }
+
+    void shutdown()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteVertexArrays(1, &bakedVAO);
+        glDeleteVertexArrays(1, &lightVAO);
+        glDeleteVertexArrays(1, &lightInstanceVAO);
+        glDeleteBuffers(1, &lightInstanceVBO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteTextures(1, &texture1);
+        glDeleteTextures(1, &texture2);
+        if (lightmapped)
+        {
+            glDeleteBuffers(1, &lightmapVBO);
+            glDeleteTextures(1, &lightmapTexture);
+        }
+        delete sh;
+        delete bakedSh;
+        delete lightsh;
+        sh = bakedSh = lightsh = nullptr;
+        for (ShaderHelper *&gpuShader : gpuShaders)
+        {
+            delete gpuShader;
+            gpuShader = nullptr;
+        }
+        delete gpuCuller;
+        gpuCuller = nullptr;
+        delete occlusionQueries;
+        occlusionQueries = nullptr;
+        delete clusteredLights;
+        clusteredLights = nullptr;
+        delete shadows;
+        shadows = nullptr;
+        delete probes;
+        probes = nullptr;
+        probeSceneBuilt = false;
+        delete deferred;
+        deferred = nullptr;
+        for (ShaderHelper *&gbufferShader : gbufferShaders)
+        {
+            delete gbufferShader;
+            gbufferShader = nullptr;
+        }
+        delete gpuProfiler;
+        gpuProfiler = nullptr;
+        delete lightInstanceSh;
+        lightInstanceSh = nullptr;
+        commandLists.clear();
+    }
+};
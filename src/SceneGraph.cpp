@@ -0,0 +1,167 @@
+#include "SceneGraph.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    // nodes per job when a level is split across workers. Smaller levels run inline
+    const unsigned int LEVEL_JOB_GRAIN = 8192;
+}
+
+SceneGraph::SceneGraph() : m_dirtyCount(0), m_anyChanged(false), m_needsSort(false)
+{
+}
+
+SceneGraph::NodeId SceneGraph::create_node(NodeId parent, const glm::mat4 &local)
+{
+    NodeId id = (NodeId)m_idToSlot.size();
+    unsigned int slot = (unsigned int)m_world.size();
+
+    unsigned int parentSlot = NO_PARENT;
+    unsigned int depth = 0;
+    if (parent != NO_PARENT)
+    {
+        assert(parent < m_idToSlot.size());
+        parentSlot = m_idToSlot[parent];
+        depth = m_depth[parentSlot] + 1;
+    }
+
+    // still in depth order if this node is on the deepest level or starts a new one
+    if (!m_needsSort)
+    {
+        if (m_levelStart.empty())
+        {
+            m_levelStart.push_back(0);
+            m_levelStart.push_back(1);
+        }
+        else if (depth == m_depth.back())
+        {
+            m_levelStart.back()++;
+        }
+        else if (depth == m_depth.back() + 1)
+        {
+            m_levelStart.push_back(slot + 1);
+        }
+        else
+        {
+            m_needsSort = true;
+        }
+    }
+
+    m_parent.push_back(parentSlot);
+    m_depth.push_back(depth);
+    m_local.push_back(local);
+    m_world.push_back(local);
+    m_dirty.push_back(1);
+    m_changed.push_back(0);
+    m_slotToId.push_back(id);
+    m_idToSlot.push_back(slot);
+    m_dirtyCount++;
+
+    return id;
+}
+
+void SceneGraph::set_local(NodeId node, const glm::mat4 &local)
+{
+    unsigned int slot = m_idToSlot[node];
+    m_local[slot] = local;
+    if (!m_dirty[slot])
+    {
+        m_dirty[slot] = 1;
+        m_dirtyCount++;
+    }
+}
+
+void SceneGraph::sort_by_depth()
+{
+    unsigned int count = size();
+    unsigned int levels = *std::max_element(m_depth.begin(), m_depth.end()) + 1;
+
+    // counting sort keeps the existing order inside each level, so parents still come first
+    m_levelStart.assign(levels + 1, 0);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        m_levelStart[m_depth[i] + 1]++;
+    }
+    for (unsigned int l = 0; l < levels; l++)
+    {
+        m_levelStart[l + 1] += m_levelStart[l];
+    }
+
+    std::vector<unsigned int> next(m_levelStart.begin(), m_levelStart.end() - 1);
+    std::vector<unsigned int> newSlot(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        newSlot[i] = next[m_depth[i]]++;
+    }
+
+    std::vector<unsigned int> parent(count), depth(count);
+    std::vector<glm::mat4> local(count), world(count);
+    std::vector<unsigned char> dirty(count), changed(count);
+    std::vector<NodeId> slotToId(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int s = newSlot[i];
+        parent[s] = m_parent[i] == NO_PARENT ? NO_PARENT : newSlot[m_parent[i]];
+        depth[s] = m_depth[i];
+        local[s] = m_local[i];
+        world[s] = m_world[i];
+        dirty[s] = m_dirty[i];
+        changed[s] = m_changed[i];
+        slotToId[s] = m_slotToId[i];
+        m_idToSlot[m_slotToId[i]] = s;
+    }
+
+    m_parent.swap(parent);
+    m_depth.swap(depth);
+    m_local.swap(local);
+    m_world.swap(world);
+    m_dirty.swap(dirty);
+    m_changed.swap(changed);
+    m_slotToId.swap(slotToId);
+    m_needsSort = false;
+}
+
+void SceneGraph::update_range(unsigned int begin, unsigned int end)
+{
+    for (unsigned int i = begin; i < end; i++)
+    {
+        unsigned int p = m_parent[i];
+        bool parentChanged = p != NO_PARENT && m_changed[p];
+        bool recompute = m_dirty[i] || parentChanged;
+        m_changed[i] = recompute;
+        if (!recompute) continue;
+
+        m_world[i] = p != NO_PARENT ? m_world[p] * m_local[i] : m_local[i];
+        m_dirty[i] = 0;
+    }
+}
+
+void SceneGraph::update()
+{
+    if (m_needsSort) sort_by_depth();
+
+    if (m_dirtyCount == 0)
+    {
+        // nothing moved, only the flags from the previous update need clearing
+        if (m_anyChanged) std::fill(m_changed.begin(), m_changed.end(), 0);
+        m_anyChanged = false;
+        return;
+    }
+
+    for (unsigned int l = 0; l + 1 < m_levelStart.size(); l++)
+    {
+        unsigned int begin = m_levelStart[l];
+        unsigned int count = m_levelStart[l + 1] - begin;
+
+        // every node on a level only reads the level above, so any split of the level is safe
+        JobSystem::parallel_for(count, LEVEL_JOB_GRAIN, [this, begin](unsigned int b, unsigned int e) {
+            update_range(begin + b, begin + e);
+        });
+    }
+
+    m_dirtyCount = 0;
+    m_anyChanged = true;
+}
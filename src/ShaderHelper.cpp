@@ -1,4 +1,5 @@
 #include "ShaderHelper.h"
+#include "CpuProfiler.h"
 
 ShaderHelper::ShaderHelper()
 {
@@ -18,7 +19,7 @@ ShaderHelper::~ShaderHelper()
 /* Compiles a shader and adds it to the helper object. */
 bool ShaderHelper::add_shader(GLenum type, const char **source)
 {
-    if (type != GL_VERTEX_SHADER && type != GL_FRAGMENT_SHADER)
+    if (type != GL_VERTEX_SHADER && type != GL_FRAGMENT_SHADER && type != GL_COMPUTE_SHADER)
     {
         std::cout << "ERROR! Provided shader is not compatible.\n" << std::endl;
         return false;
@@ -56,6 +57,7 @@ bool ShaderHelper::add_shader(GLenum type, const char **source)
 /* Links the known shaders to the program */
 bool ShaderHelper::link_shaders()
 {
+    PROFILE_SCOPE("ShaderHelper::link_shaders");
     glLinkProgram(m_shaderProgram);
 
     int success;
@@ -116,6 +118,7 @@ void ShaderHelper::set_uniform_matrix4(const char *name, GLsizei count, GLboolea
 
 unsigned int ShaderHelper::load_texture(const char *filename, bool transparent)
 {
+    PROFILE_SCOPE("ShaderHelper::load_texture");
     int width, height, nrChannels;
     unsigned char *data = stbi_load(filename, &width, &height, &nrChannels, 0);
 
@@ -0,0 +1,174 @@
+#include "ShadowCache.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+
+#define SHADOW_FOV 90.0f
+#define SHADOW_NEAR 0.1f
+#define SHADOW_FAR 50.0f
+
+namespace
+{
+    const char *depthVertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n"
+        "uniform mat4 model;\n"
+        "uniform mat4 lightViewProj;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_Position = lightViewProj * model * vec4(aPos, 1.0);\n"
+        "}";
+
+    const char *depthFragmentShaderSource = "#version 330 core\n"
+        "void main()\n"
+        "{\n"
+        "}";
+}
+
+const char *ShadowCache::shaderSource =
+    "uniform sampler2DShadow shadowMap;\n"
+    "uniform mat4 lightViewProj;\n"
+    "float shadow_factor(vec3 fragPos, vec3 normal)\n"
+    "{\n"
+    // pushed out along the normal so lit faces don't shadow themselves
+    "  vec4 p = lightViewProj * vec4(fragPos + normal * 0.02, 1.0);\n"
+    "  if (p.w <= 0.0) return 1.0;\n"
+    "  vec3 c = p.xyz / p.w * 0.5 + 0.5;\n"
+    "  if (any(lessThan(c, vec3(0.0))) || any(greaterThan(c, vec3(1.0)))) return 1.0;\n"   // outside the spot
+    "  vec2 texel = 0.5 / vec2(textureSize(shadowMap, 0));\n"
+    // four bilinear compares, each already a 2x2 filter
+    "  float lit = texture(shadowMap, vec3(c.xy + vec2(-texel.x, -texel.y), c.z))\n"
+    "            + texture(shadowMap, vec3(c.xy + vec2( texel.x, -texel.y), c.z))\n"
+    "            + texture(shadowMap, vec3(c.xy + vec2(-texel.x,  texel.y), c.z))\n"
+    "            + texture(shadowMap, vec3(c.xy + vec2( texel.x,  texel.y), c.z));\n"
+    "  return lit * 0.25;\n"
+    "}\n";
+
+ShadowCache::ShadowCache()
+    : m_cacheTexture(0), m_cacheFramebuffer(0), m_dynamicTexture(0), m_dynamicFramebuffer(0), m_current(0),
+      m_depthShader(nullptr), m_modelLocation(-1), m_cacheValid(false), m_dynamicValid(false),
+      m_staticVersion(0), m_staticRenders(0), m_dynamicRenders(0)
+{
+}
+
+ShadowCache::~ShadowCache()
+{
+    if (m_depthShader == nullptr) return;
+    glDeleteFramebuffers(1, &m_cacheFramebuffer);
+    glDeleteFramebuffers(1, &m_dynamicFramebuffer);
+    glDeleteTextures(1, &m_cacheTexture);
+    glDeleteTextures(1, &m_dynamicTexture);
+    delete m_depthShader;
+}
+
+void ShadowCache::setup()
+{
+    m_depthShader = new ShaderHelper();
+    m_depthShader->add_shader(GL_VERTEX_SHADER, &depthVertexShaderSource);
+    m_depthShader->add_shader(GL_FRAGMENT_SHADER, &depthFragmentShaderSource);
+    m_depthShader->link_shaders();
+    m_modelLocation = m_depthShader->get_uniform_location("model");
+
+    unsigned int *textures[2] = { &m_cacheTexture, &m_dynamicTexture };
+    unsigned int *framebuffers[2] = { &m_cacheFramebuffer, &m_dynamicFramebuffer };
+    for (int i = 0; i < 2; i++)
+    {
+        // same format for both, so the cache can be blitted straight across
+        glGenTextures(1, textures[i]);
+        glBindTexture(GL_TEXTURE_2D, *textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SIZE, SIZE, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glGenFramebuffers(1, framebuffers[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, *framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, *textures[i], 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_current = m_cacheTexture;
+}
+
+void ShadowCache::render(unsigned int framebuffer, bool clear, bool dynamic, const std::function<void(bool dynamic)> &drawCasters)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    if (clear) glClear(GL_DEPTH_BUFFER_BIT);
+
+    m_depthShader->set_uniform_matrix4("lightViewProj", 1, GL_FALSE, glm::value_ptr(m_lightViewProj));
+    // slope scaled bias, the receivers add a normal offset on top
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    drawCasters(dynamic);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindVertexArray(0);
+}
+
+void ShadowCache::update(const glm::vec3 &lightPos, const glm::vec3 &target, unsigned long long staticVersion,
+                         bool hasDynamic, bool dynamicMoved, const std::function<void(bool dynamic)> &drawCasters)
+{
+    bool staticDirty = !m_cacheValid || lightPos != m_lightPos || target != m_target || staticVersion != m_staticVersion;
+    bool dynamicDirty = hasDynamic && (staticDirty || dynamicMoved || !m_dynamicValid);
+    if (!staticDirty && !dynamicDirty)
+    {
+        // nothing moved, last frame's map is still right
+        m_current = hasDynamic ? m_dynamicTexture : m_cacheTexture;
+        return;
+    }
+
+    GLint previousFramebuffer;
+    GLint previousViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glViewport(0, 0, SIZE, SIZE);
+
+    if (staticDirty)
+    {
+        glm::vec3 up = fabsf(glm::normalize(target - lightPos).y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        m_lightViewProj = glm::perspective(glm::radians(SHADOW_FOV), 1.0f, SHADOW_NEAR, SHADOW_FAR) * glm::lookAt(lightPos, target, up);
+        m_lightPos = lightPos;
+        m_target = target;
+        m_staticVersion = staticVersion;
+
+        render(m_cacheFramebuffer, true, false, drawCasters);
+        m_cacheValid = true;
+        m_staticRenders++;
+    }
+
+    if (dynamicDirty)
+    {
+        // start from the cached statics and only draw what moves
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_cacheFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_dynamicFramebuffer);
+        glBlitFramebuffer(0, 0, SIZE, SIZE, 0, 0, SIZE, SIZE, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        render(m_dynamicFramebuffer, false, true, drawCasters);
+        m_dynamicRenders++;
+    }
+    m_dynamicValid = hasDynamic;
+    m_current = hasDynamic ? m_dynamicTexture : m_cacheTexture;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+void ShadowCache::draw_caster(const glm::mat4 &model, unsigned int vao, GLsizei vertexCount)
+{
+    glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+}
+
+void ShadowCache::bind(ShaderHelper *shader, int unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, m_current);
+    glActiveTexture(GL_TEXTURE0);
+    shader->set_uniform("shadowMap", unit);
+    shader->set_uniform_matrix4("lightViewProj", 1, GL_FALSE, glm::value_ptr(m_lightViewProj));
+}
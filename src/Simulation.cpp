@@ -0,0 +1,199 @@
+#include "Simulation.h"
+#include "CpuProfiler.h"
+#include "cube.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// small coloured lights orbiting the container, lit through the clustered forward path
+#define POINT_LIGHT_RADIUS 1.5f
+// the "cubes" scene: a grid of containers a little below the first one
+#define GRID_SPACING 2.0f
+#define GRID_HEIGHT -2.0f
+// the container circling the first one in the "cubes" scene, shadowing the grid as a dynamic caster
+#define ORBIT_RADIUS 2.5f
+#define ORBIT_HEIGHT -0.5f
+#define ORBIT_SPEED 0.8f
+
+static const AABB unitCube(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+Simulation::Simulation()
+    : m_orbiter(-1), m_staticVersion(0), m_step(0)
+{
+}
+
+void Simulation::add_object(const glm::mat4 &world, Renderer::Material material, bool dynamic, bool occludes)
+{
+    // the lightmap was baked in object space for a container at the origin, anywhere else it would show that
+    // container's lighting, so it gets the real time path instead
+    if (material == Renderer::MATERIAL_BAKED_CONTAINER && world != glm::mat4(1.0f)) material = Renderer::MATERIAL_CONTAINER;
+    m_objectNodes.push_back(m_scene.create_node(SceneGraph::NO_PARENT, world));
+    m_materials.push_back(material);
+    m_dynamic.push_back(dynamic);
+    m_occludes.push_back(occludes);
+}
+
+bool Simulation::setup(const std::string &scene, unsigned int count, glm::vec3 lightPos)
+{
+    if (scene != "default" && scene != "cubes") return false;
+    m_sceneName = scene;
+
+    // the container is solid and big enough to hide things, the light cube is not worth rasterising
+    add_object(glm::mat4(1.0f), Renderer::MATERIAL_BAKED_CONTAINER, false, true);
+    add_object(glm::scale(glm::translate(glm::mat4(1.0f), lightPos), glm::vec3(0.2f)), Renderer::MATERIAL_LIGHT, false, false);
+
+    if (scene == "cubes")
+    {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2832f);
+        unsigned int side = (unsigned int)ceil(sqrt((double)count));
+        for (unsigned int i = 0; i < count; i++)
+        {
+            glm::vec3 p = glm::vec3(((float)(i % side) - side * 0.5f) * GRID_SPACING, GRID_HEIGHT, ((float)(i / side) - side * 0.5f) * GRID_SPACING);
+            // moved and turned, so lit in real time: shadowed by the main light and ambient from the probes
+            add_object(glm::rotate(glm::translate(glm::mat4(1.0f), p), angle(rng), glm::vec3(0.0f, 1.0f, 0.0f)), Renderer::MATERIAL_CONTAINER, false, true);
+        }
+        // the only thing that moves, so the grid stays in the static shadow cache and this is redrawn on top
+        m_orbiter = (int)m_objectNodes.size();
+        add_object(orbit_matrix(0.0), Renderer::MATERIAL_CONTAINER, true, true);
+    }
+    m_scene.update();
+
+    std::vector<AABB> objectBounds;
+    for (SceneGraph::NodeId node : m_objectNodes)
+    {
+        objectBounds.push_back(AABB::transformed(unitCube, m_scene.world(node)));
+        m_previousWorld.push_back(m_scene.world(node));
+    }
+    m_bvh.build(objectBounds);
+    m_occlusionVisible.assign(m_objectNodes.size(), 1);
+
+    // scattered over a shell around the container with random colours
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (unsigned int i = 0; i < POINT_LIGHT_COUNT; i++)
+    {
+        m_lightOrbits.push_back(LightOrbit{2.0f + 14.0f * unit(rng), -3.0f + 6.0f * unit(rng), 0.1f + 0.4f * unit(rng), 6.2832f * unit(rng)});
+        glm::vec3 colour = glm::vec3(unit(rng), unit(rng), unit(rng));
+        m_pointLights.push_back(PointLight{glm::vec3(0.0f), POINT_LIGHT_RADIUS, colour / std::max(colour.r, std::max(colour.g, colour.b)) * 0.6f});
+    }
+    update_point_lights(0.0);
+    m_previousPointLights = m_pointLights;
+
+    m_previousCamera = Camera::get_state();
+    return true;
+}
+
+glm::mat4 Simulation::orbit_matrix(double time)
+{
+    float angle = ORBIT_SPEED * (float)time;
+    glm::vec3 p = glm::vec3(cosf(angle) * ORBIT_RADIUS, ORBIT_HEIGHT, sinf(angle) * ORBIT_RADIUS);
+    // turns as it goes so the same face leads
+    return glm::rotate(glm::translate(glm::mat4(1.0f), p), -angle, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void Simulation::update_point_lights(double time)
+{
+    for (size_t i = 0; i < m_pointLights.size(); i++)
+    {
+        const LightOrbit &orbit = m_lightOrbits[i];
+        float angle = orbit.phase + orbit.speed * (float)time;
+        m_pointLights[i].position = glm::vec3(cosf(angle) * orbit.radius, orbit.height + 0.5f * sinf(angle * 3.0f), sinf(angle) * orbit.radius);
+    }
+}
+
+void Simulation::begin_step()
+{
+    m_previousCamera = Camera::get_state();
+    for (unsigned int obj = 0; obj < m_objectNodes.size(); obj++)
+    {
+        m_previousWorld[obj] = m_scene.world(m_objectNodes[obj]);
+    }
+    m_previousPointLights = m_pointLights;
+}
+
+void Simulation::end_step(double dt)
+{
+    PROFILE_SCOPE("Simulation::end_step");
+    update_point_lights((m_step + 1) * dt);
+    if (m_orbiter >= 0) m_scene.set_local(m_objectNodes[m_orbiter], orbit_matrix((m_step + 1) * dt));
+
+    // only nodes whose transforms changed touch the BVH
+    m_scene.update();
+    for (unsigned int obj = 0; obj < m_objectNodes.size(); obj++)
+    {
+        if (!m_scene.changed(m_objectNodes[obj])) continue;
+        m_bvh.update(obj, AABB::transformed(unitCube, m_scene.world(m_objectNodes[obj])));
+        if (!m_dynamic[obj]) m_staticVersion++;
+    }
+
+    m_step++;
+}
+
+void Simulation::fill_snapshot(Renderer::FrameSnapshot &snapshot)
+{
+    PROFILE_SCOPE("Simulation::fill_snapshot");
+    m_bvh.refit();
+
+    snapshot.frame = m_step;
+    snapshot.camera = Camera::get_state();
+    snapshot.previousCamera = m_previousCamera;
+    snapshot.pointLights = m_pointLights;
+    snapshot.previousPointLights = m_previousPointLights;
+
+    unsigned int objectCount = (unsigned int)m_objectNodes.size();
+    snapshot.worldMatrices.resize(objectCount);
+    snapshot.previousWorldMatrices = m_previousWorld;
+    snapshot.materials = m_materials;
+    snapshot.dynamicObjects = m_dynamic;
+    for (unsigned int obj = 0; obj < objectCount; obj++)
+    {
+        snapshot.worldMatrices[obj] = m_scene.world(m_objectNodes[obj]);
+    }
+    snapshot.staticVersion = m_staticVersion;
+
+    // frustum cull through the BVH so whole groups of objects are rejected at once.
+    // the render thread draws somewhere between the two states, so keep anything either camera can see
+    snapshot.visibleObjects.clear();
+    {
+        PROFILE_SCOPE("frustum cull");
+        const Camera::State *cameras[2] = { &snapshot.previousCamera, &snapshot.camera };
+        for (const Camera::State *camera : cameras)
+        {
+            glm::mat4 viewProj = Camera::projection_matrix(*camera) * Camera::view_matrix(*camera);
+            m_bvh.query_frustum(Frustum::from_matrix(viewProj), snapshot.visibleObjects);
+        }
+        std::sort(snapshot.visibleObjects.begin(), snapshot.visibleObjects.end());
+        snapshot.visibleObjects.erase(std::unique(snapshot.visibleObjects.begin(), snapshot.visibleObjects.end()), snapshot.visibleObjects.end());
+    }
+
+    // occlusion cull what survived, rasterising the biggest occluders as seen from the newer camera
+    {
+        PROFILE_SCOPE("occlusion cull");
+        const glm::vec3 *cubeMesh = reinterpret_cast<const glm::vec3 *>(cube_buffer_data);
+        m_occlusion.begin(Camera::projection_matrix(snapshot.camera) * Camera::view_matrix(snapshot.camera));
+        for (unsigned int obj : snapshot.visibleObjects)
+        {
+            if (m_occludes[obj]) m_occlusion.add_occluder(cubeMesh, cube_elements_data, 36, m_scene.world(m_objectNodes[obj]), m_bvh.object_bounds(obj));
+        }
+        m_occlusion.rasterize();
+        m_frustumVisible = snapshot.visibleObjects;
+        m_occlusion.cull(snapshot.visibleObjects, m_bvh);
+    }
+
+    // anything visible at the previous step stays one more, the render thread may still be blending away from it
+    m_nowVisible.assign(objectCount, 0);
+    for (unsigned int obj : snapshot.visibleObjects)
+    {
+        m_nowVisible[obj] = 1;
+    }
+    snapshot.visibleObjects.clear();
+    for (unsigned int obj : m_frustumVisible)
+    {
+        if (m_nowVisible[obj] || m_occlusionVisible[obj]) snapshot.visibleObjects.push_back(obj);
+    }
+    m_occlusionVisible.swap(m_nowVisible);
+}
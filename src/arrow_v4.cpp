@@ -1,176 +1,176 @@
-float arrow_v4_buffer_data[676] = {
-	-0.5f, 0.0f, 0.0f, 0.8f,
-	-0.482963f, 0.0f, -0.12941f, 0.8f,
-	-0.433013f, 0.0f, -0.25f, 0.8f,
-	-0.353553f, 0.0f, -0.353553f, 0.8f,
-	-0.25f, 0.0f, -0.433013f, 0.8f,
-	-0.12941f, 0.0f, -0.482963f, 0.8f,
-	0.0f, 0.0f, -0.5f, 0.8f,
-	0.12941f, 0.0f, -0.482963f, 0.8f,
-	0.25f, 0.0f, -0.433013f, 0.8f,
-	0.353553f, 0.0f, -0.353553f, 0.8f,
-	0.433013f, 0.0f, -0.25f, 0.8f,
-	0.482963f, 0.0f, -0.12941f, 0.8f,
-	0.5f, 0.0f, 0.0f, 0.8f,
-	0.482963f, 0.0f, 0.12941f, 0.8f,
-	0.433013f, 0.0f, 0.25f, 0.8f,
-	0.353553f, 0.0f, 0.353553f, 0.8f,
-	0.25f, 0.0f, 0.433013f, 0.8f,
-	0.12941f, 0.0f, 0.482963f, 0.8f,
-	0.0f, 0.0f, 0.5f, 0.8f,
-	-0.12941f, 0.0f, 0.482963f, 0.8f,
-	-0.25f, 0.0f, 0.433013f, 0.8f,
-	-0.353553f, 0.0f, 0.353553f, 0.8f,
-	-0.433013f, 0.0f, 0.25f, 0.8f,
-	-0.482963f, 0.0f, 0.12941f, 0.8f,
-	0.0f, 13.0f, 1.25f, 0.8f,
-	-0.323524f, 13.0f, 1.207407f, 0.8f,
-	-0.625f, 13.0f, 1.082532f, 0.8f,
-	-0.883883f, 13.0f, 0.883883f, 0.8f,
-	-1.082532f, 13.0f, 0.625f, 0.8f,
-	-1.207407f, 13.0f, 0.323524f, 0.8f,
-	-1.25f, 13.0f, -0.0f, 0.8f,
-	-1.207407f, 13.0f, -0.323524f, 0.8f,
-	-1.082532f, 13.0f, -0.625f, 0.8f,
-	-0.883883f, 13.0f, -0.883883f, 0.8f,
-	-0.625f, 13.0f, -1.082532f, 0.8f,
-	-0.323524f, 13.0f, -1.207407f, 0.8f,
-	0.0f, 13.0f, -1.25f, 0.8f,
-	0.323524f, 13.0f, -1.207407f, 0.8f,
-	0.625f, 13.0f, -1.082532f, 0.8f,
-	0.883883f, 13.0f, -0.883883f, 0.8f,
-	1.082532f, 13.0f, -0.625f, 0.8f,
-	1.207407f, 13.0f, -0.323524f, 0.8f,
-	1.25f, 13.0f, 0.0f, 0.8f,
-	1.207407f, 13.0f, 0.323524f, 0.8f,
-	1.082532f, 13.0f, 0.625f, 0.8f,
-	0.883883f, 13.0f, 0.883883f, 0.8f,
-	0.625f, 13.0f, 1.082532f, 0.8f,
-	0.323524f, 13.0f, 1.207407f, 0.8f,
-	-0.5f, 13.0f, 0.0f, 0.8f,
-	-0.482963f, 13.0f, 0.12941f, 0.8f,
-	-0.433013f, 13.0f, 0.25f, 0.8f,
-	-0.353553f, 13.0f, 0.353553f, 0.8f,
-	-0.25f, 13.0f, 0.433013f, 0.8f,
-	-0.12941f, 13.0f, 0.482963f, 0.8f,
-	0.0f, 13.0f, 0.5f, 0.8f,
-	0.12941f, 13.0f, 0.482963f, 0.8f,
-	0.25f, 13.0f, 0.433013f, 0.8f,
-	0.353553f, 13.0f, 0.353553f, 0.8f,
-	0.433013f, 13.0f, 0.25f, 0.8f,
-	0.482963f, 13.0f, 0.12941f, 0.8f,
-	0.5f, 13.0f, 0.0f, 0.8f,
-	0.482963f, 13.0f, -0.12941f, 0.8f,
-	0.433013f, 13.0f, -0.25f, 0.8f,
-	0.353553f, 13.0f, -0.353553f, 0.8f,
-	0.25f, 13.0f, -0.433013f, 0.8f,
-	0.12941f, 13.0f, -0.482963f, 0.8f,
-	0.0f, 13.0f, -0.5f, 0.8f,
-	-0.12941f, 13.0f, -0.482963f, 0.8f,
-	-0.25f, 13.0f, -0.433013f, 0.8f,
-	-0.353553f, 13.0f, -0.353553f, 0.8f,
-	-0.433013f, 13.0f, -0.25f, 0.8f,
-	-0.482963f, 13.0f, -0.12941f, 0.8f,
-	-0.0f, 15.5f, 0.0f, 1.0f,
-	-0.5f, 2.6f, -0.0f, 1.0f,
-	-0.5f, 5.2f, -0.0f, 1.0f,
-	-0.5f, 7.8f, -0.0f, 1.0f,
-	-0.5f, 10.4f, -0.0f, 1.0f,
-	-0.482963f, 2.6f, 0.12941f, 1.0f,
-	-0.482963f, 5.2f, 0.12941f, 1.0f,
-	-0.482963f, 7.8f, 0.12941f, 1.0f,
-	-0.482963f, 10.4f, 0.12941f, 1.0f,
-	-0.433013f, 2.6f, 0.25f, 1.0f,
-	-0.433013f, 5.2f, 0.25f, 1.0f,
-	-0.433013f, 7.8f, 0.25f, 1.0f,
-	-0.433013f, 10.4f, 0.25f, 1.0f,
-	-0.353553f, 2.6f, 0.353553f, 1.0f,
-	-0.353553f, 5.2f, 0.353553f, 1.0f,
-	-0.353553f, 7.8f, 0.353553f, 1.0f,
-	-0.353553f, 10.4f, 0.353553f, 1.0f,
-	-0.25f, 2.6f, 0.433013f, 1.0f,
-	-0.25f, 5.2f, 0.433013f, 1.0f,
-	-0.25f, 7.8f, 0.433013f, 1.0f,
-	-0.25f, 10.4f, 0.433013f, 1.0f,
-	-0.12941f, 2.6f, 0.482963f, 1.0f,
-	-0.12941f, 5.2f, 0.482963f, 1.0f,
-	-0.12941f, 7.8f, 0.482963f, 1.0f,
-	-0.12941f, 10.4f, 0.482963f, 1.0f,
-	0.0f, 2.6f, 0.5f, 1.0f,
-	0.0f, 5.2f, 0.5f, 1.0f,
-	0.0f, 7.8f, 0.5f, 1.0f,
-	0.0f, 10.4f, 0.5f, 1.0f,
-	0.12941f, 2.6f, 0.482963f, 1.0f,
-	0.12941f, 5.2f, 0.482963f, 1.0f,
-	0.12941f, 7.8f, 0.482963f, 1.0f,
-	0.12941f, 10.4f, 0.482963f, 1.0f,
-	0.25f, 2.6f, 0.433013f, 1.0f,
-	0.25f, 5.2f, 0.433013f, 1.0f,
-	0.25f, 7.8f, 0.433013f, 1.0f,
-	0.25f, 10.4f, 0.433013f, 1.0f,
-	0.353553f, 2.6f, 0.353553f, 1.0f,
-	0.353553f, 5.2f, 0.353553f, 1.0f,
-	0.353553f, 7.8f, 0.353553f, 1.0f,
-	0.353553f, 10.4f, 0.353553f, 1.0f,
-	0.433013f, 2.6f, 0.25f, 1.0f,
-	0.433013f, 5.2f, 0.25f, 1.0f,
-	0.433013f, 7.8f, 0.25f, 1.0f,
-	0.433013f, 10.4f, 0.25f, 1.0f,
-	0.482963f, 2.6f, 0.12941f, 1.0f,
-	0.482963f, 5.2f, 0.12941f, 1.0f,
-	0.482963f, 7.8f, 0.12941f, 1.0f,
-	0.482963f, 10.4f, 0.12941f, 1.0f,
-	0.5f, 2.6f, 0.0f, 1.0f,
-	0.5f, 5.2f, 0.0f, 1.0f,
-	0.5f, 7.8f, 0.0f, 1.0f,
-	0.5f, 10.4f, 0.0f, 1.0f,
-	0.482963f, 2.6f, -0.12941f, 1.0f,
-	0.482963f, 5.2f, -0.12941f, 1.0f,
-	0.482963f, 7.8f, -0.12941f, 1.0f,
-	0.482963f, 10.4f, -0.12941f, 1.0f,
-	0.433013f, 2.6f, -0.25f, 1.0f,
-	0.433013f, 5.2f, -0.25f, 1.0f,
-	0.433013f, 7.8f, -0.25f, 1.0f,
-	0.433013f, 10.4f, -0.25f, 1.0f,
-	0.353553f, 2.6f, -0.353553f, 1.0f,
-	0.353553f, 5.2f, -0.353553f, 1.0f,
-	0.353553f, 7.8f, -0.353553f, 1.0f,
-	0.353553f, 10.4f, -0.353553f, 1.0f,
-	0.25f, 2.6f, -0.433013f, 1.0f,
-	0.25f, 5.2f, -0.433013f, 1.0f,
-	0.25f, 7.8f, -0.433013f, 1.0f,
-	0.25f, 10.4f, -0.433013f, 1.0f,
-	0.12941f, 2.6f, -0.482963f, 1.0f,
-	0.12941f, 5.2f, -0.482963f, 1.0f,
-	0.12941f, 7.8f, -0.482963f, 1.0f,
-	0.12941f, 10.4f, -0.482963f, 1.0f,
-	0.0f, 2.6f, -0.5f, 1.0f,
-	0.0f, 5.2f, -0.5f, 1.0f,
-	0.0f, 7.8f, -0.5f, 1.0f,
-	0.0f, 10.4f, -0.5f, 1.0f,
-	-0.12941f, 2.6f, -0.482963f, 1.0f,
-	-0.12941f, 5.2f, -0.482963f, 1.0f,
-	-0.12941f, 7.8f, -0.482963f, 1.0f,
-	-0.12941f, 10.4f, -0.482963f, 1.0f,
-	-0.25f, 2.6f, -0.433013f, 1.0f,
-	-0.25f, 5.2f, -0.433013f, 1.0f,
-	-0.25f, 7.8f, -0.433013f, 1.0f,
-	-0.25f, 10.4f, -0.433013f, 1.0f,
-	-0.353553f, 2.6f, -0.353553f, 1.0f,
-	-0.353553f, 5.2f, -0.353553f, 1.0f,
-	-0.353553f, 7.8f, -0.353553f, 1.0f,
-	-0.353553f, 10.4f, -0.353553f, 1.0f,
-	-0.433013f, 2.6f, -0.25f, 1.0f,
-	-0.433013f, 5.2f, -0.25f, 1.0f,
-	-0.433013f, 7.8f, -0.25f, 1.0f,
-	-0.433013f, 10.4f, -0.25f, 1.0f,
-	-0.482963f, 2.6f, -0.12941f, 1.0f,
-	-0.482963f, 5.2f, -0.12941f, 1.0f,
-	-0.482963f, 7.8f, -0.12941f, 1.0f,
-	-0.482963f, 10.4f, -0.12941f, 1.0f,
+float arrow_v4_buffer_data[507] = {
+	-0.5f, 0.0f, 0.0f,
+	-0.482963f, 0.0f, -0.12941f,
+	-0.433013f, 0.0f, -0.25f,
+	-0.353553f, 0.0f, -0.353553f,
+	-0.25f, 0.0f, -0.433013f,
+	-0.12941f, 0.0f, -0.482963f,
+	0.0f, 0.0f, -0.5f,
+	0.12941f, 0.0f, -0.482963f,
+	0.25f, 0.0f, -0.433013f,
+	0.353553f, 0.0f, -0.353553f,
+	0.433013f, 0.0f, -0.25f,
+	0.482963f, 0.0f, -0.12941f,
+	0.5f, 0.0f, 0.0f,
+	0.482963f, 0.0f, 0.12941f,
+	0.433013f, 0.0f, 0.25f,
+	0.353553f, 0.0f, 0.353553f,
+	0.25f, 0.0f, 0.433013f,
+	0.12941f, 0.0f, 0.482963f,
+	0.0f, 0.0f, 0.5f,
+	-0.12941f, 0.0f, 0.482963f,
+	-0.25f, 0.0f, 0.433013f,
+	-0.353553f, 0.0f, 0.353553f,
+	-0.433013f, 0.0f, 0.25f,
+	-0.482963f, 0.0f, 0.12941f,
+	0.0f, 13.0f, 1.25f,
+	-0.323524f, 13.0f, 1.207407f,
+	-0.625f, 13.0f, 1.082532f,
+	-0.883883f, 13.0f, 0.883883f,
+	-1.082532f, 13.0f, 0.625f,
+	-1.207407f, 13.0f, 0.323524f,
+	-1.25f, 13.0f, -0.0f,
+	-1.207407f, 13.0f, -0.323524f,
+	-1.082532f, 13.0f, -0.625f,
+	-0.883883f, 13.0f, -0.883883f,
+	-0.625f, 13.0f, -1.082532f,
+	-0.323524f, 13.0f, -1.207407f,
+	0.0f, 13.0f, -1.25f,
+	0.323524f, 13.0f, -1.207407f,
+	0.625f, 13.0f, -1.082532f,
+	0.883883f, 13.0f, -0.883883f,
+	1.082532f, 13.0f, -0.625f,
+	1.207407f, 13.0f, -0.323524f,
+	1.25f, 13.0f, 0.0f,
+	1.207407f, 13.0f, 0.323524f,
+	1.082532f, 13.0f, 0.625f,
+	0.883883f, 13.0f, 0.883883f,
+	0.625f, 13.0f, 1.082532f,
+	0.323524f, 13.0f, 1.207407f,
+	-0.5f, 13.0f, 0.0f,
+	-0.482963f, 13.0f, 0.12941f,
+	-0.433013f, 13.0f, 0.25f,
+	-0.353553f, 13.0f, 0.353553f,
+	-0.25f, 13.0f, 0.433013f,
+	-0.12941f, 13.0f, 0.482963f,
+	0.0f, 13.0f, 0.5f,
+	0.12941f, 13.0f, 0.482963f,
+	0.25f, 13.0f, 0.433013f,
+	0.353553f, 13.0f, 0.353553f,
+	0.433013f, 13.0f, 0.25f,
+	0.482963f, 13.0f, 0.12941f,
+	0.5f, 13.0f, 0.0f,
+	0.482963f, 13.0f, -0.12941f,
+	0.433013f, 13.0f, -0.25f,
+	0.353553f, 13.0f, -0.353553f,
+	0.25f, 13.0f, -0.433013f,
+	0.12941f, 13.0f, -0.482963f,
+	0.0f, 13.0f, -0.5f,
+	-0.12941f, 13.0f, -0.482963f,
+	-0.25f, 13.0f, -0.433013f,
+	-0.353553f, 13.0f, -0.353553f,
+	-0.433013f, 13.0f, -0.25f,
+	-0.482963f, 13.0f, -0.12941f,
+	-0.0f, 15.5f, 0.0f,
+	-0.5f, 2.6f, -0.0f,
+	-0.5f, 5.2f, -0.0f,
+	-0.5f, 7.8f, -0.0f,
+	-0.5f, 10.4f, -0.0f,
+	-0.482963f, 2.6f, 0.12941f,
+	-0.482963f, 5.2f, 0.12941f,
+	-0.482963f, 7.8f, 0.12941f,
+	-0.482963f, 10.4f, 0.12941f,
+	-0.433013f, 2.6f, 0.25f,
+	-0.433013f, 5.2f, 0.25f,
+	-0.433013f, 7.8f, 0.25f,
+	-0.433013f, 10.4f, 0.25f,
+	-0.353553f, 2.6f, 0.353553f,
+	-0.353553f, 5.2f, 0.353553f,
+	-0.353553f, 7.8f, 0.353553f,
+	-0.353553f, 10.4f, 0.353553f,
+	-0.25f, 2.6f, 0.433013f,
+	-0.25f, 5.2f, 0.433013f,
+	-0.25f, 7.8f, 0.433013f,
+	-0.25f, 10.4f, 0.433013f,
+	-0.12941f, 2.6f, 0.482963f,
+	-0.12941f, 5.2f, 0.482963f,
+	-0.12941f, 7.8f, 0.482963f,
+	-0.12941f, 10.4f, 0.482963f,
+	0.0f, 2.6f, 0.5f,
+	0.0f, 5.2f, 0.5f,
+	0.0f, 7.8f, 0.5f,
+	0.0f, 10.4f, 0.5f,
+	0.12941f, 2.6f, 0.482963f,
+	0.12941f, 5.2f, 0.482963f,
+	0.12941f, 7.8f, 0.482963f,
+	0.12941f, 10.4f, 0.482963f,
+	0.25f, 2.6f, 0.433013f,
+	0.25f, 5.2f, 0.433013f,
+	0.25f, 7.8f, 0.433013f,
+	0.25f, 10.4f, 0.433013f,
+	0.353553f, 2.6f, 0.353553f,
+	0.353553f, 5.2f, 0.353553f,
+	0.353553f, 7.8f, 0.353553f,
+	0.353553f, 10.4f, 0.353553f,
+	0.433013f, 2.6f, 0.25f,
+	0.433013f, 5.2f, 0.25f,
+	0.433013f, 7.8f, 0.25f,
+	0.433013f, 10.4f, 0.25f,
+	0.482963f, 2.6f, 0.12941f,
+	0.482963f, 5.2f, 0.12941f,
+	0.482963f, 7.8f, 0.12941f,
+	0.482963f, 10.4f, 0.12941f,
+	0.5f, 2.6f, 0.0f,
+	0.5f, 5.2f, 0.0f,
+	0.5f, 7.8f, 0.0f,
+	0.5f, 10.4f, 0.0f,
+	0.482963f, 2.6f, -0.12941f,
+	0.482963f, 5.2f, -0.12941f,
+	0.482963f, 7.8f, -0.12941f,
+	0.482963f, 10.4f, -0.12941f,
+	0.433013f, 2.6f, -0.25f,
+	0.433013f, 5.2f, -0.25f,
+	0.433013f, 7.8f, -0.25f,
+	0.433013f, 10.4f, -0.25f,
+	0.353553f, 2.6f, -0.353553f,
+	0.353553f, 5.2f, -0.353553f,
+	0.353553f, 7.8f, -0.353553f,
+	0.353553f, 10.4f, -0.353553f,
+	0.25f, 2.6f, -0.433013f,
+	0.25f, 5.2f, -0.433013f,
+	0.25f, 7.8f, -0.433013f,
+	0.25f, 10.4f, -0.433013f,
+	0.12941f, 2.6f, -0.482963f,
+	0.12941f, 5.2f, -0.482963f,
+	0.12941f, 7.8f, -0.482963f,
+	0.12941f, 10.4f, -0.482963f,
+	0.0f, 2.6f, -0.5f,
+	0.0f, 5.2f, -0.5f,
+	0.0f, 7.8f, -0.5f,
+	0.0f, 10.4f, -0.5f,
+	-0.12941f, 2.6f, -0.482963f,
+	-0.12941f, 5.2f, -0.482963f,
+	-0.12941f, 7.8f, -0.482963f,
+	-0.12941f, 10.4f, -0.482963f,
+	-0.25f, 2.6f, -0.433013f,
+	-0.25f, 5.2f, -0.433013f,
+	-0.25f, 7.8f, -0.433013f,
+	-0.25f, 10.4f, -0.433013f,
+	-0.353553f, 2.6f, -0.353553f,
+	-0.353553f, 5.2f, -0.353553f,
+	-0.353553f, 7.8f, -0.353553f,
+	-0.353553f, 10.4f, -0.353553f,
+	-0.433013f, 2.6f, -0.25f,
+	-0.433013f, 5.2f, -0.25f,
+	-0.433013f, 7.8f, -0.25f,
+	-0.433013f, 10.4f, -0.25f,
+	-0.482963f, 2.6f, -0.12941f,
+	-0.482963f, 5.2f, -0.12941f,
+	-0.482963f, 7.8f, -0.12941f,
+	-0.482963f, 10.4f, -0.12941f,
 };
 
-unsigned int arrow_v4_buffer_data_stride = 4;
+unsigned int arrow_v4_buffer_data_stride = 3;
 
 unsigned int arrow_v4_elements_data[1002] = {
 	2-1, 12-1, 1-1,
@@ -509,3 +509,17 @@ unsigned int arrow_v4_elements_data[1002] = {
 	76-1, 81-1, 77-1,
 };
 
+unsigned char arrow_v4_ao_data[169] = {
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 241, 241, 252, 249, 249, 252, 255, 251,
+	252, 249, 252, 246, 247, 247, 252, 252, 255, 251, 255, 250, 251, 244, 248, 249,
+	188, 196, 179, 189, 183, 193, 179, 188, 187, 195, 182, 190, 189, 191, 185, 194,
+	181, 179, 195, 173, 184, 200, 196, 187, 255, 255, 254, 254, 255, 255, 255, 255,
+	255, 255, 255, 255, 252, 255, 255, 255, 254, 255, 255, 255, 254, 255, 255, 254,
+	254, 255, 255, 255, 253, 255, 255, 255, 253, 255, 255, 255, 253, 255, 255, 254,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 251, 255, 255, 255, 253, 255, 255, 255, 254, 255, 254, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 253, 255, 255, 255, 252, 255, 255, 254,
+	255, 255, 255, 254, 254, 255, 255, 253, 254,
+};
+
@@ -3,6 +3,15 @@ import sys
 import argparse
 import glob
 import math
+import random
+from multiprocessing import Pool
+
+# ambient occlusion bake: rays per vertex, and how far a ray may travel (as a fraction of the
+# mesh's bounding box diagonal) before it counts as reaching open sky
+AO_RAYS = 256
+AO_DISTANCE = 0.5
+AO_OFFSET = 1e-4
+BVH_LEAF_SIZE = 4
 
 class Vec3:
     def __init__(self, v: list):
@@ -111,6 +120,151 @@ class VertexBufferObject:
     def __repr__(self):
         return self.to_string()
 
+def sub(a, b):
+    return (a[0] - b[0], a[1] - b[1], a[2] - b[2])
+
+def cross(a, b):
+    return (a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0])
+
+def dot(a, b):
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]
+
+def normalized(a):
+    length = math.sqrt(dot(a, a))
+    if length == 0.0:
+        return (0.0, 0.0, 0.0)
+    return (a[0]/length, a[1]/length, a[2]/length)
+
+class TriangleBvh:
+    """Median split BVH over the mesh's triangles, only answers 'is anything hit before max_t'"""
+    def __init__(self, triangles: list):
+        self.triangles = triangles
+        self.order = list(range(len(triangles)))
+        # each node: (bounds min, bounds max, left child, right child, first triangle, triangle count)
+        self.nodes = []
+        self.build(0, len(triangles))
+
+    def bounds(self, begin, end):
+        lo = [math.inf] * 3
+        hi = [-math.inf] * 3
+        for t in self.order[begin:end]:
+            for p in self.triangles[t]:
+                for a in range(3):
+                    lo[a] = min(lo[a], p[a])
+                    hi[a] = max(hi[a], p[a])
+        return lo, hi
+
+    def build(self, begin, end):
+        index = len(self.nodes)
+        self.nodes.append(None)
+        lo, hi = self.bounds(begin, end)
+        if end - begin <= BVH_LEAF_SIZE:
+            self.nodes[index] = (lo, hi, -1, -1, begin, end - begin)
+            return index
+
+        axis = max(range(3), key=lambda a: hi[a] - lo[a])
+        self.order[begin:end] = sorted(self.order[begin:end], key=lambda t: sum(p[axis] for p in self.triangles[t]))
+        mid = (begin + end) // 2
+        left = self.build(begin, mid)
+        right = self.build(mid, end)
+        self.nodes[index] = (lo, hi, left, right, begin, 0)
+        return index
+
+    def hits_box(self, origin, inv_dir, lo, hi, max_t):
+        enter = 0.0
+        leave = max_t
+        for a in range(3):
+            t0 = (lo[a] - origin[a]) * inv_dir[a]
+            t1 = (hi[a] - origin[a]) * inv_dir[a]
+            if t0 > t1:
+                t0, t1 = t1, t0
+            enter = max(enter, t0)
+            leave = min(leave, t1)
+        return enter <= leave
+
+    def hits_triangle(self, origin, direction, triangle, max_t):
+        # Moller-Trumbore
+        v0, v1, v2 = triangle
+        e1 = sub(v1, v0)
+        e2 = sub(v2, v0)
+        p = cross(direction, e2)
+        det = dot(e1, p)
+        if abs(det) < 1e-12:
+            return False
+        inv = 1.0 / det
+        s = sub(origin, v0)
+        u = dot(s, p) * inv
+        if u < 0.0 or u > 1.0:
+            return False
+        q = cross(s, e1)
+        v = dot(direction, q) * inv
+        if v < 0.0 or u + v > 1.0:
+            return False
+        t = dot(e2, q) * inv
+        return 0.0 <= t <= max_t
+
+    def occluded(self, origin, direction, max_t):
+        inv_dir = tuple(1.0 / d if d != 0.0 else math.inf for d in direction)
+        stack = [0]
+        while stack:
+            lo, hi, left, right, first, count = self.nodes[stack.pop()]
+            if not self.hits_box(origin, inv_dir, lo, hi, max_t):
+                continue
+            if count == 0:
+                stack.append(left)
+                stack.append(right)
+                continue
+            for t in self.order[first:first + count]:
+                if self.hits_triangle(origin, direction, self.triangles[t], max_t):
+                    return True
+        return False
+
+# set in every worker process by init_ao_worker, so the BVH is only sent over once per process
+ao_bvh = None
+ao_distance = 0.0
+
+def init_ao_worker(triangles, distance):
+    global ao_bvh, ao_distance
+    ao_bvh = TriangleBvh(triangles)
+    ao_distance = distance
+
+def bake_vertex_ao(job):
+    """Fraction of cosine weighted hemisphere rays that escape, quantised to 0..255"""
+    index, position, normal = job
+    if dot(normal, normal) == 0.0:
+        return 255
+
+    rng = random.Random(index)
+    axis = (1.0, 0.0, 0.0) if abs(normal[0]) < 0.9 else (0.0, 1.0, 0.0)
+    tangent = normalized(cross(axis, normal))
+    bitangent = cross(normal, tangent)
+    origin = tuple(position[a] + normal[a] * AO_OFFSET for a in range(3))
+
+    open_rays = 0
+    for _ in range(AO_RAYS):
+        phi = 2.0 * math.pi * rng.random()
+        r2 = rng.random()
+        r = math.sqrt(r2)
+        x = r * math.cos(phi)
+        y = r * math.sin(phi)
+        z = math.sqrt(1.0 - r2)
+        direction = tuple(tangent[a] * x + bitangent[a] * y + normal[a] * z for a in range(3))
+        if not ao_bvh.occluded(origin, direction, ao_distance):
+            open_rays += 1
+
+    return round(255 * open_rays / AO_RAYS)
+
+def bake_ambient_occlusion(positions: list, normals: list, faces: list):
+    """Per vertex ambient occlusion, one job per vertex spread over every core"""
+    triangles = [tuple(positions[i] for i in face) for face in faces]
+    lo = [min(p[a] for p in positions) for a in range(3)]
+    hi = [max(p[a] for p in positions) for a in range(3)]
+    distance = AO_DISTANCE * math.sqrt(dot(sub(hi, lo), sub(hi, lo)))
+
+    jobs = [(i, positions[i], normalized(normals[i])) for i in range(len(positions))]
+    with Pool(initializer=init_ao_worker, initargs=(triangles, distance)) as pool:
+        return pool.map(bake_vertex_ao, jobs, chunksize=8)
+
 def eprint(*args, **kwargs):
     print(*args, file=sys.stderr, **kwargs)
     sys.exit(1)
@@ -123,6 +277,8 @@ def main():
     parser.add_argument("-i", "--header-output-path", dest="h_output_path", required=True, help="Directory to put the output .h file to")
     parser.add_argument("-z", "--simple-shading", dest="simple", action="store_true", default=False, required=False, help="Whether or not to read the OBJ as a 'simple' geometric object. \
                                                                                           The first normal vector found is used as the normal vector for the vertex, as opposed to an average.")
+    parser.add_argument("-a", "--ambient-occlusion", dest="ao", action="store_true", default=False, required=False, help="Bake per vertex ambient occlusion against the mesh itself \
+                                                                                          and write it as a separate unsigned char array. Replaces the 'simple' shading intensity.")
 
     args = parser.parse_args()
 
@@ -130,6 +286,8 @@ def main():
         vbo = []
         veo = []
         normals = []
+        positions = []
+        vertex_normals = []
         lines = None
 
         with open(file, "r") as f:
@@ -154,6 +312,8 @@ def main():
 
             if line_contents[0] == "v":
                 vbo.append(VertexBufferObject(Vec3(line_contents[1:4])))
+                positions.append(tuple(float(c) for c in line_contents[1:4]))
+                vertex_normals.append((0.0, 0.0, 0.0))
 
             elif line_contents[0] == "vn":
                 normals.append(Vec3(line_contents[1:4]))
@@ -167,9 +327,9 @@ def main():
 
                 if len(line_contents[1].split("/")) == 1:
                     single_case = True
-                    v1 = line_contents[1].split("/")
-                    v2 = line_contents[2].split("/")
-                    v3 = line_contents[3].split("/")
+                    v1 = line_contents[1].split("/")[0]
+                    v2 = line_contents[2].split("/")[0]
+                    v3 = line_contents[3].split("/")[0]
                 else:
                     v1,_,n1 = line_contents[1].split("/")
                     v2,_,n2 = line_contents[2].split("/")
@@ -177,7 +337,18 @@ def main():
 
                 veo.append((v1, v2, v3))
 
-                if not single_case:
+                face = [int(v1) - 1, int(v2) - 1, int(v3) - 1]
+                if single_case:
+                    # no normals in the file, use the winding
+                    a, b, c = [positions[i] for i in face]
+                    face_normal = normalized(cross(sub(b, a), sub(c, a)))
+                    face_normals = [face_normal] * 3
+                else:
+                    face_normals = [(normals[int(n) - 1].x, normals[int(n) - 1].y, normals[int(n) - 1].z) for n in (n1, n2, n3)]
+                for i, n in zip(face, face_normals):
+                    vertex_normals[i] = tuple(vertex_normals[i][a] + n[a] for a in range(3))
+
+                if not single_case and not (args.ao and args.simple):
                     n1_i = int(n1) - 1
                     n2_i = int(n2) - 1
                     n3_i = int(n3) - 1
@@ -195,12 +366,18 @@ def main():
 
         just_file_name = file.split("/")[-1].replace(".obj", "").replace('-','_')
 
+        ao = None
+        if args.ao:
+            ao = bake_ambient_occlusion(positions, vertex_normals, [[int(i) - 1 for i in face] for face in veo])
+
         vbo_buffer_size = len(vbo) * vbo[0].size()
 
         with open(f"{args.h_output_path}/{just_file_name}.h", "w") as f:
             f.write(f"extern float {just_file_name}_buffer_data[{vbo_buffer_size}];\n")
             f.write(f"extern unsigned int {just_file_name}_buffer_data_stride;\n")
             f.write(f"extern unsigned int {just_file_name}_elements_data[{len(veo)*len(veo[0])}];")
+            if ao is not None:
+                f.write(f"\nextern unsigned char {just_file_name}_ao_data[{len(ao)}];")
 
         with open(f"{args.cpp_output_path}/{just_file_name}.cpp", "w") as f:
             f.write(f"float {just_file_name}_buffer_data[{vbo_buffer_size}] = {{\n")
@@ -216,5 +393,12 @@ def main():
                 f.write(f"\t{ui1}-1, {ui2}-1, {ui3}-1,\n")
             f.write(f"}};\n\n")
 
+            if ao is not None:
+                # 255 is fully open, normalised to 0..1 when read as GL_UNSIGNED_BYTE
+                f.write(f"unsigned char {just_file_name}_ao_data[{len(ao)}] = {{\n")
+                for i in range(0, len(ao), 16):
+                    f.write("\t" + ", ".join(str(a) for a in ao[i:i + 16]) + ",\n")
+                f.write(f"}};\n\n")
+
 if __name__ == "__main__":
     main()
\ No newline at end of file
@@ -0,0 +1,32 @@
+float cube_buffer_data[24] = {
+	-0.5f, -0.5f, -0.5f,
+	0.5f, -0.5f, -0.5f,
+	0.5f, 0.5f, -0.5f,
+	-0.5f, 0.5f, -0.5f,
+	-0.5f, -0.5f, 0.5f,
+	0.5f, -0.5f, 0.5f,
+	0.5f, 0.5f, 0.5f,
+	-0.5f, 0.5f, 0.5f,
+};
+
+unsigned int cube_buffer_data_stride = 3;
+
+unsigned int cube_elements_data[36] = {
+	1-1, 3-1, 2-1,
+	1-1, 4-1, 3-1,
+	5-1, 6-1, 7-1,
+	5-1, 7-1, 8-1,
+	1-1, 5-1, 8-1,
+	1-1, 8-1, 4-1,
+	2-1, 3-1, 7-1,
+	2-1, 7-1, 6-1,
+	1-1, 2-1, 6-1,
+	1-1, 6-1, 5-1,
+	4-1, 8-1, 7-1,
+	4-1, 7-1, 3-1,
+};
+
+unsigned char cube_ao_data[8] = {
+	255, 255, 255, 255, 255, 255, 255, 255,
+};
+
@@ -5,119 +5,385 @@
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
 #include "ShaderHelper.h"
 #include "Camera.h"
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "Simulation.h"
+#include "TripleBuffer.h"
+#include "HeadlessContext.h"
+#include "CpuProfiler.h"
+#include "GlStats.h"
+#include "InputLog.h"
+#include "FrameEncoder.h"
+#include "FrameReadback.h"
+#include "InputLatency.h"
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
 
+// the simulation runs at SIM_HZ (Simulation.h), the render thread interpolates between the last two steps.
+// The longest frame it will catch up on, so a stall doesn't turn into a burst of steps
+#define MAX_CATCH_UP 0.25
+#define MIX_SPEED 0.6f
+// headless defaults, overridden with --frames, --size and --output
+#define HEADLESS_FRAMES 600
+// written when built with make PROFILE=1
+#define TRACE_PATH "cpu_trace.json"
+
+// the keys processInput reads, one bit each so a step's keyboard can be logged and replayed
+#define KEY_QUIT (1u << 0)
+#define KEY_UP (1u << 1)
+#define KEY_DOWN (1u << 2)
+#define KEY_GPU_CULLING (1u << 3)
+#define KEY_DEFERRED (1u << 4)
+#define KEY_W (1u << 5)
+#define KEY_S (1u << 6)
+#define KEY_A (1u << 7)
+#define KEY_D (1u << 8)
+
 // Globals
 float g_mix_percent = 0.2f;
 glm::vec3 g_lightPos = glm::vec3(1.2f, 1.0f, 2.0f);
-
-const char *vertexShaderSource = "#version 330 core\n"
-        "layout (location = 0) in vec3 aPos;\n"
-        "layout (location = 1) in vec3 aNormal;\n"
-        "layout (location = 2) in vec2 aTexCoord;\n"
-        "out vec3 Normal;\n"
-        "out vec3 FragPos;\n"
-        "uniform mat4 model;\n"
-        "uniform mat4 view;\n"
-        "uniform mat4 projection;\n"
-        "void main()\n"
-        "{\n"
-        "  gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
-        "  Normal = aNormal;\n"
-        "  FragPos = vec3(model * vec4(aPos, 1.0));\n"
-        "}";
-
-const char *fragment2ShaderSource = "#version 330 core\n"
-        "in vec3 Normal;\n"
-        "in vec3 FragPos;\n"
-        "out vec4 FragColor;\n"
-        "uniform vec3 objectColor;\n"
-        "uniform vec3 lightColor;\n"
-        "uniform vec3 lightPos;\n"
-        "uniform vec3 viewPos;\n"
-        "void main()\n"
-        "{\n"
-        "  float specularStr = 0.5;\n"
-        "  float ambientStrength = 0.1;\n"
-        "  vec3 ambient = ambientStrength * lightColor;\n"
-        "  vec3 norm    = normalize(Normal);\n"
-        "  vec3 lightDir = normalize(lightPos - FragPos);\n"
-        "  float diff = max(dot(norm, lightDir), 0.0);\n"
-        "  vec3 diffuse = diff * lightColor;\n"
-        "  vec3 viewDir = normalize(viewPos - FragPos);\n"
-        "  vec3 reflectDir = reflect(-lightDir, norm);\n"   // reflect arg 1 vector FROM light TO fragment
-        "  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);\n"
-        "  vec3 specular = specularStr * spec * lightColor;\n"
-        "  vec3 result  = (ambient + diffuse + specular) * objectColor;\n"
-        "  FragColor = vec4(result, 1.0);\n"
-        "}";
-
-const char *lightSourceVertexShaderSource = "#version 330 core\n"
-        "layout (location = 0) in vec3 aPos;\n"
-        "uniform mat4 model;\n"
-        "uniform mat4 view;\n"
-        "uniform mat4 projection;\n"
-        "void main()\n"
-        "{\n"
-        "  gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
-        "}";
-
-const char *lightSourceFragmentShaderSource = "#version 330 core\n"
-        "out vec4 FragColor;\n"
-        "void main()\n"
-        "{\n"
-        "  FragColor = vec4(1.0);\n"
-        "}";
+int g_framebufferWidth = WINDOW_WIDTH;
+int g_framebufferHeight = WINDOW_HEIGHT;
+bool g_gpuCulling = true;
+bool g_deferredShading = false;
+// keys held at the last step, G and L act on the step they go down
+unsigned int g_previousKeys = 0;
+// --gl-stats: per-frame GL call counts go here as CSV
+const char *g_glStatsPath = nullptr;
+
+// --record writes every input to a log, --replay plays one back at --replay-speed times real time (0 is flat out)
+InputLog g_inputLog;
+const char *g_recordPath = nullptr;
+const char *g_replayPath = nullptr;
+double g_replaySpeed = 1.0;
+double g_recordStart = 0.0;
+// keys down according to the log being replayed
+unsigned int g_replayKeys = 0;
+
+// --capture writes every frame into a directory, read back through a PBO ring and encoded on another thread
+const char *g_capturePath = nullptr;
+FrameEncoder::Format g_captureFormat = FrameEncoder::FORMAT_PNG;
+FrameEncoder *g_encoder = nullptr;
+FrameReadback *g_readback = nullptr;
+
+// --latency times every input until it is on screen, per-frame stages go to a CSV
+const char *g_latencyPath = nullptr;
+InputLatency *g_latency = nullptr;
+
+// simulation thread writes, render thread reads
+TripleBuffer<Renderer::FrameSnapshot> g_snapshots;
+std::atomic<bool> g_quit(false);
+
+#ifndef HEADLESS_EGL
+/* Simulation step an input arrives after, the window carries the simulation */
+unsigned long long current_step(GLFWwindow *window)
+{
+    Simulation *sim = (Simulation *)glfwGetWindowUserPointer(window);
+    return sim != nullptr ? sim->step() : 0;
+}
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    // the render thread picks the new size up from the next snapshot
+    g_framebufferWidth = width;
+    g_framebufferHeight = height;
+    // the camera's aspect is simulation input, a replay takes it from the log
+    if (g_inputLog.replaying()) return;
+    g_inputLog.record(InputLog::EVENT_RESIZE, current_step(window), glfwGetTime() - g_recordStart, width, height);
     Camera::set_window_ratio((float)width, (float)height);
 }
 
-void processInput(GLFWwindow *window)
+void cursor_callback(GLFWwindow *window, double xpos, double ypos)
+{
+    if (g_inputLog.replaying()) return;
+    g_inputLog.record(InputLog::EVENT_CURSOR, current_step(window), glfwGetTime() - g_recordStart, xpos, ypos);
+    if (g_latency != nullptr) g_latency->input();
+    Camera::mouse_callback(window, xpos, ypos);
+}
+
+void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
+{
+    if (g_inputLog.replaying()) return;
+    g_inputLog.record(InputLog::EVENT_SCROLL, current_step(window), glfwGetTime() - g_recordStart, xoffset, yoffset);
+    if (g_latency != nullptr) g_latency->input();
+    Camera::scroll_callback(window, xoffset, yoffset);
+}
+
+/* Keys are read once a step, this only times when a press or release arrived */
+void key_callback(GLFWwindow *, int, int, int action, int)
+{
+    if (g_latency != nullptr && action != GLFW_REPEAT && !g_inputLog.replaying()) g_latency->input();
+}
+
+/* The keyboard as processInput sees it */
+unsigned int read_keys(GLFWwindow *window)
+{
+    const int keys[][2] = {
+        {GLFW_KEY_SPACE, KEY_QUIT}, {GLFW_KEY_ESCAPE, KEY_QUIT}, {GLFW_KEY_UP, KEY_UP}, {GLFW_KEY_DOWN, KEY_DOWN},
+        {GLFW_KEY_G, KEY_GPU_CULLING}, {GLFW_KEY_L, KEY_DEFERRED},
+        {GLFW_KEY_W, KEY_W}, {GLFW_KEY_S, KEY_S}, {GLFW_KEY_A, KEY_A}, {GLFW_KEY_D, KEY_D},
+    };
+    unsigned int down = 0;
+    for (const int *key : keys)
+    {
+        if (glfwGetKey(window, key[0]) == GLFW_PRESS) down |= key[1];
+    }
+    return down;
+}
+#endif // HEADLESS_EGL
+
+/* Hands the simulation what the log recorded between the previous step and the next one */
+void replay_input(unsigned long long step)
 {
-    static float deltaTime = 0.0f;
-    static float lastFrame = 0.0f;
-    float currentFrame = glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
+    InputLog::Event event;
+    while (g_inputLog.next(step, event))
+    {
+        switch (event.type)
+        {
+            case InputLog::EVENT_CURSOR: Camera::mouse_callback(nullptr, event.x, event.y); break;
+            case InputLog::EVENT_SCROLL: Camera::scroll_callback(nullptr, event.x, event.y); break;
+            case InputLog::EVENT_KEYS: g_replayKeys = event.keys; break;
+            case InputLog::EVENT_RESIZE: Camera::set_window_ratio((float)event.x, (float)event.y); break;
+            default: break;
+        }
+        // a replayed input arrives when it is handed over
+        if (g_latency != nullptr && event.type != InputLog::EVENT_END) g_latency->input();
+    }
+}
+
+/* Runs once per fixed simulation step, so movement no longer depends on the frame rate.
+   False when quit is held */
+bool processInput(unsigned int keys, float deltaTime)
+{
+    PROFILE_SCOPE("processInput");
+    unsigned int pressed = keys & ~g_previousKeys;
+    g_previousKeys = keys;
 
-    if(glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS ||  glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (keys & KEY_QUIT)
     {
-        glfwSetWindowShouldClose(window, true);
+        return false;
     }
-    else if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+    else if (keys & KEY_UP)
     {
-        if (g_mix_percent < 1.0f) g_mix_percent += 0.01f;
+        if (g_mix_percent < 1.0f) g_mix_percent += MIX_SPEED * deltaTime;
     }
-    else if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+    else if (keys & KEY_DOWN)
     {
-        if (g_mix_percent > 0.0f) g_mix_percent -= 0.01f;
+        if (g_mix_percent > 0.0f) g_mix_percent -= MIX_SPEED * deltaTime;
     }
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    // G flips between GPU and CPU culling, L between clustered forward and deferred lighting
+    if (pressed & KEY_GPU_CULLING) g_gpuCulling = !g_gpuCulling;
+    if (pressed & KEY_DEFERRED) g_deferredShading = !g_deferredShading;
+
+    if (keys & KEY_W)
     {
         Camera::W(deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (keys & KEY_S)
     {
         Camera::S(deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (keys & KEY_A)
     {
         Camera::A(deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (keys & KEY_D)
     {
         Camera::D(deltaTime);
     }
+    return true;
+}
+
+/* One fixed step, with this step's input applied in the middle. Headless the only input is a replayed log.
+   False when the input asked to quit */
+bool simulation_step(Simulation &sim, GLFWwindow *window)
+{
+    PROFILE_SCOPE("simulation_step");
+    replay_input(sim.step());
+    sim.begin_step();
+    unsigned int keys = g_replayKeys;
+#ifndef HEADLESS_EGL
+    if (!g_inputLog.replaying()) keys = read_keys(window);
+    g_inputLog.record_keys(sim.step(), glfwGetTime() - g_recordStart, keys);
+#else
+    (void)window;
+#endif
+    bool running = processInput(keys, (float)SIM_DT);
+    sim.end_step(SIM_DT);
+    if (g_latency != nullptr) g_latency->applied();
+    return running;
+}
+
+/* Hands the newest state to the renderer. stateTime is the clock time the state belongs to,
+   stepSeconds how much clock time a step takes */
+void simulation_publish(Simulation &sim, double stateTime, double stepSeconds)
+{
+    PROFILE_SCOPE("simulation_publish");
+    Renderer::FrameSnapshot &snapshot = g_snapshots.write_buffer();
+    sim.fill_snapshot(snapshot);
+    snapshot.stateTime = stateTime;
+    snapshot.stepSeconds = stepSeconds;
+    snapshot.lightPos = g_lightPos;
+    snapshot.mixPercent = g_mix_percent;
+    snapshot.framebufferWidth = g_framebufferWidth;
+    snapshot.framebufferHeight = g_framebufferHeight;
+    snapshot.gpuCulling = g_gpuCulling;
+    snapshot.deferredShading = g_deferredShading;
+    snapshot.latencySequence = g_latency != nullptr ? g_latency->published() : 0;
+    g_snapshots.publish();
+}
+
+/* Prints where input latency went and writes the CSV. After the GL thread has called finish() */
+void latency_report()
+{
+    if (g_latency == nullptr) return;
+    g_latency->print();
+    g_latency->write_csv(g_latencyPath);
+    delete g_latency;
+    g_latency = nullptr;
+}
+
+/* Starts capturing if --capture asked for it. On the GL thread */
+void capture_start()
+{
+    if (g_capturePath == nullptr) return;
+    g_encoder = new FrameEncoder(g_capturePath, g_captureFormat);
+    g_readback = new FrameReadback([](unsigned long long frame, int width, int height, const unsigned char *rgba) {
+        g_encoder->submit(frame, width, height, rgba);
+    });
+}
+
+/* Waits for the last frames to be read back and written. frameMilliseconds is how long the frames took in all */
+void capture_stop(double frameMilliseconds)
+{
+    if (g_readback == nullptr) return;
+    g_readback->flush();
+    g_encoder->finish();
+    printf("capture: %llu frames to %s, %llu failed, %llu waited on the GPU, %.2f ms per frame on the GL thread (%.1f%% of frame time)\n",
+           g_encoder->written(), g_capturePath, g_encoder->failed(), g_readback->stalls(), g_readback->milliseconds() / g_readback->captured(),
+           100.0 * g_readback->milliseconds() / frameMilliseconds);
+    delete g_readback;
+    delete g_encoder;
+    g_readback = nullptr;
+    g_encoder = nullptr;
+}
+
+#ifdef HEADLESS_EGL
+
+/* No window and no live input: one simulation step per frame, drawn into the context's framebuffer on this thread
+   so runs are repeatable. A recorded session can be replayed through it. The last frame can be written out to
+   check what was drawn */
+int main(int argc, char **argv)
+{
+    int frames = 0;
+    int width = WINDOW_WIDTH;
+    int height = WINDOW_HEIGHT;
+    const char *output = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &width, &height);
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = argv[++i];
+        else if (strcmp(argv[i], "--deferred") == 0) g_deferredShading = true;
+        else if (strcmp(argv[i], "--cpu-culling") == 0) g_gpuCulling = false;
+        else if (strcmp(argv[i], "--gl-stats") == 0 && i + 1 < argc) g_glStatsPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) g_replayPath = argv[++i];
+        else if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) g_replaySpeed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) g_capturePath = argv[++i];
+        else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc && FrameEncoder::parse_format(argv[i + 1], g_captureFormat)) i++;
+        else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) g_latencyPath = argv[++i];
+        else
+        {
+            printf("usage: %s [--frames N] [--size WxH] [--output frame.ppm] [--deferred] [--cpu-culling] [--gl-stats stats.csv]\n"
+                   "          [--replay input.log] [--replay-speed S] [--capture path] [--capture-format png|ppm|y4m|raw]\n"
+                   "          [--latency latency.csv]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (g_replayPath != nullptr && !g_inputLog.load(g_replayPath)) return 1;
+    // a replay runs to the end of the log unless told to stop sooner
+    if (frames == 0) frames = g_inputLog.replaying() ? (int)g_inputLog.end_step() : HEADLESS_FRAMES;
+    if (frames <= 0 || width <= 0 || height <= 0) return 1;
+    if (g_latencyPath != nullptr) g_latency = new InputLatency();
+
+    PROFILE_START(TRACE_PATH);
+    PROFILE_THREAD("main");
+    HeadlessContext context;
+    if (!context.create(width, height)) return 1;
+    g_framebufferWidth = width;
+    g_framebufferHeight = height;
+    Camera::set_window_ratio((float)width, (float)height);
+    Camera::init_orientation();
+    stbi_set_flip_vertically_on_load(true);
+
+    JobSystem::init();
+    Simulation sim;
+    sim.setup("default", 0, g_lightPos);
+    if (g_glStatsPath != nullptr && GlStats::open_csv(g_glStatsPath)) GlStats::install();
+    Renderer::setup(g_lightPos, (GLADloadproc)HeadlessContext::get_proc_address);
+    capture_start();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int frame = 0;
+    while (frame < frames)
+    {
+        PROFILE_SCOPE("frame");
+        bool running = simulation_step(sim, nullptr);
+        simulation_publish(sim, sim.step() * SIM_DT, SIM_DT);
+        g_snapshots.consume();
+
+        // always exactly on the newest state, there is no clock to land between steps
+        context.bind();
+        if (g_latency != nullptr) g_latency->frame_begin(g_snapshots.read_buffer().latencySequence);
+        Renderer::draw_frame(g_snapshots.read_buffer(), 1.0f);
+        if (g_latency != nullptr) g_latency->frame_submitted();
+        if (g_readback != nullptr) g_readback->capture(frame, width, height);
+        // nothing is presented, the flush stands in for the swap
+        glFlush();
+        if (g_latency != nullptr) g_latency->frame_swapped();
+        GlStats::end_frame();
+        frame++;
+        if (!running || (g_inputLog.replaying() && g_inputLog.finished(sim.step()))) break;
+
+        // a replay keeps to its recorded pace, scaled
+        if (g_inputLog.replaying() && g_replaySpeed > 0.0)
+        {
+            std::this_thread::sleep_until(start + std::chrono::duration<double>(sim.step() * SIM_DT / g_replaySpeed));
+        }
+    }
+    frames = frame;
+    glFinish();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("headless: %d frames at %dx%d in %.3f s, %.2f ms per frame\n", frames, width, height, seconds, seconds * 1000.0 / frames);
+    capture_stop(seconds * 1000.0);
+    if (g_latency != nullptr) g_latency->finish();
+    latency_report();
+
+    bool ok = output == nullptr || context.save_ppm(output);
+    GlStats::close_csv();
+
+    Renderer::shutdown();
+    JobSystem::shutdown();
+    context.destroy();
+    PROFILE_STOP();
+
+    return ok ? 0 : 1;
 }
 
+#else
+
 GLFWwindow* window_setup()
 {
     glfwInit();
@@ -139,8 +405,10 @@ GLFWwindow* window_setup()
 
     // camera setup
     Camera::set_window_ratio((float)WINDOW_WIDTH, (float)WINDOW_HEIGHT);
-    glfwSetCursorPosCallback(window, Camera::mouse_callback);
-    glfwSetScrollCallback(window, Camera::scroll_callback);
+    Camera::init_orientation();
+    glfwSetCursorPosCallback(window, cursor_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
@@ -150,176 +418,156 @@ GLFWwindow* window_setup()
 
     stbi_set_flip_vertically_on_load(true);
 
+    glfwGetFramebufferSize(window, &g_framebufferWidth, &g_framebufferHeight);
+
     return window;
 }
 
-int main()
+/* Owns the GL context. Draws the newest snapshot while the main thread simulates the next one */
+void render_thread(GLFWwindow *window)
 {
-    GLFWwindow *window = window_setup();
-    if (window == nullptr) return 1;
-
-    // Camera::toggle_fps_movement(true);
-
-    float vertices[] = {
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
-    };
-
-    ShaderHelper sh;
-    sh.add_shader(GL_VERTEX_SHADER, &vertexShaderSource);
-    sh.add_shader(GL_FRAGMENT_SHADER, &fragment2ShaderSource);
-    sh.link_shaders();
-
-    // textures
-    unsigned int texture1 = sh.load_texture("assets/container.jpg", false);
-    unsigned int texture2 = sh.load_texture("assets/awesomeface.png", true);
-
-    sh.use();
-    sh.set_uniform("texture1", 0);
-    sh.set_uniform("texture2", 1);
-    sh.set_uniform("objectColor", 1.0f, 0.5f, 0.31f);
-    sh.set_uniform("lightColor", 1.0f, 1.0f, 1.0f);
-    sh.set_uniform("lightPos", g_lightPos);
-
-    // things bound when VAO is bound are attached to that object
-    unsigned int VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    unsigned int VBO;
-    // create one VBO. the function returns a "number" that represent internally where the VBO would go
-    glGenBuffers(1, &VBO);
-    // easy way to reference VBO, by binding it to the keyword and using that keyword instead
-    // only one of each type can be binding to its associated keyword
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    // copy our data into a buffer for OpenGL
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // vertex attribute is an attribute unique to each vector
-    // first arg is the # of the vertex attribute 
-    // second arg is the size of the vertex attribute, related to third arg (datatype)
-    // fourth arg is about whether or not to normalize to 0/-1 and 1
-    // fifth arg is distance between each vertex attribute. It would be the width of each vertex attribute
-    //   if we know it is tightly packed we can pass 0 to let opengl figure out the stride
-    // sixth arg is the offset of where the vertex attribute data begins in the buffer
-    // THE VBO BOUND TO GL_ARRAY_BUFFER IS THE ONE OPENGL uses for vertex data
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    
-    // vertex attribute are disabled by default
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    // glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6*sizeof(float)));
-    // glEnableVertexAttribArray(2);
-
-    // lighting
-    unsigned int lightVAO;
-    glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
-    // we only need to bind to the VBO, the container’s VBO’s data
-    // already contains the data.
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    ShaderHelper lightsh;
-    lightsh.add_shader(GL_VERTEX_SHADER, &lightSourceVertexShaderSource);
-    lightsh.add_shader(GL_FRAGMENT_SHADER, &lightSourceFragmentShaderSource);
-    lightsh.link_shaders();
-
-    Camera::setup_hud(g_lightPos, glm::vec3(1.0f));
-
-    glEnable(GL_DEPTH_TEST);
-
-    while(!glfwWindowShouldClose(window))
+    PROFILE_THREAD("render");
+    glfwMakeContextCurrent(window);
+    // setup's calls land in the first frame
+    if (g_glStatsPath != nullptr && GlStats::open_csv(g_glStatsPath)) GlStats::install();
     {
-        processInput(window);
+        PROFILE_SCOPE("Renderer::setup");
+        Renderer::setup(g_lightPos, (GLADloadproc)glfwGetProcAddress);
+    }
+    capture_start();
 
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    unsigned long long frame = 0;
+    double start = glfwGetTime();
+    while (!g_quit.load())
+    {
+        g_snapshots.consume();
+        const Renderer::FrameSnapshot &snapshot = g_snapshots.read_buffer();
+        if (g_latency != nullptr) g_latency->frame_begin(snapshot.latencySequence);
+
+        // show the world one step in the past so there are always two states to blend between
+        float alpha = (float)((glfwGetTime() - snapshot.stateTime) / snapshot.stepSeconds);
+        {
+            PROFILE_SCOPE("draw_frame");
+            Renderer::draw_frame(snapshot, glm::clamp(alpha, 0.0f, 1.0f));
+        }
+        if (g_latency != nullptr) g_latency->frame_submitted();
+        // the back buffer, before the swap gives it away
+        if (g_readback != nullptr) g_readback->capture(frame, snapshot.framebufferWidth, snapshot.framebufferHeight);
+        frame++;
+        {
+            PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        if (g_latency != nullptr) g_latency->frame_swapped();
+        GlStats::end_frame();
+    }
 
-        sh.use();
+    capture_stop((glfwGetTime() - start) * 1000.0);
+    if (g_latency != nullptr) g_latency->finish();
+    Renderer::shutdown();
+    GlStats::close_csv();
+    glfwMakeContextCurrent(NULL);
+}
 
-        sh.set_uniform_matrix4("projection", 1, GL_FALSE, glm::value_ptr(Camera::projectionMatrix));
-        sh.set_uniform("mixU", g_mix_percent);
-        sh.set_uniform("viewPos", Camera::pos);
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--gl-stats") == 0 && i + 1 < argc) g_glStatsPath = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) g_recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) g_replayPath = argv[++i];
+        else if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) g_replaySpeed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) g_capturePath = argv[++i];
+        else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc && FrameEncoder::parse_format(argv[i + 1], g_captureFormat)) i++;
+        else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) g_latencyPath = argv[++i];
+        else
+        {
+            printf("usage: %s [--gl-stats stats.csv] [--record input.log] [--replay input.log] [--replay-speed S]\n"
+                   "          [--capture path] [--capture-format png|ppm|y4m|raw] [--latency latency.csv]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (g_replayPath != nullptr && !g_inputLog.load(g_replayPath)) return 1;
+    if (g_latencyPath != nullptr) g_latency = new InputLatency();
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
+    PROFILE_START(TRACE_PATH);
+    PROFILE_THREAD("main");
+    GLFWwindow *window = window_setup();
+    if (window == nullptr) return 1;
 
-        glm::mat4 view = Camera::get_view_matrix();
-        sh.set_uniform_matrix4("view", 1, GL_FALSE, glm::value_ptr(view));
+    // this thread handles events and simulation, workers pick up culling, transform and recording jobs
+    JobSystem::init();
 
-        glBindVertexArray(VAO);
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f));
-        sh.set_uniform_matrix4("model", 1, GL_FALSE, glm::value_ptr(model));
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+    // Camera::toggle_fps_movement(true);
 
-        lightsh.use();
-        lightsh.set_uniform_matrix4("projection", 1, GL_FALSE, glm::value_ptr(Camera::projectionMatrix));
-        lightsh.set_uniform_matrix4("view", 1, GL_FALSE, glm::value_ptr(view));
+    Simulation sim;
+    sim.setup("default", 0, g_lightPos);
+    // so input callbacks know which step they arrive after
+    glfwSetWindowUserPointer(window, &sim);
+    if (g_recordPath != nullptr && !g_inputLog.open(g_recordPath)) return 1;
+    g_recordStart = glfwGetTime();
 
-        glBindVertexArray(lightVAO);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, g_lightPos);
-        model = glm::scale(model, glm::vec3(0.2f));
-        lightsh.set_uniform_matrix4("model", 1, GL_FALSE, glm::value_ptr(model));
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+    // the context moves to the render thread, only event handling stays here
+    glfwMakeContextCurrent(NULL);
+    std::thread renderer;
 
-        Camera::draw_hud();
+    double accumulator = 0.0;
+    double previousTime = glfwGetTime();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    while(!glfwWindowShouldClose(window))
+    {
+        {
+            PROFILE_SCOPE("glfwPollEvents");
+            glfwPollEvents();
+        }
+
+        // a replay ignores live input, escape still stops it
+        if (g_inputLog.replaying() && glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
+
+        // a replay's clock runs scaled, flat out it takes one step every pass
+        double speed = g_inputLog.replaying() ? g_replaySpeed : 1.0;
+        double now = glfwGetTime();
+        accumulator += speed > 0.0 ? std::min(now - previousTime, MAX_CATCH_UP) * speed : SIM_DT;
+        previousTime = now;
+
+        if (accumulator < SIM_DT)
+        {
+            // nothing due yet, sleep until the next step instead of spinning
+            glfwWaitEventsTimeout((SIM_DT - accumulator) / speed);
+            continue;
+        }
+
+        while (accumulator >= SIM_DT)
+        {
+            if (!simulation_step(sim, window)) glfwSetWindowShouldClose(window, true);
+            accumulator -= SIM_DT;
+            if (g_inputLog.replaying() && g_inputLog.finished(sim.step()))
+            {
+                glfwSetWindowShouldClose(window, true);
+                accumulator = 0.0;
+            }
+        }
+        // the renderer blends on the wall clock, where a step lasts SIM_DT / speed
+        double stepSeconds = speed > 0.0 ? SIM_DT / speed : SIM_DT;
+        simulation_publish(sim, now - accumulator / SIM_DT * stepSeconds, stepSeconds);
+
+        if (!renderer.joinable())
+        {
+            // start drawing once there is a first snapshot to draw
+            renderer = std::thread(render_thread, window);
+        }
     }
 
+    g_quit = true;
+    if (renderer.joinable()) renderer.join();
+    latency_report();
+    g_inputLog.close(sim.step(), glfwGetTime() - g_recordStart);
+
+    JobSystem::shutdown();
     glfwTerminate();
+    PROFILE_STOP();
 
     return 0;
-}
\ No newline at end of file
+}
+
+#endif // HEADLESS_EGL
@@ -0,0 +1,381 @@
+// Offline lightmap baker for the static scene geometry. Needs no GPU.
+// Lays the container's triangles out in a lightmap atlas, then path traces the main light and its bounces
+// into every texel on all cores, tracing through a 4-wide MeshBvh. The renderer picks the result up at startup.
+//
+//   make lightmaps
+//   ./build/bake_lightmap [output path] [samples per texel] [atlas size]
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "JobSystem.h"
+#include "Lightmap.h"
+#include "MeshBvh.h"
+#include "container.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const char *DEFAULT_OUTPUT = "assets/container.lightmap";
+const int DEFAULT_SAMPLES = 256;
+const int DEFAULT_ATLAS_SIZE = 64;
+const int MAX_BOUNCES = 3;
+// empty texels around every chart, so bilinear filtering never reads another chart
+const int CHART_PADDING = 2;
+// keeps rays from starting inside the surface they leave
+const float RAY_OFFSET = 1e-3f;
+const unsigned int TEXEL_GRAIN = 16;
+
+// must match the scene set up in main.cpp and Renderer.cpp
+const glm::vec3 LIGHT_POS = glm::vec3(1.2f, 1.0f, 2.0f);
+const glm::vec3 LIGHT_COLOUR = glm::vec3(1.0f);
+const glm::vec3 ALBEDO = glm::vec3(1.0f, 0.5f, 0.31f);
+// the runtime ambient term, treated as light arriving from an evenly lit sky
+const float SKY = 0.1f;
+
+struct Mesh {
+    std::vector<glm::vec3> positions;     // three per triangle
+    std::vector<glm::vec3> normals;
+};
+
+// triangles that share edges and a plane, flattened onto that plane
+struct Chart {
+    std::vector<unsigned int> triangles;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+    glm::vec2 min;
+    glm::vec2 max;
+    int x, y;         // placement in the atlas, in texels
+    int width, height;
+};
+
+// one atlas texel and the surface point its centre lands on
+struct TexelSample {
+    glm::vec3 position;
+    glm::vec3 normal;
+    bool covered;
+};
+
+/* Small per-texel generator, so the result does not depend on which thread baked which texel */
+struct Random {
+    unsigned int state;
+
+    explicit Random(unsigned int seed) : state(seed * 747796405u + 2891336453u) { if (state == 0) state = 1; }
+
+    float next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+Mesh load_container()
+{
+    Mesh mesh;
+    unsigned int vertexCount = sizeof(container_buffer_data) / sizeof(float) / container_buffer_data_stride;
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        const float *v = &container_buffer_data[i * container_buffer_data_stride];
+        mesh.positions.push_back(glm::vec3(v[0], v[1], v[2]));
+        mesh.normals.push_back(glm::vec3(v[3], v[4], v[5]));
+    }
+    return mesh;
+}
+
+glm::vec3 face_normal(const Mesh &mesh, unsigned int t)
+{
+    const glm::vec3 *p = &mesh.positions[t * 3];
+    return glm::normalize(glm::cross(p[1] - p[0], p[2] - p[0]));
+}
+
+bool share_edge(const Mesh &mesh, unsigned int a, unsigned int b)
+{
+    int shared = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            if (glm::length(mesh.positions[a * 3 + i] - mesh.positions[b * 3 + j]) < 1e-5f) shared++;
+        }
+    }
+    return shared >= 2;
+}
+
+/* Flood fills coplanar neighbours into charts. Quadratic, which is fine for the few hundred triangles of static props */
+std::vector<Chart> build_charts(const Mesh &mesh)
+{
+    unsigned int triangleCount = (unsigned int)mesh.positions.size() / 3;
+    std::vector<int> chartOf(triangleCount, -1);
+    std::vector<Chart> charts;
+    for (unsigned int seed = 0; seed < triangleCount; seed++)
+    {
+        if (chartOf[seed] >= 0) continue;
+        glm::vec3 normal = face_normal(mesh, seed);
+        Chart chart;
+        chartOf[seed] = (int)charts.size();
+        chart.triangles.push_back(seed);
+        for (size_t open = 0; open < chart.triangles.size(); open++)
+        {
+            for (unsigned int t = 0; t < triangleCount; t++)
+            {
+                if (chartOf[t] >= 0 || glm::dot(face_normal(mesh, t), normal) < 0.999f) continue;
+                if (!share_edge(mesh, chart.triangles[open], t)) continue;
+                chartOf[t] = (int)charts.size();
+                chart.triangles.push_back(t);
+            }
+        }
+
+        glm::vec3 axis = fabsf(normal.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        chart.tangent = glm::normalize(glm::cross(axis, normal));
+        chart.bitangent = glm::cross(normal, chart.tangent);
+        chart.min = glm::vec2(FLT_MAX);
+        chart.max = glm::vec2(-FLT_MAX);
+        for (unsigned int t : chart.triangles)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                glm::vec3 p = mesh.positions[t * 3 + i];
+                glm::vec2 flat = glm::vec2(glm::dot(p, chart.tangent), glm::dot(p, chart.bitangent));
+                chart.min = glm::min(chart.min, flat);
+                chart.max = glm::max(chart.max, flat);
+            }
+        }
+        charts.push_back(chart);
+    }
+    return charts;
+}
+
+/* Shelf packs the charts at the given scale, tallest first. False if they don't fit */
+bool pack_charts(std::vector<Chart> &charts, float texelsPerUnit, int atlasSize)
+{
+    std::vector<Chart *> order;
+    for (Chart &chart : charts)
+    {
+        glm::vec2 size = (chart.max - chart.min) * texelsPerUnit;
+        chart.width = (int)ceilf(size.x) + 2 * CHART_PADDING;
+        chart.height = (int)ceilf(size.y) + 2 * CHART_PADDING;
+        order.push_back(&chart);
+    }
+    std::sort(order.begin(), order.end(), [](const Chart *a, const Chart *b) { return a->height > b->height; });
+
+    int x = 0, y = 0, shelfHeight = 0;
+    for (Chart *chart : order)
+    {
+        if (x + chart->width > atlasSize)
+        {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        if (chart->width > atlasSize || y + chart->height > atlasSize) return false;
+        chart->x = x;
+        chart->y = y;
+        x += chart->width;
+        shelfHeight = std::max(shelfHeight, chart->height);
+    }
+    return true;
+}
+
+/* Gives every vertex a lightmap uv, scaling the charts down until they fit */
+std::vector<glm::vec2> build_atlas(const Mesh &mesh, std::vector<Chart> &charts, int atlasSize)
+{
+    float area = 0.0f;
+    for (const Chart &chart : charts)
+    {
+        glm::vec2 size = chart.max - chart.min;
+        area += size.x * size.y;
+    }
+    float texelsPerUnit = sqrtf(atlasSize * atlasSize / std::max(area, 1e-6f));
+    while (!pack_charts(charts, texelsPerUnit, atlasSize))
+    {
+        texelsPerUnit *= 0.95f;
+    }
+    printf("%zu charts at %.1f texels per unit\n", charts.size(), texelsPerUnit);
+
+    std::vector<glm::vec2> uvs(mesh.positions.size());
+    for (const Chart &chart : charts)
+    {
+        for (unsigned int t : chart.triangles)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                glm::vec3 p = mesh.positions[t * 3 + i];
+                glm::vec2 flat = glm::vec2(glm::dot(p, chart.tangent), glm::dot(p, chart.bitangent));
+                glm::vec2 texel = (flat - chart.min) * texelsPerUnit + glm::vec2(chart.x + CHART_PADDING, chart.y + CHART_PADDING);
+                uvs[t * 3 + i] = texel / (float)atlasSize;
+            }
+        }
+    }
+    return uvs;
+}
+
+/* Finds the surface point under every texel centre the triangles cover */
+std::vector<TexelSample> rasterize(const Mesh &mesh, const std::vector<glm::vec2> &uvs, int atlasSize)
+{
+    std::vector<TexelSample> texels((size_t)atlasSize * atlasSize, TexelSample{glm::vec3(0.0f), glm::vec3(0.0f), false});
+    for (unsigned int t = 0; t < mesh.positions.size() / 3; t++)
+    {
+        glm::vec2 a = uvs[t * 3] * (float)atlasSize;
+        glm::vec2 b = uvs[t * 3 + 1] * (float)atlasSize;
+        glm::vec2 c = uvs[t * 3 + 2] * (float)atlasSize;
+        float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (fabsf(area) < 1e-12f) continue;
+
+        int x0 = std::max(0, (int)floorf(std::min(a.x, std::min(b.x, c.x))));
+        int x1 = std::min(atlasSize - 1, (int)ceilf(std::max(a.x, std::max(b.x, c.x))));
+        int y0 = std::max(0, (int)floorf(std::min(a.y, std::min(b.y, c.y))));
+        int y1 = std::min(atlasSize - 1, (int)ceilf(std::max(a.y, std::max(b.y, c.y))));
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                glm::vec2 p = glm::vec2(x + 0.5f, y + 0.5f);
+                float w1 = ((p.x - a.x) * (c.y - a.y) - (c.x - a.x) * (p.y - a.y)) / area;
+                float w2 = ((b.x - a.x) * (p.y - a.y) - (p.x - a.x) * (b.y - a.y)) / area;
+                float w0 = 1.0f - w1 - w2;
+                if (w0 < -1e-4f || w1 < -1e-4f || w2 < -1e-4f) continue;
+
+                TexelSample &texel = texels[(size_t)y * atlasSize + x];
+                texel.position = w0 * mesh.positions[t * 3] + w1 * mesh.positions[t * 3 + 1] + w2 * mesh.positions[t * 3 + 2];
+                texel.normal = glm::normalize(w0 * mesh.normals[t * 3] + w1 * mesh.normals[t * 3 + 1] + w2 * mesh.normals[t * 3 + 2]);
+                texel.covered = true;
+            }
+        }
+    }
+    return texels;
+}
+
+glm::vec3 direct_light(const MeshBvh &bvh, const glm::vec3 &position, const glm::vec3 &normal)
+{
+    glm::vec3 toLight = LIGHT_POS - position;
+    float distance = glm::length(toLight);
+    glm::vec3 dir = toLight / distance;
+    float cosine = glm::dot(normal, dir);
+    if (cosine <= 0.0f) return glm::vec3(0.0f);
+    if (bvh.occluded(Ray(position + normal * RAY_OFFSET, dir, distance))) return glm::vec3(0.0f);
+    return LIGHT_COLOUR * cosine;
+}
+
+glm::vec3 cosine_direction(const glm::vec3 &normal, Random &random)
+{
+    float phi = 6.2831853f * random.next();
+    float r2 = random.next();
+    float r = sqrtf(r2);
+    glm::vec3 axis = fabsf(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 tangent = glm::normalize(glm::cross(axis, normal));
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+    return glm::normalize(tangent * (r * cosf(phi)) + bitangent * (r * sinf(phi)) + normal * sqrtf(1.0f - r2));
+}
+
+/* Light arriving at one surface point, in the renderer's units: the direct term is N.L like the forward shader,
+   the rest is gathered over the cosine weighted hemisphere with the main light sampled at every bounce */
+glm::vec3 bake_texel(const MeshBvh &bvh, const Mesh &mesh, const TexelSample &texel, int samples, Random &random)
+{
+    glm::vec3 gathered = glm::vec3(0.0f);
+    for (int s = 0; s < samples; s++)
+    {
+        glm::vec3 position = texel.position;
+        glm::vec3 normal = texel.normal;
+        glm::vec3 throughput = glm::vec3(1.0f);
+        for (int bounce = 0; bounce < MAX_BOUNCES; bounce++)
+        {
+            Ray ray(position + normal * RAY_OFFSET, cosine_direction(normal, random));
+            MeshBvh::Hit hit;
+            if (!bvh.intersect(ray, hit))
+            {
+                gathered += throughput * SKY;
+                break;
+            }
+            position = ray.origin + ray.dir * hit.t;
+            normal = face_normal(mesh, hit.triangle);
+            if (glm::dot(normal, ray.dir) > 0.0f) normal = -normal;
+            throughput *= ALBEDO;
+            gathered += throughput * direct_light(bvh, position, normal);
+        }
+    }
+    return direct_light(bvh, texel.position, texel.normal) + gathered / (float)samples;
+}
+
+/* Grows the baked texels out into the padding so filtering at chart edges reads sensible values */
+void dilate(std::vector<glm::vec3> &colours, std::vector<TexelSample> &texels, int atlasSize)
+{
+    for (int pass = 0; pass < CHART_PADDING; pass++)
+    {
+        std::vector<TexelSample> before = texels;
+        std::vector<glm::vec3> source = colours;
+        for (int y = 0; y < atlasSize; y++)
+        {
+            for (int x = 0; x < atlasSize; x++)
+            {
+                if (before[(size_t)y * atlasSize + x].covered) continue;
+                glm::vec3 sum = glm::vec3(0.0f);
+                int count = 0;
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        int nx = x + dx, ny = y + dy;
+                        if (nx < 0 || ny < 0 || nx >= atlasSize || ny >= atlasSize) continue;
+                        if (!before[(size_t)ny * atlasSize + nx].covered) continue;
+                        sum += source[(size_t)ny * atlasSize + nx];
+                        count++;
+                    }
+                }
+                if (count == 0) continue;
+                colours[(size_t)y * atlasSize + x] = sum / (float)count;
+                texels[(size_t)y * atlasSize + x].covered = true;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = argc > 1 ? argv[1] : DEFAULT_OUTPUT;
+    int samples = argc > 2 ? atoi(argv[2]) : DEFAULT_SAMPLES;
+    int atlasSize = argc > 3 ? atoi(argv[3]) : DEFAULT_ATLAS_SIZE;
+    if (samples <= 0 || atlasSize <= 2 * CHART_PADDING)
+    {
+        printf("usage: %s [output path] [samples per texel] [atlas size]\n", argv[0]);
+        return 1;
+    }
+
+    Mesh mesh = load_container();
+    MeshBvh bvh;
+    bvh.build(mesh.positions);
+
+    std::vector<Chart> charts = build_charts(mesh);
+    Lightmap lightmap;
+    lightmap.width = lightmap.height = (unsigned int)atlasSize;
+    lightmap.uvs = build_atlas(mesh, charts, atlasSize);
+    std::vector<TexelSample> texels = rasterize(mesh, lightmap.uvs, atlasSize);
+
+    JobSystem::init();
+    printf("baking %dx%d texels, %d samples each, on %u threads\n", atlasSize, atlasSize, samples, JobSystem::thread_count());
+
+    auto start = std::chrono::steady_clock::now();
+    lightmap.texels.assign(texels.size(), glm::vec3(0.0f));
+    JobSystem::parallel_for((unsigned int)texels.size(), TEXEL_GRAIN, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+        {
+            if (!texels[i].covered) continue;
+            Random random(i + 1);
+            lightmap.texels[i] = bake_texel(bvh, mesh, texels[i], samples, random);
+        }
+    });
+    auto stop = std::chrono::steady_clock::now();
+    JobSystem::shutdown();
+
+    printf("baked in %.2f s\n", std::chrono::duration<double>(stop - start).count());
+
+    dilate(lightmap.texels, texels, atlasSize);
+    if (!lightmap.save(output)) return 1;
+    printf("wrote %s\n", output);
+    return 0;
+}
@@ -0,0 +1,291 @@
+// Offline renderer for demo videos. Flies a camera path through the scene with no window and writes every frame
+// as fast as the renderer allows: a PBO ring reads frames back a few frames late and a pool of encoder threads
+// writes them as a Y4M or raw RGB24 stream or a PNG/PPM sequence. The frame range can be split across several
+// processes, which stitch their streams back together at the end.
+//
+//   make render_sequence
+//   ./build/render_sequence [--path orbit|keys.txt] [--fps N] [--frames N] [--range first:end] [--size WxH]
+//                           [--format y4m|raw|png|ppm] [--output path] [--encoders N] [--processes N]
+//                           [--scene default|cubes] [--count N] [--deferred] [--preroll N]
+//
+// A Y4M plays or converts directly: ffmpeg -i render.y4m -c:v libx264 -crf 18 render.mp4
+// Raw is headerless: ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r FPS -i render.raw ...
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "stb_image.h"
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "CameraPath.h"
+#include "FrameEncoder.h"
+#include "FrameReadback.h"
+#include "HeadlessContext.h"
+#include "JobSystem.h"
+#include "LightProbes.h"
+#include "Renderer.h"
+#include "Simulation.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_FPS 60
+
+struct Settings {
+    std::string scene = "default";
+    unsigned int count = 0;
+    const char *pathName = "orbit";
+    int fps = DEFAULT_FPS;
+    long long frames = -1;          // one loop of the path unless given
+    long long first = 0;
+    long long end = -1;
+    int width = 1280;
+    int height = 720;
+    FrameEncoder::Format format = FrameEncoder::FORMAT_Y4M;
+    std::string output;
+    unsigned int encoders = 0;
+    unsigned int processes = 1;
+    bool deferred = false;
+    // frames drawn before the first one kept, until the probes have all been baked once
+    int preroll = LightProbes::PROBE_COUNT / LightProbes::PROBES_PER_FRAME + 2;
+};
+
+/* Renders [first, end) into output. Returns frames written, or -1 when the context or scene failed */
+long long render_range(const Settings &settings, const CameraPath &path, long long first, long long end, const std::string &output)
+{
+    int width = settings.width;
+    int height = settings.height;
+#ifdef HEADLESS_EGL
+    HeadlessContext context;
+    if (!context.create(width, height)) return -1;
+    GLADloadproc loadProc = (GLADloadproc)HeadlessContext::get_proc_address;
+#else
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(width, height, "render_sequence", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwGetFramebufferSize(window, &width, &height);
+    GLADloadproc loadProc = (GLADloadproc)glfwGetProcAddress;
+#endif
+    Camera::set_window_ratio((float)width, (float)height);
+    Camera::init_orientation();
+    stbi_set_flip_vertically_on_load(true);
+
+    JobSystem::init();
+    glm::vec3 lightPos = glm::vec3(1.2f, 1.0f, 2.0f);
+    Simulation sim;
+    if (!sim.setup(settings.scene, settings.count, lightPos))
+    {
+        printf("Unknown scene %s\n", settings.scene.c_str());
+        return -1;
+    }
+    if (!Renderer::setup(lightPos, loadProc)) return -1;
+
+    unsigned int encoders = settings.encoders > 0 ? settings.encoders : std::max(1u, std::thread::hardware_concurrency());
+    FrameEncoder encoder(output, settings.format, encoders, (unsigned long long)first, settings.fps);
+    FrameReadback readback([&](unsigned long long frame, int w, int h, const unsigned char *rgba) {
+        encoder.submit(frame, w, h, rgba);
+    });
+
+    Renderer::FrameSnapshot snapshot;
+    snapshot.stepSeconds = SIM_DT;
+    snapshot.lightPos = lightPos;
+    snapshot.mixPercent = 0.2f;
+    snapshot.framebufferWidth = width;
+    snapshot.framebufferHeight = height;
+    snapshot.deferredShading = settings.deferred;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long long frame = first; frame < end; frame++)
+    {
+        // every step up to the frame's time, a later range gets there without drawing the frames before it.
+        // Frame 0 is the first step, so the camera is already on the path
+        unsigned long long step = (unsigned long long)((frame * SIM_HZ + settings.fps - 1) / settings.fps) + 1;
+        while (sim.step() < step)
+        {
+            sim.begin_step();
+            path.apply((sim.step() + 1) * SIM_DT);
+            sim.end_step(SIM_DT);
+        }
+        sim.fill_snapshot(snapshot);
+        snapshot.stateTime = sim.step() * SIM_DT;
+
+#ifdef HEADLESS_EGL
+        context.bind();
+#endif
+        if (frame == first)
+        {
+            // the probes bake a few at a time, let them all settle so where a range starts doesn't show
+            for (int i = 0; i < settings.preroll; i++)
+            {
+                Renderer::draw_frame(snapshot, 1.0f);
+            }
+        }
+        Renderer::draw_frame(snapshot, 1.0f);
+        readback.capture((unsigned long long)frame, width, height);
+        glFlush();
+    }
+    readback.flush();
+    encoder.finish();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long long frames = end - first;
+    printf("render_sequence: frames %lld-%lld at %dx%d in %.2f s, %.1f fps, %llu written, %llu failed, %llu readback waits\n",
+           first, end - 1, width, height, seconds, frames / seconds, encoder.written(), encoder.failed(), readback.stalls());
+
+    Renderer::shutdown();
+    JobSystem::shutdown();
+#ifdef HEADLESS_EGL
+    context.destroy();
+#else
+    glfwTerminate();
+#endif
+    return (long long)encoder.written();
+}
+
+/* Appends a part's stream to the output, a Y4M part after the first without its header line */
+bool append_part(FILE *out, const std::string &part, bool skipHeader)
+{
+    FILE *in = fopen(part.c_str(), "rb");
+    if (in == nullptr)
+    {
+        printf("Failed to open %s\n", part.c_str());
+        return false;
+    }
+    if (skipHeader)
+    {
+        int c;
+        while ((c = fgetc(in)) != EOF && c != '\n') {}
+    }
+    std::vector<char> buffer(1 << 20);
+    size_t read;
+    bool ok = true;
+    while ((read = fread(buffer.data(), 1, buffer.size(), in)) > 0)
+    {
+        ok = ok && fwrite(buffer.data(), 1, read, out) == read;
+    }
+    fclose(in);
+    remove(part.c_str());
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) settings.pathName = argv[++i];
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) settings.fps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) settings.frames = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) sscanf(argv[++i], "%lld:%lld", &settings.first, &settings.end);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &settings.width, &settings.height);
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc && FrameEncoder::parse_format(argv[i + 1], settings.format)) i++;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) settings.output = argv[++i];
+        else if (strcmp(argv[i], "--encoders") == 0 && i + 1 < argc) settings.encoders = (unsigned int)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--processes") == 0 && i + 1 < argc) settings.processes = (unsigned int)std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) settings.scene = argv[++i];
+        else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) settings.count = (unsigned int)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--deferred") == 0) settings.deferred = true;
+        else if (strcmp(argv[i], "--preroll") == 0 && i + 1 < argc) settings.preroll = std::max(0, atoi(argv[++i]));
+        else
+        {
+            printf("usage: %s [--path orbit|keys.txt] [--fps N] [--frames N] [--range first:end] [--size WxH]\n"
+                   "          [--format y4m|raw|png|ppm] [--output path] [--encoders N] [--processes N]\n"
+                   "          [--scene default|cubes] [--count N] [--deferred] [--preroll N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    CameraPath path;
+    if (!path.load(settings.pathName)) return 1;
+    if (settings.frames < 0) settings.frames = (long long)(path.duration() * settings.fps + 0.5);
+    if (settings.end < 0 || settings.end > settings.frames) settings.end = settings.frames;
+    if (settings.fps <= 0 || settings.width <= 0 || settings.height <= 0 || settings.first < 0 || settings.first >= settings.end) return 1;
+    if (settings.output.empty())
+    {
+        const char *defaults[] = {"frames", "frames", "render.y4m", "render.raw"};
+        settings.output = defaults[settings.format];
+    }
+
+    long long total = settings.end - settings.first;
+    unsigned int processes = (unsigned int)std::min<long long>(settings.processes, total);
+    if (processes <= 1)
+    {
+        return render_range(settings, path, settings.first, settings.end, settings.output) == total ? 0 : 1;
+    }
+
+    // nothing of GL or the job system exists yet, every child starts from scratch on its own slice
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool stream = FrameEncoder::is_stream(settings.format);
+    std::vector<pid_t> children;
+    std::vector<std::string> parts;
+    for (unsigned int p = 0; p < processes; p++)
+    {
+        long long first = settings.first + total * p / processes;
+        long long end = settings.first + total * (p + 1) / processes;
+        std::string output = stream ? settings.output + ".part" + std::to_string(p) : settings.output;
+        parts.push_back(output);
+        // encoders shared out so the processes don't oversubscribe the machine between them
+        Settings slice = settings;
+        if (slice.encoders == 0) slice.encoders = std::max(1u, std::thread::hardware_concurrency() / processes);
+
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            // _exit so the child doesn't run the parent's atexit handlers, which skips flushing stdout
+            bool done = render_range(slice, path, first, end, output) == end - first;
+            fflush(stdout);
+            _exit(done ? 0 : 1);
+        }
+        if (pid < 0)
+        {
+            printf("Failed to start process %u\n", p);
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    bool ok = children.size() == processes;
+    for (pid_t child : children)
+    {
+        int status = 0;
+        waitpid(child, &status, 0);
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    if (ok && stream)
+    {
+        FILE *out = fopen(settings.output.c_str(), "wb");
+        ok = out != nullptr;
+        for (unsigned int p = 0; ok && p < processes; p++)
+        {
+            ok = append_part(out, parts[p], settings.format == FrameEncoder::FORMAT_Y4M && p > 0);
+        }
+        if (out != nullptr && fclose(out) != 0) ok = false;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("render_sequence: %lld frames across %u processes in %.2f s, %.1f fps%s\n", total, processes, seconds, total / seconds, ok ? "" : ", FAILED");
+    return ok ? 0 : 1;
+}